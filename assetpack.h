@@ -0,0 +1,289 @@
+#ifndef ASSETPACK_H
+#define ASSETPACK_H
+
+#include <raylib.h>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "fileutil.h"
+
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+//#####################
+//Asset pack
+//#####################
+// One file holding every texture already decoded to RGBA8. Layout:
+//
+//   PackHeader | PackEntry[count] | pixels, each starting on a 4 KiB boundary
+//
+// The runtime maps the file and hands raylib Images whose data points straight
+// into the mapping, so nothing is inflated or copied before upload. Each entry
+// remembers the size, modification time and hash of the PNG it was built from.
+// If that PNG is present and its size or time differ, it is hashed; if the
+// hash differs too, the entry is stale and the loader decodes the PNG instead.
+
+static const char PACK_MAGIC[4] = {'G', 'P', 'A', 'K'};
+static const uint32_t PACK_VERSION = 2;
+static const uint64_t PACK_ALIGN = 4096;
+static const int PACK_PATH_MAX = 64;
+
+struct PackHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t count;
+    uint32_t reserved;
+    uint64_t indexHash;  // over the entry table
+    uint64_t fileSize;
+};
+
+struct PackEntry {
+    char path[PACK_PATH_MAX];
+    uint32_t width;
+    uint32_t height;
+    uint32_t format;
+    uint32_t reserved;
+    uint64_t offset;
+    uint64_t size;
+    uint64_t sourceHash;  // of the PNG file bytes
+    uint64_t sourceSize;
+    int64_t sourceTime;   // modification time, ns
+    uint64_t pixelHash;
+};
+
+class AssetPack {
+public:
+    AssetPack() : base(nullptr), size(0) {}
+    ~AssetPack() { Close(); }
+
+    AssetPack(const AssetPack&) = delete;
+    AssetPack& operator=(const AssetPack&) = delete;
+
+    // Offline packer: decodes each PNG once and writes the pack.
+    static bool Write(const char* outPath, const std::vector<std::string>& paths, std::string& error) {
+        std::vector<PackEntry> entries(paths.size());
+        std::vector<Image> images(paths.size());
+        uint64_t offset = AlignUp(sizeof(PackHeader) + sizeof(PackEntry) * paths.size());
+
+        bool ok = true;
+        for (size_t i = 0; i < paths.size(); i++) {
+            images[i] = {0};
+            if (paths[i].size() >= (size_t)PACK_PATH_MAX) {
+                error = "path too long: " + paths[i];
+                ok = false;
+                break;
+            }
+            Image image = LoadImage(paths[i].c_str());
+            if (image.data == nullptr) {
+                error = "failed to load " + paths[i];
+                ok = false;
+                break;
+            }
+            ImageFormat(&image, PIXELFORMAT_UNCOMPRESSED_R8G8B8A8);
+            images[i] = image;
+
+            PackEntry& entry = entries[i];
+            memset(&entry, 0, sizeof(entry));
+            strncpy(entry.path, paths[i].c_str(), PACK_PATH_MAX - 1);
+            entry.width = image.width;
+            entry.height = image.height;
+            entry.format = PIXELFORMAT_UNCOMPRESSED_R8G8B8A8;
+            entry.offset = offset;
+            entry.size = (uint64_t)image.width * image.height * 4;
+            entry.sourceHash = HashFile(paths[i].c_str());
+            FileStamp(paths[i].c_str(), entry.sourceSize, entry.sourceTime);
+            entry.pixelHash = PackHash(image.data, entry.size);
+            offset = AlignUp(offset + entry.size);
+        }
+
+        if (ok) {
+            PackHeader header;
+            memset(&header, 0, sizeof(header));
+            memcpy(header.magic, PACK_MAGIC, sizeof(header.magic));
+            header.version = PACK_VERSION;
+            header.count = (uint32_t)entries.size();
+            header.indexHash = PackHash(entries.data(), sizeof(PackEntry) * entries.size());
+            header.fileSize = offset;
+            ok = WriteFile(outPath, header, entries, images, error);
+        }
+
+        for (Image& image : images) {
+            if (image.data) UnloadImage(image);
+        }
+        return ok;
+    }
+
+    // Maps the pack and checks the header and index. Pixel data is not touched.
+    bool Open(const char* path, std::string& error) {
+        Close();
+#if defined(_WIN32)
+        if (!ReadWholeFile(path, fallback)) {
+            error = std::string("cannot read ") + path;
+            return false;
+        }
+        if (fallback.size() < sizeof(PackHeader)) {
+            fallback.clear();
+            error = std::string("truncated pack ") + path;
+            return false;
+        }
+        base = fallback.data();
+        size = fallback.size();
+#else
+        int fd = open(path, O_RDONLY);
+        if (fd < 0) {
+            error = std::string("cannot open ") + path;
+            return false;
+        }
+        struct stat info;
+        if (fstat(fd, &info) != 0 || info.st_size < (off_t)sizeof(PackHeader)) {
+            close(fd);
+            error = std::string("truncated pack ") + path;
+            return false;
+        }
+        void* mapped = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if (mapped == MAP_FAILED) {
+            error = std::string("cannot map ") + path;
+            return false;
+        }
+        base = (const unsigned char*)mapped;
+        size = info.st_size;
+#endif
+        if (!Validate(error)) {
+            Close();
+            return false;
+        }
+        return true;
+    }
+
+    void Close() {
+#if !defined(_WIN32)
+        if (base) munmap((void*)base, size);
+#else
+        fallback.clear();
+#endif
+        base = nullptr;
+        size = 0;
+    }
+
+    bool IsOpen() const { return base != nullptr; }
+    int Count() const { return base ? (int)Header().count : 0; }
+    const PackEntry& Entry(int i) const { return Entries()[i]; }
+
+    const PackEntry* Find(const std::string& path) const {
+        for (int i = 0; i < Count(); i++) {
+            if (path == Entries()[i].path) return &Entries()[i];
+        }
+        return nullptr;
+    }
+
+    // False when the source PNG is present and no longer matches. A missing
+    // PNG is fine: a shipped build may carry only the pack. The PNG is only
+    // read when its size or time changed.
+    bool Fresh(const PackEntry& entry) const {
+        uint64_t sourceSize;
+        int64_t sourceTime;
+        if (!FileStamp(entry.path, sourceSize, sourceTime)) return true;
+        if (sourceSize == entry.sourceSize && sourceTime == entry.sourceTime) return true;
+        std::vector<unsigned char> bytes;
+        if (!ReadWholeFile(entry.path, bytes)) return true;
+        return PackHash(bytes.data(), bytes.size()) == entry.sourceHash;
+    }
+
+    // Reads every pixel, so only for checks and benchmarks.
+    bool VerifyPixels(const PackEntry& entry) const {
+        return PackHash(base + entry.offset, entry.size) == entry.pixelHash;
+    }
+
+    // The Image borrows the mapping: never UnloadImage it, and keep the pack
+    // open until the texture has been uploaded.
+    Image View(const PackEntry& entry) const {
+        Image image = {0};
+        image.data = (void*)(base + entry.offset);
+        image.width = entry.width;
+        image.height = entry.height;
+        image.mipmaps = 1;
+        image.format = entry.format;
+        return image;
+    }
+
+private:
+    const unsigned char* base;
+    size_t size;
+#if defined(_WIN32)
+    std::vector<unsigned char> fallback;
+#endif
+
+    static uint64_t AlignUp(uint64_t value) {
+        return (value + PACK_ALIGN - 1) & ~(PACK_ALIGN - 1);
+    }
+
+    const PackHeader& Header() const { return *(const PackHeader*)base; }
+    const PackEntry* Entries() const { return (const PackEntry*)(base + sizeof(PackHeader)); }
+
+    bool Validate(std::string& error) const {
+        const PackHeader& header = Header();
+        if (memcmp(header.magic, PACK_MAGIC, sizeof(header.magic)) != 0 || header.version != PACK_VERSION) {
+            error = "not an asset pack, or an old version";
+            return false;
+        }
+        uint64_t indexSize = sizeof(PackEntry) * (uint64_t)header.count;
+        if (header.fileSize != size || sizeof(PackHeader) + indexSize > size) {
+            error = "pack size does not match its header";
+            return false;
+        }
+        if (PackHash(Entries(), indexSize) != header.indexHash) {
+            error = "pack index checksum mismatch";
+            return false;
+        }
+        for (uint32_t i = 0; i < header.count; i++) {
+            const PackEntry& entry = Entries()[i];
+            if (entry.offset % PACK_ALIGN != 0 || entry.size > size || entry.offset > size - entry.size ||
+                entry.size != (uint64_t)entry.width * entry.height * 4 || entry.path[PACK_PATH_MAX - 1] != '\0') {
+                error = "pack entry out of bounds";
+                return false;
+            }
+        }
+        return true;
+    }
+
+    static bool WriteFile(const char* outPath, const PackHeader& header, const std::vector<PackEntry>& entries,
+                          const std::vector<Image>& images, std::string& error) {
+        // Written beside the target and renamed, so a reader never maps half a pack.
+        std::string temp = std::string(outPath) + ".tmp";
+        FILE* file = fopen(temp.c_str(), "wb");
+        if (!file) {
+            error = "cannot write " + temp;
+            return false;
+        }
+        bool ok = fwrite(&header, sizeof(header), 1, file) == 1;
+        if (!entries.empty()) ok = ok && fwrite(entries.data(), sizeof(PackEntry), entries.size(), file) == entries.size();
+        std::vector<unsigned char> zeros(PACK_ALIGN, 0);
+        uint64_t written = sizeof(header) + sizeof(PackEntry) * entries.size();
+        for (size_t i = 0; ok && i < entries.size(); i++) {
+            ok = fwrite(zeros.data(), 1, entries[i].offset - written, file) == entries[i].offset - written;
+            ok = ok && fwrite(images[i].data, 1, entries[i].size, file) == entries[i].size;
+            written = entries[i].offset + entries[i].size;
+        }
+        if (ok && written < header.fileSize) {
+            ok = fwrite(zeros.data(), 1, header.fileSize - written, file) == header.fileSize - written;
+        }
+        ok = (fclose(file) == 0) && ok;
+        if (ok) {
+            remove(outPath);
+            ok = rename(temp.c_str(), outPath) == 0;
+        }
+        if (!ok) {
+            remove(temp.c_str());
+            error = std::string("failed writing ") + outPath;
+        }
+        return ok;
+    }
+};
+
+#endif
@@ -0,0 +1,106 @@
+#ifndef ASSETS_H
+#define ASSETS_H
+
+#include <raylib.h>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "assetpack.h"
+#include "threadpool.h"
+
+//#####################
+//Asset loader
+//#####################
+// PNG decoding runs on a thread pool; the decoded images come back to the
+// main thread through Poll/Wait, which is the only place textures may be
+// uploaded. Requests are decoded in the order they were made, so whatever
+// gameplay needs first should be requested first. With a pack attached, fresh
+// entries come back as views into the mapped pack and nothing is decoded.
+
+struct DecodedAsset {
+    int id;
+    std::string path;
+    Image image;
+    double decodeMs;
+    int worker;
+    bool mapped;  // image borrows the pack's memory; do not unload it
+};
+
+class AssetLoader {
+public:
+    explicit AssetLoader(int threads = 0) : pack(nullptr), requested(0), delivered(0), pool(threads) {}
+
+    // Lets queued decodes finish before the state they write to goes away,
+    // then frees whatever was never taken.
+    ~AssetLoader() {
+        pool.WaitIdle();
+        for (DecodedAsset& asset : finished) {
+            if (!asset.mapped) UnloadImage(asset.image);
+        }
+    }
+
+    AssetLoader(const AssetLoader&) = delete;
+    AssetLoader& operator=(const AssetLoader&) = delete;
+
+    // The pack must stay open until every mapped image has been uploaded.
+    void UsePack(const AssetPack* assetPack) { pack = assetPack; }
+
+    int Threads() const { return pool.Size(); }
+
+    int Request(const std::string& path) {
+        int id = requested++;
+        pool.Submit([this, id, path](int worker) {
+            const PackEntry* entry = pack ? pack->Find(path) : nullptr;
+            if (entry && !pack->Fresh(*entry)) {
+                TraceLog(LOG_WARNING, "ASSETS: %s changed since the pack was built, decoding it", path.c_str());
+                entry = nullptr;
+            }
+            auto start = std::chrono::steady_clock::now();
+            Image image = entry ? pack->View(*entry) : LoadImage(path.c_str());
+            double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                finished.push_back({id, path, image, entry ? 0.0 : ms, worker, entry != nullptr});
+            }
+            ready.notify_one();
+        });
+        return id;
+    }
+
+    int Outstanding() const { return requested - delivered; }
+
+    // Hands over one finished decode if there is one. Never blocks.
+    bool Poll(DecodedAsset& out) {
+        std::lock_guard<std::mutex> lock(mutex);
+        return Take(out);
+    }
+
+    // Blocks until a decode finishes; false once everything was delivered.
+    bool Wait(DecodedAsset& out) {
+        if (Outstanding() == 0) return false;
+        std::unique_lock<std::mutex> lock(mutex);
+        ready.wait(lock, [this]() { return !finished.empty(); });
+        return Take(out);
+    }
+
+private:
+    const AssetPack* pack;
+    std::mutex mutex;
+    std::condition_variable ready;
+    std::vector<DecodedAsset> finished;
+    int requested;
+    int delivered;
+    ThreadPool pool;  // last, so it is joined before the members its jobs use
+
+    bool Take(DecodedAsset& out) {
+        if (finished.empty()) return false;
+        out = finished.front();
+        finished.erase(finished.begin());
+        delivered++;
+        return true;
+    }
+};
+
+#endif
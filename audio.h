@@ -0,0 +1,341 @@
+#ifndef AUDIO_H
+#define AUDIO_H
+
+#include <raylib.h>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+#include "rng.h"
+#include "spsc.h"
+
+//#####################
+//Audio
+//#####################
+// Sound effects are synthesized at startup and mixed by our own code: every
+// active voice is scaled by its left/right gain and summed into float
+// accumulators, which are clamped to 16-bit stereo at the end. The game thread
+// mixes ahead into a lock-free ring and raylib's audio thread only copies out
+// of it. Synthesis and mixing use plain float arithmetic (no libm), and the
+// Makefile builds with -ffp-contract=off, so the same events give
+// bit-identical output on any build, which the golden check in --audio-bench
+// relies on.
+
+static const int AUDIO_SAMPLE_RATE = 44100;
+static const int AUDIO_BLOCK = 256;  // frames mixed per step
+static const int AUDIO_LANES = 8;
+
+enum SoundId { SOUND_SHOT = 0, SOUND_HIT, SOUND_MISS, SOUND_GAMEOVER, SOUND_COUNT };
+
+//---------------------
+// Synthesis
+//---------------------
+
+struct SoundClip {
+    std::vector<float> samples;  // mono, followed by at least one lane of silence
+    int length;
+};
+
+class SoundBank {
+public:
+    SoundBank() {
+        clips[SOUND_SHOT] = Sweep(0.08f, 1400.0f, 600.0f, 0.35f, true);
+        clips[SOUND_HIT] = Noise(0.15f, 0.5f);
+        clips[SOUND_MISS] = Sweep(0.20f, 220.0f, 110.0f, 0.4f, false);
+        clips[SOUND_GAMEOVER] = GameOver();
+    }
+
+    const SoundClip& Clip(SoundId id) const { return clips[id]; }
+
+private:
+    SoundClip clips[SOUND_COUNT];
+
+    static SoundClip Make(int length) {
+        SoundClip clip;
+        clip.length = length;
+        clip.samples.assign((length + 2 * AUDIO_LANES - 1) / AUDIO_LANES * AUDIO_LANES, 0.0f);
+        return clip;
+    }
+
+    // Square (or triangle) wave sliding linearly between two pitches with a
+    // linear fade out.
+    static SoundClip Sweep(float seconds, float fromHz, float toHz, float gain, bool square) {
+        int length = (int)(seconds * AUDIO_SAMPLE_RATE);
+        SoundClip clip = Make(length);
+        float phase = 0.0f;
+        for (int i = 0; i < length; i++) {
+            float t = (float)i / length;
+            float hz = fromHz + (toHz - fromHz) * t;
+            phase += hz / AUDIO_SAMPLE_RATE;
+            if (phase >= 1.0f) phase -= 1.0f;
+            float wave = square ? (phase < 0.5f ? 1.0f : -1.0f) : (phase < 0.5f ? 4.0f * phase - 1.0f : 3.0f - 4.0f * phase);
+            clip.samples[i] = wave * gain * (1.0f - t);
+        }
+        return clip;
+    }
+
+    static SoundClip Noise(float seconds, float gain) {
+        int length = (int)(seconds * AUDIO_SAMPLE_RATE);
+        SoundClip clip = Make(length);
+        RandomStream rng(0x5EED, 0);
+        float envelope = gain;
+        for (int i = 0; i < length; i++) {
+            clip.samples[i] = (rng.NextFloat() * 2.0f - 1.0f) * envelope;
+            envelope *= 0.9995f;
+        }
+        return clip;
+    }
+
+    // Four falling notes.
+    static SoundClip GameOver() {
+        const float notes[] = {440.0f, 330.0f, 262.0f, 196.0f};
+        const int noteLength = (int)(0.3f * AUDIO_SAMPLE_RATE);
+        SoundClip clip = Make(noteLength * 4);
+        for (int n = 0; n < 4; n++) {
+            float phase = 0.0f;
+            for (int i = 0; i < noteLength; i++) {
+                phase += notes[n] / AUDIO_SAMPLE_RATE;
+                if (phase >= 1.0f) phase -= 1.0f;
+                float fade = 1.0f - (float)i / noteLength;
+                clip.samples[n * noteLength + i] = (phase < 0.5f ? 0.3f : -0.3f) * fade;
+            }
+        }
+        return clip;
+    }
+};
+
+//---------------------
+// Mixing kernels
+//---------------------
+
+// left/right += source * gain over n frames.
+inline void MixVoiceScalar(float* left, float* right, const float* source, int n, float gainL, float gainR) {
+    for (int i = 0; i < n; i++) {
+        left[i] += source[i] * gainL;
+        right[i] += source[i] * gainR;
+    }
+}
+
+#if defined(__GNUC__)
+typedef float AudioVec __attribute__((vector_size(32)));
+
+// Rounds n up to whole lanes. That is safe because the accumulators hold whole
+// lanes and every clip ends in a lane of silence, so the extra lanes add zero.
+inline void MixVoice(float* left, float* right, const float* source, int n, float gainL, float gainR) {
+    const AudioVec gl = {gainL, gainL, gainL, gainL, gainL, gainL, gainL, gainL};
+    const AudioVec gr = {gainR, gainR, gainR, gainR, gainR, gainR, gainR, gainR};
+    for (int i = 0; i < n; i += AUDIO_LANES) {
+        AudioVec s, l, r;
+        memcpy(&s, source + i, sizeof(s));
+        memcpy(&l, left + i, sizeof(l));
+        memcpy(&r, right + i, sizeof(r));
+        l += s * gl;
+        r += s * gr;
+        memcpy(left + i, &l, sizeof(l));
+        memcpy(right + i, &r, sizeof(r));
+    }
+}
+#else
+inline void MixVoice(float* left, float* right, const float* source, int n, float gainL, float gainR) {
+    MixVoiceScalar(left, right, source, n, gainL, gainR);
+}
+#endif
+
+inline int16_t ToS16(float x) {
+    x *= 32767.0f;
+    if (x > 32767.0f) x = 32767.0f;
+    if (x < -32768.0f) x = -32768.0f;
+    return (int16_t)x;
+}
+
+//---------------------
+// Mixer
+//---------------------
+
+class AudioMixer {
+public:
+    float masterGain;
+    bool simd;        // false mixes with the scalar kernel, for comparison
+    bool muted;       // drops new sounds; running voices finish
+
+    explicit AudioMixer(int maxVoices = 64)
+        : masterGain(0.8f), simd(true), muted(false), voices(maxVoices), clock(0) {
+        for (Voice& voice : voices) voice.active = false;
+    }
+
+    int ActiveVoices() const {
+        int n = 0;
+        for (const Voice& voice : voices) n += voice.active;
+        return n;
+    }
+
+    void StopAll() {
+        for (Voice& voice : voices) voice.active = false;
+    }
+
+    // pan is -1 (left) to 1 (right). When every voice is busy the oldest is
+    // replaced, since it is the closest to finishing anyway.
+    void Play(SoundId id, float gain = 1.0f, float pan = 0.0f) {
+        if (muted) return;
+        Voice* slot = &voices[0];
+        for (Voice& voice : voices) {
+            if (!voice.active) {
+                slot = &voice;
+                break;
+            }
+            if (voice.started < slot->started) slot = &voice;
+        }
+        if (pan < -1.0f) pan = -1.0f;
+        if (pan > 1.0f) pan = 1.0f;
+        slot->active = true;
+        slot->clip = &bank.Clip(id);
+        slot->cursor = 0;
+        slot->gainL = gain * (pan > 0.0f ? 1.0f - pan : 1.0f);
+        slot->gainR = gain * (pan < 0.0f ? 1.0f + pan : 1.0f);
+        slot->started = clock++;
+    }
+
+    // Writes `frames` interleaved stereo frames.
+    void Mix(int16_t* out, int frames) {
+        while (frames > 0) {
+            int n = frames < AUDIO_BLOCK ? frames : AUDIO_BLOCK;
+            MixBlock(out, n);
+            out += n * 2;
+            frames -= n;
+        }
+    }
+
+private:
+    struct Voice {
+        bool active;
+        const SoundClip* clip;
+        int cursor;
+        float gainL, gainR;
+        unsigned long started;
+    };
+
+    SoundBank bank;
+    std::vector<Voice> voices;
+    unsigned long clock;
+    float left[AUDIO_BLOCK];
+    float right[AUDIO_BLOCK];
+
+    void MixBlock(int16_t* out, int n) {
+        memset(left, 0, sizeof(left));
+        memset(right, 0, sizeof(right));
+        for (Voice& voice : voices) {
+            if (!voice.active) continue;
+            int remaining = voice.clip->length - voice.cursor;
+            int count = remaining < n ? remaining : n;
+            const float* source = voice.clip->samples.data() + voice.cursor;
+            float gl = voice.gainL * masterGain;
+            float gr = voice.gainR * masterGain;
+            if (simd) {
+                MixVoice(left, right, source, count, gl, gr);
+            } else {
+                MixVoiceScalar(left, right, source, count, gl, gr);
+            }
+            voice.cursor += n;
+            if (voice.cursor >= voice.clip->length) voice.active = false;
+        }
+        for (int i = 0; i < n; i++) {
+            out[2 * i] = ToS16(left[i]);
+            out[2 * i + 1] = ToS16(right[i]);
+        }
+    }
+};
+
+//---------------------
+// Device output
+//---------------------
+// The game thread calls Pump once a frame to keep the ring topped up; the
+// device callback drains it and plays silence on underrun. raylib's callback
+// takes no user pointer, hence the single active instance.
+
+class AudioOutput {
+public:
+    int latencyFrames;  // how far ahead of the device Pump mixes
+
+    AudioOutput() : latencyFrames(2048), ring(16384), mixer(nullptr), running(false), underruns(0) {}
+    ~AudioOutput() { Stop(); }
+
+    bool Start(AudioMixer* source) {
+        InitAudioDevice();
+        if (!IsAudioDeviceReady()) {
+            CloseAudioDevice();
+            return false;
+        }
+        mixer = source;
+        Active() = this;
+        SetAudioStreamBufferSizeDefault(AUDIO_BLOCK * 2);
+        stream = LoadAudioStream(AUDIO_SAMPLE_RATE, 16, 2);
+        Pump();
+        SetAudioStreamCallback(stream, Callback);
+        PlayAudioStream(stream);
+        running = true;
+        return true;
+    }
+
+    void Stop() {
+        if (!running) return;
+        StopAudioStream(stream);
+        UnloadAudioStream(stream);
+        CloseAudioDevice();
+        Active() = nullptr;
+        running = false;
+        paused = false;
+    }
+
+    bool Running() const { return running; }
+
+    // While nothing plays the device need not pull silence from the ring.
+    void Pause() {
+        if (!running || paused) return;
+        PauseAudioStream(stream);
+        paused = true;
+    }
+
+    // Tops the ring up before the device starts pulling again.
+    void Resume() {
+        if (!running || !paused) return;
+        Pump();
+        ResumeAudioStream(stream);
+        paused = false;
+    }
+
+    long Underruns() const { return underruns.load(std::memory_order_relaxed); }
+
+    void Pump() {
+        int16_t block[AUDIO_BLOCK * 2];
+        while ((int)(ring.Available() / 2) + AUDIO_BLOCK <= latencyFrames) {
+            mixer->Mix(block, AUDIO_BLOCK);
+            ring.Push(block, AUDIO_BLOCK * 2);
+        }
+    }
+
+private:
+    AudioStream stream;
+    SpscRing<int16_t> ring;
+    AudioMixer* mixer;
+    bool running;
+    bool paused = false;
+    std::atomic<long> underruns;
+
+    static AudioOutput*& Active() {
+        static AudioOutput* instance = nullptr;
+        return instance;
+    }
+
+    static void Callback(void* data, unsigned int frames) {
+        AudioOutput* active = Active();
+        int16_t* out = (int16_t*)data;
+        size_t wanted = (size_t)frames * 2;
+        size_t got = active ? active->ring.Pop(out, wanted) : 0;
+        if (got < wanted) {
+            memset(out + got, 0, (wanted - got) * sizeof(int16_t));
+            if (active) active->underruns.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+};
+
+#endif
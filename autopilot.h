@@ -0,0 +1,293 @@
+#ifndef AUTOPILOT_H
+#define AUTOPILOT_H
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+#include "rng.h"
+
+//#####################
+//Autopilot
+//#####################
+// Plays the game through the same fly/fall/shoot commands as a player.
+// Obstacles only move in straight lines, so their positions over the next
+// couple of seconds are known up front. Each tick the planner turns them into
+// the ship heights that are blocked at every future tick, then searches
+// fly/fall sequences against that map with the ship's own flight physics.
+// Candidates keep the start of the best plan so far and from some tick on
+// hold a new height, which is how a player threads a gap. The search is
+// anytime: it starts from last tick's best plan, shifted by one tick, and
+// keeps trying candidates until the next one would overrun the time budget.
+// Whatever is best when time runs out gets played.
+
+struct PilotShip {
+    float x, y, w, h;
+    float velocity;
+    float acceleration, deceleration;
+};
+
+struct PilotObstacle {
+    float x, y, w, h, vx;
+};
+
+struct PilotParams {
+    int horizon = 180;           // ticks looked ahead
+    float budgetUs = 500.0f;     // planning time per tick
+    int maxCandidates = 0;       // also stop after this many, 0 for no limit; makes runs repeatable
+    float margin = 4.0f;         // px added around obstacles for drift in their positions
+    float fieldWidth = 1280.0f;
+    float fieldHeight = 720.0f;
+    float bulletSpeed = 500.0f;
+    float bulletRadius = 5.0f;
+    float shotInterval = 0.1f;  // seconds between shots
+};
+
+struct PilotDecision {
+    bool fly;
+    bool shoot;
+};
+
+struct PilotMetrics {
+    long ticks = 0;
+    long candidates = 0;
+    long kept = 0;        // ticks where the shifted plan stayed best
+    long overBudget = 0;
+    double planUsSum = 0.0;
+    double planUsMax = 0.0;
+    double lastPlanUs = 0.0;
+    int lastCandidates = 0;
+
+    double PlanUsMean() const { return ticks ? planUsSum / ticks : 0.0; }
+    double CandidatesMean() const { return ticks ? (double)candidates / ticks : 0.0; }
+};
+
+class Autopilot {
+public:
+    PilotParams params;
+
+    explicit Autopilot(uint64_t seed = 0, uint64_t stream = 0) : shotTimer(0.0f), evalUs(1.0f) {
+        rng.Seed(seed, stream);
+    }
+
+    void Reset() {
+        best.clear();
+        shotTimer = 0.0f;
+    }
+
+    const PilotMetrics& Metrics() const { return metrics; }
+
+    // Returns this tick's controls. dt is the fixed step the game advances by.
+    PilotDecision Plan(const PilotShip& ship, const std::vector<PilotObstacle>& obstacles, float dt) {
+        auto start = std::chrono::steady_clock::now();
+        auto elapsedUs = [&start]() {
+            return std::chrono::duration<float, std::micro>(std::chrono::steady_clock::now() - start).count();
+        };
+        const int horizon = std::max(1, params.horizon);
+
+        BuildBlocked(ship, obstacles, dt, horizon);
+        aimY = AimHeight(ship, obstacles);
+
+        // Last tick's plan, one tick on.
+        if ((int)best.size() != horizon) {
+            best.assign(horizon, 0);
+        } else {
+            std::rotate(best.begin(), best.begin() + 1, best.end());
+            best[horizon - 1] = best[std::max(0, horizon - 2)];
+        }
+        int bestCrash;
+        float bestValue = Evaluate(ship, best, dt, bestCrash);
+        int candidates = 1;
+        bool improved = false;
+
+        // Two candidates' worth plus a twentieth of the budget stay in hand
+        // for the shot check and for candidates that run long.
+        const float stopUs = params.budgetUs * 0.95f;
+        const int heights = std::max(1, (int)(params.fieldHeight - ship.h));
+        for (int n = 0; elapsedUs() + 2.0f * evalUs <= stopUs; n++) {
+            if (params.maxCandidates > 0 && candidates >= params.maxCandidates) break;
+            float before = elapsedUs();
+            if (n < HOLD_SEEDS) {
+                // Every height from now, spread over the field.
+                Hold(ship, 0, heights * (n + 0.5f) / HOLD_SEEDS, dt);
+            } else if (rng.Range(0, 3) > 0) {
+                // A doomed plan has to change before it crashes.
+                Hold(ship, rng.Range(0, std::max(0, bestCrash - 1)), (float)rng.Range(0, heights), dt);
+            } else {
+                candidate = best;
+                int from = rng.Range(0, std::max(0, bestCrash - 1));
+                int to = std::min(horizon, from + rng.Range(1, std::max(1, horizon / 4)));
+                uint8_t fly = (uint8_t)rng.Range(0, 1);
+                for (int t = from; t < to; t++) candidate[t] = fly;
+            }
+            int crash;
+            float value = Evaluate(ship, candidate, dt, crash);
+            // Clamped so one preempted candidate cannot talk the search out
+            // of running at all.
+            float cost = std::min(elapsedUs() - before, 4.0f * evalUs);
+            evalUs += (cost - evalUs) * 0.1f;
+            candidates++;
+            if (value > bestValue) {
+                bestValue = value;
+                bestCrash = crash;
+                best.swap(candidate);
+                improved = true;
+            }
+        }
+
+        PilotDecision decision = {best[0] != 0, false};
+        shotTimer -= dt;
+        if (shotTimer <= 0.0f && InLineOfFire(ship, obstacles, decision.fly, dt)) {
+            decision.shoot = true;
+            shotTimer = params.shotInterval;
+        }
+
+        double us = elapsedUs();
+        metrics.ticks++;
+        metrics.candidates += candidates;
+        metrics.kept += !improved;
+        metrics.overBudget += us > params.budgetUs;
+        metrics.planUsSum += us;
+        metrics.planUsMax = std::max(metrics.planUsMax, us);
+        metrics.lastPlanUs = us;
+        metrics.lastCandidates = candidates;
+        return decision;
+    }
+
+private:
+    static const int HOLD_SEEDS = 8;
+
+    // Ship top heights in (lo, hi) collide.
+    struct Span {
+        float lo, hi;
+    };
+
+    // An obstacle's span over the ticks it shares the ship's x range.
+    struct Window {
+        int first, last;
+        float lo, hi;
+    };
+
+    std::vector<Window> windows;
+    std::vector<Span> spans;     // grouped by tick
+    std::vector<int> firstSpan;  // spans of tick t are [firstSpan[t], firstSpan[t + 1])
+    std::vector<int> fill;
+    std::vector<uint8_t> best, candidate;
+    RandomStream rng;
+    PilotMetrics metrics;
+    float shotTimer;
+    float evalUs;  // running mean cost of one candidate
+    float aimY;
+
+    // Counts spans per tick, then places them, so no sort is needed.
+    void BuildBlocked(const PilotShip& ship, const std::vector<PilotObstacle>& obstacles, float dt, int horizon) {
+        const float m = params.margin;
+        windows.clear();
+        firstSpan.assign(horizon + 2, 0);
+        for (const PilotObstacle& o : obstacles) {
+            if (o.vx >= 0.0f) continue;
+            float step = -o.vx * dt;
+            // Ticks where the obstacle's x span overlaps the ship's.
+            int first = std::max(1, (int)std::ceil((o.x - m - (ship.x + ship.w)) / step));
+            int last = std::min(horizon, (int)std::floor((o.x + o.w + m - ship.x) / step));
+            if (first > last) continue;
+            windows.push_back({first, last, o.y - ship.h - m, o.y + o.h + m});
+            for (int t = first; t <= last; t++) firstSpan[t + 1]++;
+        }
+        for (int t = 1; t <= horizon + 1; t++) firstSpan[t] += firstSpan[t - 1];
+        spans.resize(firstSpan[horizon + 1]);
+        fill.assign(firstSpan.begin(), firstSpan.end() - 1);
+        for (const Window& w : windows) {
+            for (int t = w.first; t <= w.last; t++) spans[fill[t]++] = {w.lo, w.hi};
+        }
+    }
+
+    // Centre of the nearest obstacle ahead, so idle time is spent lined up
+    // for a shot. The middle of the field when there is none.
+    float AimHeight(const PilotShip& ship, const std::vector<PilotObstacle>& obstacles) const {
+        const PilotObstacle* target = nullptr;
+        for (const PilotObstacle& o : obstacles) {
+            if (o.x < ship.x + ship.w) continue;
+            if (!target || o.x < target->x) target = &o;
+        }
+        return target ? target->y + target->h / 2 : params.fieldHeight / 2;
+    }
+
+    // Same steps as Ship::Fly.
+    void FlyStep(float& y, float& velocity, const PilotShip& ship, bool fly, float dt) const {
+        if (fly) {
+            velocity -= ship.acceleration * dt;
+        } else {
+            velocity += ship.deceleration * dt;
+        }
+        y += velocity * dt;
+        if (y < 0) {
+            y = 0;
+            velocity = 0;
+        } else if (y + ship.h > params.fieldHeight) {
+            y = params.fieldHeight - ship.h;
+            velocity = 0;
+        }
+    }
+
+    // candidate = the best plan up to tick `from`, then whatever chases a
+    // ship top height of `target`: fly while falling faster than the speed
+    // that would close the gap in a quarter second.
+    void Hold(const PilotShip& ship, int from, float target, float dt) {
+        const int horizon = (int)best.size();
+        candidate.resize(horizon);
+        float y = ship.y, velocity = ship.velocity;
+        for (int t = 0; t < horizon; t++) {
+            if (t >= from) {
+                float wanted = std::max(-400.0f, std::min(400.0f, (target - y) * 4.0f));
+                candidate[t] = velocity > wanted;
+            } else {
+                candidate[t] = best[t];
+            }
+            FlyStep(y, velocity, ship, candidate[t] != 0, dt);
+        }
+    }
+
+    // A crash costs far more than any amount of aiming, and a later crash
+    // less than an earlier one. crash is the index of the crashing step, or
+    // the horizon when there is none.
+    float Evaluate(const PilotShip& ship, const std::vector<uint8_t>& plan, float dt, int& crash) const {
+        const int horizon = (int)plan.size();
+        float y = ship.y, velocity = ship.velocity;
+        float value = 0.0f;
+        for (int t = 0; t < horizon; t++) {
+            FlyStep(y, velocity, ship, plan[t] != 0, dt);
+            for (int s = firstSpan[t + 1]; s < firstSpan[t + 2]; s++) {
+                if (y > spans[s].lo && y < spans[s].hi) {
+                    crash = t;
+                    return value - 1.0e6f * (horizon - t);
+                }
+            }
+            value -= std::fabs(y + ship.h / 2 - aimY) / params.fieldHeight;
+        }
+        crash = horizon;
+        return value;
+    }
+
+    // Whether a bullet fired after this tick's move would hit something
+    // before leaving the field.
+    bool InLineOfFire(const PilotShip& ship, const std::vector<PilotObstacle>& obstacles, bool fly, float dt) const {
+        float y = ship.y, velocity = ship.velocity;
+        FlyStep(y, velocity, ship, fly, dt);
+        const float bx = ship.x + ship.w;
+        const float by = y + ship.h / 2;
+        const float r = params.bulletRadius;
+        for (const PilotObstacle& o : obstacles) {
+            if (o.x + o.w < bx) continue;
+            if (by - r >= o.y + o.h || by + r <= o.y) continue;
+            float closing = params.bulletSpeed - o.vx;
+            if (closing <= 0.0f) continue;
+            float t = std::max(0.0f, o.x - bx) / closing;
+            if (bx + params.bulletSpeed * t <= params.fieldWidth) return true;
+        }
+        return false;
+    }
+};
+
+#endif
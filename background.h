@@ -0,0 +1,147 @@
+#ifndef BACKGROUND_H
+#define BACKGROUND_H
+
+#include <raylib.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+#include "rng.h"
+
+//#####################
+//Parallax background
+//#####################
+// Layers of decorative sprites, each scrolling at a fraction of the game's
+// speed. A layer is cut into chunks of fixed width, and a chunk's sprites
+// come from a random stream of its own, so a chunk can be dropped and made
+// again identically. A layer has just enough slots to cover the screen. When
+// the scroll brings a new chunk in, it is generated into the slot of the one
+// that left, reusing its storage. After the first frames nothing is allocated,
+// and a frame costs the same however far the game has scrolled. Positions are
+// kept relative to the chunk, and only the chunk's start is worked out in
+// double, so sprites do not start to jitter after a long run.
+
+struct ParallaxLayerParams {
+    float factor;            // of the scroll speed
+    float chunkWidth;        // px
+    int sprites;             // per chunk
+    float sizeMin, sizeMax;  // px
+    float top, bottom;       // band the sprites sit in, as fractions of the height
+    Color tint;
+};
+
+struct BackgroundSprite {
+    float x;     // from the chunk's left edge
+    float band;  // 0 at the top of the layer's band, 1 at the bottom
+    float size;
+    unsigned char alpha;
+};
+
+struct BackgroundQuad {
+    float x, y;
+    float size;
+    Color color;
+};
+
+struct ParallaxMetrics {
+    long generated = 0;  // chunks made, first fills included
+    int slots = 0;       // chunk slots over all layers
+    int lastQuads = 0;
+};
+
+class ParallaxBackground {
+public:
+    void Configure(const std::vector<ParallaxLayerParams>& params, uint64_t seed) {
+        layers.clear();
+        for (const ParallaxLayerParams& p : params) {
+            Layer layer;
+            layer.params = p;
+            layers.push_back(layer);
+        }
+        backgroundSeed = seed;
+        distance = 0.0;
+        metrics = ParallaxMetrics();
+    }
+
+    void Scroll(double px) { distance += px; }
+    double Distance() const { return distance; }
+    void SetDistance(double px) { distance = px; }
+
+    const ParallaxMetrics& Metrics() const { return metrics; }
+
+    // Replaces out with the sprites that overlap [0, width) x [0, height),
+    // far layers first. keep is the fraction of layers to draw; the farthest
+    // ones are left out first.
+    void BuildDrawList(std::vector<BackgroundQuad>& out, int width, int height, float keep = 1.0f) {
+        out.clear();
+        const float w = (float)width;
+        const int count = (int)layers.size();
+        const int skipped = count - (int)std::ceil(std::clamp(keep, 0.0f, 1.0f) * count);
+        for (int l = skipped; l < count; l++) {
+            Layer& layer = layers[l];
+            const ParallaxLayerParams& p = layer.params;
+            // A sprite may hang up to sizeMax over its chunk's right edge.
+            int needed = (int)std::ceil((w + p.sizeMax) / p.chunkWidth) + 1;
+            if ((int)layer.slots.size() < needed) {
+                metrics.slots += needed - (int)layer.slots.size();
+                layer.slots.resize(needed);
+            }
+            const double offset = distance * p.factor;
+            const int64_t first = (int64_t)std::floor((offset - p.sizeMax) / p.chunkWidth);
+            const int64_t last = (int64_t)std::floor((offset + w) / p.chunkWidth);
+            const float top = p.top * height;
+            const float span = (p.bottom - p.top) * height;
+            for (int64_t index = first; index <= last; index++) {
+                Chunk& chunk = layer.slots[(size_t)(((index % needed) + needed) % needed)];
+                if (!chunk.filled || chunk.index != index) Generate(chunk, l, index);
+                const float start = (float)(index * (double)p.chunkWidth - offset);
+                for (const BackgroundSprite& s : chunk.sprites) {
+                    float x = start + s.x;
+                    if (x + s.size <= 0.0f || x >= w) continue;
+                    Color c = p.tint;
+                    c.a = s.alpha;
+                    out.push_back({x, top + s.band * (span - s.size), s.size, c});
+                }
+            }
+        }
+        metrics.lastQuads = (int)out.size();
+    }
+
+private:
+    struct Chunk {
+        int64_t index = 0;
+        bool filled = false;
+        std::vector<BackgroundSprite> sprites;
+    };
+
+    struct Layer {
+        ParallaxLayerParams params;
+        std::vector<Chunk> slots;
+    };
+
+    std::vector<Layer> layers;
+    uint64_t backgroundSeed = 0;
+    double distance = 0.0;  // px scrolled at factor 1
+    ParallaxMetrics metrics;
+
+    // Sprites sit on a jittered grid across the chunk, so every stretch of a
+    // layer holds about as many as any other.
+    void Generate(Chunk& chunk, int layer, int64_t index) {
+        const ParallaxLayerParams& p = layers[layer].params;
+        RandomStream rng(backgroundSeed + 0x9E3779B97F4A7C15ull * (uint64_t)(layer + 1), (uint64_t)index);
+        chunk.sprites.resize(p.sprites);
+        const float cell = p.chunkWidth / p.sprites;
+        for (int i = 0; i < p.sprites; i++) {
+            BackgroundSprite& s = chunk.sprites[i];
+            s.x = (i + rng.NextFloat()) * cell;
+            s.band = rng.NextFloat();
+            s.size = p.sizeMin + (p.sizeMax - p.sizeMin) * rng.NextFloat() * rng.NextFloat();
+            s.alpha = (unsigned char)(p.tint.a * (0.5f + 0.5f * rng.NextFloat()));
+        }
+        chunk.index = index;
+        chunk.filled = true;
+        metrics.generated++;
+    }
+};
+
+#endif
@@ -0,0 +1,239 @@
+#ifndef BOSS_H
+#define BOSS_H
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+//#####################
+//Boss
+//#####################
+// One big enemy made of small square plates that move and turn together as
+// a rigid body. The plates sit in a bounding volume hierarchy built once over
+// their positions in the boss's own frame. The tree never changes shape:
+// Refit recomputes the world boxes from the leaves up each tick, which is
+// linear, and stays tight because the body is rigid. A destroyed plate drops
+// out of its leaf's box at the next refit, and a subtree with nothing left
+// gets an empty box that no query enters. Build numbers the plates in leaf
+// order, so a left-first walk meets the lowest-numbered hit first and can
+// stop there, which is also what a scan over every plate returns.
+
+struct BossPart {
+    float lx, ly;  // centre in the boss frame
+    float half;    // half the side
+    bool alive;
+};
+
+struct BossNode {
+    float minX, minY, maxX, maxY;
+    int right;         // second child; the first is the next node
+    int first, count;  // plates of a leaf, count 0 for inner nodes
+};
+
+static const int BOSS_LEAF_PARTS = 4;
+
+// `count` plates of side `plate` packed into a disc, nearest the centre first.
+inline std::vector<BossPart> BossDisc(int count, float plate) {
+    int side = 1;
+    while (side * side * 0.78f < count) side += 2;
+    std::vector<BossPart> parts;
+    for (int row = 0; row < side; row++) {
+        for (int col = 0; col < side; col++) {
+            float lx = (col - (side - 1) / 2.0f) * plate;
+            float ly = (row - (side - 1) / 2.0f) * plate;
+            parts.push_back({lx, ly, plate / 2, true});
+        }
+    }
+    std::stable_sort(parts.begin(), parts.end(), [](const BossPart& a, const BossPart& b) {
+        return a.lx * a.lx + a.ly * a.ly < b.lx * b.lx + b.ly * b.ly;
+    });
+    parts.resize(std::min((int)parts.size(), count));
+    return parts;
+}
+
+class Boss {
+public:
+    float x = 0.0f, y = 0.0f;  // centre
+    float angle = 0.0f;        // radians
+    float vx = 0.0f;           // px/s
+    float spin = 0.0f;         // radians/s
+    bool active = false;
+
+    // Reorders the plates so that every leaf holds a contiguous run.
+    void Build(std::vector<BossPart> layout) {
+        parts = std::move(layout);
+        nodes.clear();
+        radius = 0.0f;
+        for (const BossPart& part : parts) {
+            radius = std::max(radius, std::sqrt(part.lx * part.lx + part.ly * part.ly) + part.half * 1.4143f);
+        }
+        alive = 0;
+        for (const BossPart& part : parts) alive += part.alive;
+        if (!parts.empty()) BuildNode(0, (int)parts.size());
+        Refit();
+    }
+
+    int PartCount() const { return (int)parts.size(); }
+    int Alive() const { return alive; }
+    int NodeCount() const { return (int)nodes.size(); }
+    float Radius() const { return radius; }
+    const BossPart& Part(int i) const { return parts[i]; }
+
+    // Call after moving, before any query.
+    void Refit() {
+        c = std::cos(angle);
+        s = std::sin(angle);
+        const float inf = std::numeric_limits<float>::infinity();
+        for (int i = (int)nodes.size() - 1; i >= 0; i--) {
+            BossNode& node = nodes[i];
+            node.minX = node.minY = inf;
+            node.maxX = node.maxY = -inf;
+            if (node.count > 0) {
+                for (int p = node.first; p < node.first + node.count; p++) {
+                    if (!parts[p].alive) continue;
+                    float minX, minY, maxX, maxY;
+                    PartBox(p, minX, minY, maxX, maxY);
+                    node.minX = std::min(node.minX, minX);
+                    node.minY = std::min(node.minY, minY);
+                    node.maxX = std::max(node.maxX, maxX);
+                    node.maxY = std::max(node.maxY, maxY);
+                }
+            } else {
+                const BossNode& a = nodes[i + 1];
+                const BossNode& b = nodes[node.right];
+                node.minX = std::min(a.minX, b.minX);
+                node.minY = std::min(a.minY, b.minY);
+                node.maxX = std::max(a.maxX, b.maxX);
+                node.maxY = std::max(a.maxY, b.maxY);
+            }
+        }
+    }
+
+    // Empty (min above max) once every plate is gone.
+    const BossNode& Bounds() const { return nodes[0]; }
+
+    void Destroy(int part) {
+        if (!parts[part].alive) return;
+        parts[part].alive = false;
+        alive--;
+    }
+
+    // World box of a plate in the pose of the last Refit.
+    void PartBox(int p, float& minX, float& minY, float& maxX, float& maxY) const {
+        const BossPart& part = parts[p];
+        float wx = x + part.lx * c - part.ly * s;
+        float wy = y + part.lx * s + part.ly * c;
+        float extent = part.half * (std::fabs(c) + std::fabs(s));
+        minX = wx - extent;
+        minY = wy - extent;
+        maxX = wx + extent;
+        maxY = wy + extent;
+    }
+
+    // Lowest live plate the circle overlaps, or -1. visited counts the nodes
+    // whose box was tested.
+    int FirstCircleHit(float cx, float cy, float r, int* visited = nullptr) const {
+        float px, py;
+        ToLocal(cx, cy, px, py);
+        return Walk(cx - r, cy - r, cx + r, cy + r, visited,
+                    [&](int p) { return CircleHitsPart(p, px, py, r); });
+    }
+
+    // Lowest live plate whose world box overlaps the rectangle, or -1. Boxes
+    // rather than the turned squares, which is close enough for plates this
+    // small against the ship.
+    int FirstBoxHit(float bx, float by, float bw, float bh) const {
+        return Walk(bx, by, bx + bw, by + bh, nullptr, [&](int p) {
+            float minX, minY, maxX, maxY;
+            PartBox(p, minX, minY, maxX, maxY);
+            return bx < maxX && bx + bw > minX && by < maxY && by + bh > minY;
+        });
+    }
+
+    // Same answer as FirstCircleHit, by testing every plate.
+    int ScanCircleHit(float cx, float cy, float r) const {
+        float px, py;
+        ToLocal(cx, cy, px, py);
+        for (int p = 0; p < (int)parts.size(); p++) {
+            if (parts[p].alive && CircleHitsPart(p, px, py, r)) return p;
+        }
+        return -1;
+    }
+
+private:
+    std::vector<BossPart> parts;
+    std::vector<BossNode> nodes;
+    int alive = 0;
+    float radius = 0.0f;
+    float c = 1.0f, s = 0.0f;  // of angle at the last Refit
+
+    // Median split on the longer side of the plate centres.
+    int BuildNode(int first, int last) {
+        int index = (int)nodes.size();
+        nodes.push_back({0.0f, 0.0f, 0.0f, 0.0f, -1, first, 0});
+        if (last - first <= BOSS_LEAF_PARTS) {
+            nodes[index].count = last - first;
+            return index;
+        }
+        float minX = parts[first].lx, maxX = minX, minY = parts[first].ly, maxY = minY;
+        for (int p = first + 1; p < last; p++) {
+            minX = std::min(minX, parts[p].lx);
+            maxX = std::max(maxX, parts[p].lx);
+            minY = std::min(minY, parts[p].ly);
+            maxY = std::max(maxY, parts[p].ly);
+        }
+        bool alongX = maxX - minX >= maxY - minY;
+        int middle = (first + last) / 2;
+        std::nth_element(parts.begin() + first, parts.begin() + middle, parts.begin() + last,
+                         [alongX](const BossPart& a, const BossPart& b) { return alongX ? a.lx < b.lx : a.ly < b.ly; });
+        BuildNode(first, middle);
+        int right = BuildNode(middle, last);
+        nodes[index].right = right;
+        return index;
+    }
+
+    void ToLocal(float wx, float wy, float& lx, float& ly) const {
+        float dx = wx - x, dy = wy - y;
+        lx = dx * c + dy * s;
+        ly = -dx * s + dy * c;
+    }
+
+    bool CircleHitsPart(int p, float px, float py, float r) const {
+        const BossPart& part = parts[p];
+        float qx = std::max(part.lx - part.half, std::min(px, part.lx + part.half));
+        float qy = std::max(part.ly - part.half, std::min(py, part.ly + part.half));
+        float dx = px - qx, dy = py - qy;
+        return dx * dx + dy * dy < r * r;
+    }
+
+    template <typename Hit>
+    int Walk(float minX, float minY, float maxX, float maxY, int* visited, Hit hit) const {
+        if (nodes.empty()) return -1;
+        int stack[64];
+        int top = 0;
+        int tested = 0;
+        stack[top++] = 0;
+        while (top > 0) {
+            const int i = stack[--top];
+            const BossNode& node = nodes[i];
+            tested++;
+            if (minX >= node.maxX || maxX <= node.minX || minY >= node.maxY || maxY <= node.minY) continue;
+            if (node.count > 0) {
+                for (int p = node.first; p < node.first + node.count; p++) {
+                    if (parts[p].alive && hit(p)) {
+                        if (visited) *visited = tested;
+                        return p;
+                    }
+                }
+                continue;
+            }
+            stack[top++] = node.right;
+            stack[top++] = i + 1;
+        }
+        if (visited) *visited = tested;
+        return -1;
+    }
+};
+
+#endif
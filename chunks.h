@@ -0,0 +1,437 @@
+#ifndef CHUNKS_H
+#define CHUNKS_H
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "rng.h"
+#include "spsc.h"
+
+//#####################
+//Level chunks
+//#####################
+// The level is cut into chunks of a few seconds each. A worker thread lays
+// chunks out ahead of play and hands them over through a lock-free ring; the
+// sim thread only pops finished chunks, spawns from them when their time
+// comes and pushes them back through a second ring to be refilled. A chunk
+// depends on nothing but the level seed and its index, so any chunk can be
+// generated again on any thread with the same result. Balancing and the
+// solvability check happen on the worker.
+
+struct ChunkKindSpec {
+    float weight;               // relative share of spawns
+    float vxMin, vxMax;         // px/s
+    float scaleMin, scaleMax;
+    float width, height;        // texture size at scale 1
+};
+
+struct ChunkParams {
+    float duration = 8.0f;       // seconds of level per chunk
+    float fieldWidth = 1280.0f;
+    float fieldHeight = 720.0f;
+    float shipX = 200.0f;
+    float shipWidth = 60.0f;
+    float shipHeight = 40.0f;
+    float shipClimb = 360.0f;    // px/s the ship can cover vertically, for the solvability check
+    float density = 1.8f;        // spawns per second in chunk 0
+    float densityGrowth = 0.1f;  // added per chunk
+    float densityMax = 3.5f;
+    float window = 1.0f;         // balancing window, seconds
+    float windowMax = 2.0f;      // at most this times the mean spawns per window
+    int attempts = 4;            // layouts tried before blockers are removed
+    float cell = 8.0f;           // solvability grid, px
+    float step = 1.0f / 30.0f;   // solvability time step, s
+    std::vector<ChunkKindSpec> kinds;
+};
+
+struct ChunkSpawn {
+    float time;  // seconds after the chunk starts
+    int kind;
+    float y, vx, scale;
+};
+
+struct LevelChunk {
+    uint64_t index = 0;
+    double start = 0.0;          // level time of the first moment of the chunk
+    std::vector<ChunkSpawn> spawns;  // sorted by time
+    int attempts = 0;
+    int moved = 0;               // spawns the balancer moved to a sparser window
+    int removed = 0;             // blockers dropped after every attempt failed
+    double generateMs = 0.0;
+    std::chrono::steady_clock::time_point ready;
+
+    uint64_t Hash() const {
+        uint64_t h = 0xcbf29ce484222325ull ^ index;
+        for (const ChunkSpawn& s : spawns) {
+            uint32_t words[5];
+            memcpy(&words[0], &s.time, 4);
+            words[1] = (uint32_t)s.kind;
+            memcpy(&words[2], &s.y, 4);
+            memcpy(&words[3], &s.vx, 4);
+            memcpy(&words[4], &s.scale, 4);
+            for (uint32_t w : words) h = (h ^ w) * 0x100000001b3ull;
+        }
+        return h;
+    }
+};
+
+//---------------------
+// Layout
+//---------------------
+
+// Moves spawns out of windows holding more than their share into the sparsest
+// window. Returns how many moved.
+inline int BalanceChunk(std::vector<ChunkSpawn>& spawns, const ChunkParams& params, RandomStream& rng) {
+    int windows = std::max(1, (int)(params.duration / params.window));
+    float width = params.duration / windows;
+    int cap = std::max(1, (int)(params.windowMax * spawns.size() / windows + 0.5f));
+    std::vector<int> counts(windows, 0);
+    auto windowOf = [&](float t) { return std::min(windows - 1, (int)(t / width)); };
+    for (const ChunkSpawn& s : spawns) counts[windowOf(s.time)]++;
+    int moved = 0;
+    for (ChunkSpawn& s : spawns) {
+        int w = windowOf(s.time);
+        if (counts[w] <= cap) continue;
+        int sparsest = (int)(std::min_element(counts.begin(), counts.end()) - counts.begin());
+        if (counts[sparsest] >= cap) break;
+        counts[w]--;
+        counts[sparsest]++;
+        s.time = (sparsest + rng.NextFloat()) * width;
+        moved++;
+    }
+    std::stable_sort(spawns.begin(), spawns.end(), [](const ChunkSpawn& a, const ChunkSpawn& b) { return a.time < b.time; });
+    return moved;
+}
+
+// Steps through the chunk on a grid of ship heights at the ship's column: a
+// height stays reachable if one within climbing distance was reachable the step
+// before and no obstacle covers it now. Only the chunk's own obstacles are
+// considered. Returns -1 if some height survives to the end, otherwise the
+// step at which none did.
+inline int FirstBlockedStep(const std::vector<ChunkSpawn>& spawns, const ChunkParams& params) {
+    int cells = std::max(1, (int)((params.fieldHeight - params.shipHeight) / params.cell) + 1);
+    int reach = std::max(1, (int)(params.shipClimb * params.step / params.cell + 0.5f));
+    float spawnX = params.fieldWidth + 50.0f;
+
+    // Each obstacle blocks a run of cells for a run of steps.
+    struct Block {
+        int firstStep, lastStep, firstCell, lastCell;
+    };
+    std::vector<Block> blocks;
+    int steps = 0;
+    for (const ChunkSpawn& s : spawns) {
+        const ChunkKindSpec& kind = params.kinds[s.kind];
+        float w = kind.width * s.scale;
+        float h = kind.height * s.scale;
+        float speed = -s.vx;
+        if (speed <= 0.0f) continue;
+        float enter = s.time + (spawnX - (params.shipX + params.shipWidth)) / speed;
+        float leave = s.time + (spawnX + w - params.shipX) / speed;
+        Block b;
+        b.firstStep = (int)(enter / params.step);
+        b.lastStep = (int)(leave / params.step);
+        b.firstCell = std::max(0, (int)((s.y - params.shipHeight) / params.cell) + 1);
+        b.lastCell = std::min(cells - 1, (int)((s.y + h) / params.cell));
+        if (b.firstCell > b.lastCell) continue;
+        blocks.push_back(b);
+        steps = std::max(steps, b.lastStep + 1);
+    }
+    std::sort(blocks.begin(), blocks.end(), [](const Block& a, const Block& b) { return a.firstStep < b.firstStep; });
+
+    std::vector<uint8_t> reachable(cells, 1), next(cells), blocked(cells);
+    std::vector<int> prefix(cells + 1);
+    size_t firstActive = 0;
+    for (int step = 0; step < steps; step++) {
+        std::fill(blocked.begin(), blocked.end(), 0);
+        while (firstActive < blocks.size() && blocks[firstActive].lastStep < step) firstActive++;
+        for (size_t i = firstActive; i < blocks.size() && blocks[i].firstStep <= step; i++) {
+            if (blocks[i].lastStep < step) continue;
+            for (int c = blocks[i].firstCell; c <= blocks[i].lastCell; c++) blocked[c] = 1;
+        }
+        for (int c = 0; c < cells; c++) prefix[c + 1] = prefix[c] + reachable[c];
+        bool any = false;
+        for (int c = 0; c < cells; c++) {
+            int lo = std::max(0, c - reach);
+            int hi = std::min(cells, c + reach + 1);
+            next[c] = !blocked[c] && prefix[hi] > prefix[lo];
+            any |= next[c];
+        }
+        if (!any) return step;
+        reachable.swap(next);
+    }
+    return -1;
+}
+
+// Lays chunk index out into chunk, reusing its spawn storage.
+inline void GenerateChunk(uint64_t seed, uint64_t stream, uint64_t index, const ChunkParams& params, LevelChunk& chunk) {
+    auto started = std::chrono::steady_clock::now();
+    chunk.index = index;
+    chunk.start = index * (double)params.duration;
+    chunk.spawns.clear();
+    chunk.attempts = 0;
+    chunk.moved = 0;
+    chunk.removed = 0;
+
+    uint64_t mix = index;
+    RandomStream rng(seed ^ SplitMix64(mix), stream);
+    float density = std::min(params.densityMax, params.density + params.densityGrowth * index);
+    int count = (int)(density * params.duration + 0.5f);
+    float totalWeight = 0.0f;
+    for (const ChunkKindSpec& kind : params.kinds) totalWeight += kind.weight;
+
+    int blockedStep = 0;
+    while (chunk.attempts < params.attempts && blockedStep >= 0) {
+        chunk.attempts++;
+        chunk.spawns.clear();
+        for (int i = 0; i < count; i++) {
+            ChunkSpawn s;
+            s.time = rng.NextFloat() * params.duration;
+            float pick = rng.NextFloat() * totalWeight;
+            s.kind = 0;
+            while (s.kind + 1 < (int)params.kinds.size() && pick >= params.kinds[s.kind].weight) {
+                pick -= params.kinds[s.kind].weight;
+                s.kind++;
+            }
+            const ChunkKindSpec& kind = params.kinds[s.kind];
+            s.scale = kind.scaleMin + (kind.scaleMax - kind.scaleMin) * rng.NextFloat();
+            s.vx = kind.vxMin + (kind.vxMax - kind.vxMin) * rng.NextFloat();
+            s.y = rng.NextFloat() * std::max(0.0f, params.fieldHeight - kind.height * s.scale);
+            chunk.spawns.push_back(s);
+        }
+        chunk.moved = BalanceChunk(chunk.spawns, params, rng);
+        blockedStep = FirstBlockedStep(chunk.spawns, params);
+    }
+
+    // Still impossible: drop the obstacle that starts latest among those
+    // covering the ship's column at the blocked step, until a way through opens.
+    while (blockedStep >= 0) {
+        float t = blockedStep * params.step;
+        float spawnX = params.fieldWidth + 50.0f;
+        int victim = -1;
+        for (int i = 0; i < (int)chunk.spawns.size(); i++) {
+            const ChunkSpawn& s = chunk.spawns[i];
+            float speed = -s.vx;
+            float w = params.kinds[s.kind].width * s.scale;
+            float enter = s.time + (spawnX - (params.shipX + params.shipWidth)) / speed;
+            float leave = s.time + (spawnX + w - params.shipX) / speed;
+            if (enter <= t + params.step && leave >= t) victim = i;
+        }
+        if (victim < 0) break;
+        chunk.spawns.erase(chunk.spawns.begin() + victim);
+        chunk.removed++;
+        blockedStep = FirstBlockedStep(chunk.spawns, params);
+    }
+
+    chunk.generateMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - started).count();
+}
+
+inline LevelChunk GenerateChunk(uint64_t seed, uint64_t stream, uint64_t index, const ChunkParams& params) {
+    LevelChunk chunk;
+    GenerateChunk(seed, stream, index, params, chunk);
+    return chunk;
+}
+
+//---------------------
+// Streaming
+//---------------------
+
+struct ChunkMetrics {
+    long generated = 0;
+    long consumed = 0;
+    long late = 0;           // chunks after the first that were not ready when play reached them
+    long stalledTicks = 0;   // ticks spent waiting for a chunk, including the first
+    long onTime = 0;
+    double leadMinMs = 0.0;  // how long before it was needed an on-time chunk was ready
+    double leadSumMs = 0.0;
+    double generateMaxMs = 0.0;
+    double generateSumMs = 0.0;
+    long attempts = 0;
+    long moved = 0;
+    long removed = 0;
+
+    double LeadMeanMs() const { return onTime ? leadSumMs / onTime : 0.0; }
+};
+
+class ChunkStreamer {
+public:
+    const int lookahead;  // chunks kept ready ahead of the one being played
+
+    explicit ChunkStreamer(uint64_t stream, int lookahead = 3)
+        : lookahead(lookahead), stream(stream), ring(8), recycle(16), running(false), nextIndex(0),
+          current(nullptr), cursor(0), levelTime(0.0), waiting(false) {}
+    ~ChunkStreamer() { Stop(); }
+
+    ChunkStreamer(const ChunkStreamer&) = delete;
+    ChunkStreamer& operator=(const ChunkStreamer&) = delete;
+
+    bool Running() const { return running; }
+    double LevelTime() const { return levelTime; }
+    const LevelChunk* Current() const { return current; }
+
+    // Copies are taken, the worker never reads the caller's params again.
+    void Start(const ChunkParams& chunkParams, uint64_t seed) {
+        Stop();
+        params = chunkParams;
+        levelSeed = seed;
+        nextIndex = 0;
+        levelTime = 0.0;
+        cursor = 0;
+        waiting = false;
+        counters.Reset();
+        running = true;
+        worker = std::thread([this] { Work(); });
+    }
+
+    void Stop() {
+        if (!running) return;
+        running = false;
+        wake.notify_one();
+        worker.join();
+        LevelChunk* chunk = nullptr;
+        while (ring.Pop(&chunk, 1)) delete chunk;
+        while (recycle.Pop(&chunk, 1)) delete chunk;
+        delete current;
+        current = nullptr;
+    }
+
+    ChunkMetrics Metrics() const {
+        ChunkMetrics m;
+        m.generated = counters.generated.load(std::memory_order_relaxed);
+        m.consumed = counters.consumed.load(std::memory_order_relaxed);
+        m.late = counters.late.load(std::memory_order_relaxed);
+        m.stalledTicks = counters.stalledTicks.load(std::memory_order_relaxed);
+        m.onTime = counters.onTime.load(std::memory_order_relaxed);
+        m.leadMinMs = counters.leadMinMs.load(std::memory_order_relaxed);
+        m.leadSumMs = counters.leadSumMs.load(std::memory_order_relaxed);
+        m.generateMaxMs = counters.generateMaxMs.load(std::memory_order_relaxed);
+        m.generateSumMs = counters.generateSumMs.load(std::memory_order_relaxed);
+        m.attempts = counters.attempts.load(std::memory_order_relaxed);
+        m.moved = counters.moved.load(std::memory_order_relaxed);
+        m.removed = counters.removed.load(std::memory_order_relaxed);
+        return m;
+    }
+
+    // Sim thread. Moves level time on by dt and calls spawn(const ChunkSpawn&)
+    // for everything that came due. If the next chunk is not ready the level
+    // clock waits for it, so a slow worker delays content but never skips it.
+    // Spent chunks go back to the worker to be refilled, so nothing is
+    // allocated or freed here.
+    template <typename F>
+    void Advance(double dt, F spawn) {
+        if (!running) return;
+        double target = levelTime + dt;
+        for (;;) {
+            if (!current && !TakeNext()) {
+                Add(counters.stalledTicks, 1L);
+                return;
+            }
+            while (cursor < current->spawns.size() && current->start + current->spawns[cursor].time <= target) {
+                spawn(current->spawns[cursor++]);
+            }
+            double end = current->start + params.duration;
+            if (target < end) break;
+            levelTime = end;
+            // At most ring, current and the worker's chunk exist, fewer than
+            // the recycle ring holds, so this always fits.
+            recycle.Push(&current, 1);
+            current = nullptr;
+        }
+        levelTime = target;
+    }
+
+private:
+    // One writer each, the worker or the sim thread; Metrics() reads them
+    // from anywhere.
+    struct Counters {
+        std::atomic<long> generated, consumed, late, stalledTicks, onTime, attempts, moved, removed;
+        std::atomic<double> leadMinMs, leadSumMs, generateMaxMs, generateSumMs;
+
+        void Reset() {
+            for (std::atomic<long>* c : {&generated, &consumed, &late, &stalledTicks, &onTime, &attempts, &moved, &removed})
+                c->store(0, std::memory_order_relaxed);
+            for (std::atomic<double>* c : {&leadMinMs, &leadSumMs, &generateMaxMs, &generateSumMs})
+                c->store(0.0, std::memory_order_relaxed);
+        }
+    };
+
+    uint64_t stream;
+    ChunkParams params;
+    uint64_t levelSeed;
+    SpscRing<LevelChunk*> ring;     // worker to sim thread
+    SpscRing<LevelChunk*> recycle;  // sim thread to worker
+    std::atomic<bool> running;
+    std::thread worker;
+    std::mutex wakeMutex;
+    std::condition_variable wake;
+    uint64_t nextIndex;  // worker only
+
+    LevelChunk* current;  // sim thread only from here down
+    size_t cursor;
+    double levelTime;
+    bool waiting;
+
+    Counters counters;
+
+    template <typename T>
+    static void Add(std::atomic<T>& counter, T by) {
+        counter.store(counter.load(std::memory_order_relaxed) + by, std::memory_order_relaxed);
+    }
+
+    bool TakeNext() {
+        LevelChunk* chunk = nullptr;
+        if (!ring.Pop(&chunk, 1)) {
+            if (!waiting) {
+                waiting = true;
+                // Chunk 0 is always waited for; only later misses count.
+                if (counters.consumed.load(std::memory_order_relaxed) > 0) Add(counters.late, 1L);
+            }
+            return false;
+        }
+        // The worker may be parked on a full ring. Notifying without the lock
+        // can race its check, but then it wakes on the timeout instead.
+        wake.notify_one();
+        if (!waiting) {
+            double lead = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - chunk->ready).count();
+            if (counters.onTime.load(std::memory_order_relaxed) == 0 || lead < counters.leadMinMs.load(std::memory_order_relaxed)) {
+                counters.leadMinMs.store(lead, std::memory_order_relaxed);
+            }
+            Add(counters.leadSumMs, lead);
+            Add(counters.onTime, 1L);
+        }
+        Add(counters.consumed, 1L);
+        waiting = false;
+        current = chunk;
+        cursor = 0;
+        return true;
+    }
+
+    void Work() {
+        while (running) {
+            if (ring.Available() >= std::min((size_t)lookahead + 1, ring.Capacity())) {
+                std::unique_lock<std::mutex> lock(wakeMutex);
+                wake.wait_for(lock, std::chrono::milliseconds(50));
+                continue;
+            }
+            LevelChunk* chunk;
+            if (!recycle.Pop(&chunk, 1)) chunk = new LevelChunk;
+            GenerateChunk(levelSeed, stream, nextIndex++, params, *chunk);
+            chunk->ready = std::chrono::steady_clock::now();
+            Add(counters.generated, 1L);
+            Add(counters.generateSumMs, chunk->generateMs);
+            counters.generateMaxMs.store(std::max(counters.generateMaxMs.load(std::memory_order_relaxed), chunk->generateMs),
+                                         std::memory_order_relaxed);
+            Add(counters.attempts, (long)chunk->attempts);
+            Add(counters.moved, (long)chunk->moved);
+            Add(counters.removed, (long)chunk->removed);
+            ring.Push(&chunk, 1);
+        }
+    }
+};
+
+#endif
@@ -0,0 +1,176 @@
+#ifndef ENTITIES_H
+#define ENTITIES_H
+
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+//#####################
+//Entities
+//#####################
+// Bullets, missiles, lasers and obstacles live by value in pools, one dense
+// vector per type walked in spawn order. One registry hands out the handles
+// for every pool. A handle is 32 bits: a slot index and that slot's
+// generation. The slot records which pool the entity is in and where. The
+// generation goes up when the entity is removed, so a handle kept past that
+// fails the check instead of reaching whatever took the slot next. A lookup
+// is one array index and a compare. Freed slots are reused oldest first, so a
+// slot goes through its generations as slowly as possible.
+
+static const int ENTITY_INDEX_BITS = 20;
+static const uint32_t ENTITY_INDEX_MASK = (1u << ENTITY_INDEX_BITS) - 1;
+static const uint32_t ENTITY_GENERATIONS = 1u << (32 - ENTITY_INDEX_BITS);
+
+struct EntityHandle {
+    uint32_t bits = 0;  // 0 is never handed out
+
+    uint32_t Index() const { return bits & ENTITY_INDEX_MASK; }
+    uint32_t Generation() const { return bits >> ENTITY_INDEX_BITS; }
+    bool IsNull() const { return bits == 0; }
+    bool operator==(EntityHandle other) const { return bits == other.bits; }
+    bool operator!=(EntityHandle other) const { return bits != other.bits; }
+};
+
+class EntityRegistry {
+public:
+    // Each pool takes an id when it is constructed.
+    uint8_t AddPool() { return pools++; }
+
+    EntityHandle Create(uint8_t pool, uint32_t dense) {
+        uint32_t index;
+        if (!freeSlots.empty()) {
+            index = freeSlots.front();
+            freeSlots.pop_front();
+        } else {
+            index = (uint32_t)slots.size();
+            slots.push_back({0, 1, 0});
+        }
+        Slot& slot = slots[index];
+        slot.pool = pool;
+        slot.dense = dense;
+        live++;
+        return {slot.generation << ENTITY_INDEX_BITS | index};
+    }
+
+    // Generation 0 is skipped so that no live handle is 0.
+    void Release(EntityHandle handle) {
+        Slot& slot = slots[handle.Index()];
+        slot.generation = slot.generation + 1 == ENTITY_GENERATIONS ? 1 : slot.generation + 1;
+        freeSlots.push_back(handle.Index());
+        live--;
+    }
+
+    // Where a live handle of this pool points. False for stale handles and
+    // for handles of another pool.
+    bool Find(EntityHandle handle, uint8_t pool, uint32_t& dense) const {
+        uint32_t index = handle.Index();
+        if (index >= slots.size()) return false;
+        const Slot& slot = slots[index];
+        if (slot.generation != handle.Generation() || slot.pool != pool) return false;
+        dense = slot.dense;
+        return true;
+    }
+
+    bool Alive(EntityHandle handle) const {
+        uint32_t index = handle.Index();
+        return index < slots.size() && slots[index].generation == handle.Generation();
+    }
+
+    // The entity moved within its pool.
+    void Move(EntityHandle handle, uint32_t dense) { slots[handle.Index()].dense = dense; }
+
+    int Live() const { return live; }
+    int Slots() const { return (int)slots.size(); }
+
+private:
+    struct Slot {
+        uint32_t dense;
+        uint16_t generation;
+        uint8_t pool;
+    };
+
+    std::vector<Slot> slots;
+    std::deque<uint32_t> freeSlots;
+    uint8_t pools = 0;
+    int live = 0;
+};
+
+template <typename T>
+class EntityPool {
+public:
+    explicit EntityPool(EntityRegistry& registry) : registry(registry), id(registry.AddPool()) {}
+
+    EntityPool(const EntityPool&) = delete;
+    EntityPool& operator=(const EntityPool&) = delete;
+
+    ~EntityPool() { Clear(); }
+
+    EntityHandle Add(const T& value) {
+        EntityHandle handle = registry.Create(id, (uint32_t)items.size());
+        items.push_back(value);
+        handles.push_back(handle);
+        return handle;
+    }
+
+    // nullptr once the entity is gone.
+    T* Get(EntityHandle handle) {
+        uint32_t dense;
+        return registry.Find(handle, id, dense) ? &items[dense] : nullptr;
+    }
+
+    const T* Get(EntityHandle handle) const {
+        uint32_t dense;
+        return registry.Find(handle, id, dense) ? &items[dense] : nullptr;
+    }
+
+    EntityHandle HandleAt(size_t i) const { return handles[i]; }
+
+    // Removes every entity dead(item) is true for. Survivors keep their order
+    // and their handles.
+    template <typename Dead>
+    void RemoveIf(Dead dead) {
+        size_t kept = 0;
+        for (size_t i = 0; i < items.size(); i++) {
+            if (dead(items[i])) {
+                registry.Release(handles[i]);
+                continue;
+            }
+            if (kept != i) {
+                items[kept] = items[i];
+                handles[kept] = handles[i];
+                registry.Move(handles[kept], (uint32_t)kept);
+            }
+            kept++;
+        }
+        items.erase(items.begin() + kept, items.end());
+        handles.resize(kept);
+    }
+
+    void Clear() {
+        for (EntityHandle handle : handles) registry.Release(handle);
+        items.clear();
+        handles.clear();
+    }
+
+    void reserve(size_t n) {
+        items.reserve(n);
+        handles.reserve(n);
+    }
+
+    size_t size() const { return items.size(); }
+    bool empty() const { return items.empty(); }
+    T& operator[](size_t i) { return items[i]; }
+    const T& operator[](size_t i) const { return items[i]; }
+    typename std::vector<T>::iterator begin() { return items.begin(); }
+    typename std::vector<T>::iterator end() { return items.end(); }
+    typename std::vector<T>::const_iterator begin() const { return items.begin(); }
+    typename std::vector<T>::const_iterator end() const { return items.end(); }
+
+private:
+    EntityRegistry& registry;
+    uint8_t id;
+    std::vector<T> items;
+    std::vector<EntityHandle> handles;
+};
+
+#endif
@@ -0,0 +1,103 @@
+#ifndef EVENTS_H
+#define EVENTS_H
+
+#include <cstdint>
+#include <vector>
+
+//#####################
+//Game events
+//#####################
+// Gameplay code never changes the score, the screen, effects or audio
+// directly. It appends an event to the buffer of the phase it runs in. At the
+// end of the tick the world drains all of them in one pass, phase by phase in
+// a fixed order, and every consumer reads that same stream. A phase that runs
+// on several threads gives each thread its own lane, so no buffer is shared
+// and the drain order does not depend on scheduling.
+
+// EVENT_PART is a boss plate shot off.
+enum GameEventType : uint8_t { EVENT_KILL = 0, EVENT_MISS, EVENT_SHIP_HIT, EVENT_SHOT, EVENT_PART, EVENT_TYPE_COUNT };
+
+enum GameEventSource : uint8_t { SOURCE_NONE = 0, SOURCE_BULLET, SOURCE_MISSILE, SOURCE_LASER, SOURCE_SHIP, SOURCE_COUNT };
+
+// Drain order.
+enum EventPhase { PHASE_INPUT = 0, PHASE_MOTION, PHASE_WEAPONS, PHASE_COLLISION, PHASE_COUNT };
+
+static const int EVENT_LANES = 8;
+
+struct GameEvent {
+    GameEventType type;
+    GameEventSource source;
+    int kind;             // obstacle kind, -1 for none and for the boss
+    float x, y, w, h;     // box of whatever the event is about
+};
+
+class EventBuffer {
+public:
+    void Push(GameEventType type, GameEventSource source, int kind, float x, float y, float w, float h) {
+        events.push_back({type, source, kind, x, y, w, h});
+    }
+
+    size_t Size() const { return events.size(); }
+    void Clear() { events.clear(); }
+    std::vector<GameEvent>::const_iterator begin() const { return events.begin(); }
+    std::vector<GameEvent>::const_iterator end() const { return events.end(); }
+
+private:
+    std::vector<GameEvent> events;
+};
+
+class EventQueue {
+public:
+    EventBuffer& Buffer(EventPhase phase, int lane = 0) { return buffers[phase][lane]; }
+
+    size_t Pending() const {
+        size_t n = 0;
+        for (const auto& phase : buffers) {
+            for (const EventBuffer& lane : phase) n += lane.Size();
+        }
+        return n;
+    }
+
+    // Calls consume(event) for everything queued, then empties the buffers.
+    // Buffers keep their capacity, so a warm queue does not allocate.
+    template <typename F>
+    size_t Drain(F consume) {
+        size_t n = 0;
+        for (auto& phase : buffers) {
+            for (EventBuffer& lane : phase) {
+                for (const GameEvent& e : lane) consume(e);
+                n += lane.Size();
+                lane.Clear();
+            }
+        }
+        return n;
+    }
+
+    void Clear() {
+        for (auto& phase : buffers) {
+            for (EventBuffer& lane : phase) lane.Clear();
+        }
+    }
+
+private:
+    EventBuffer buffers[PHASE_COUNT][EVENT_LANES];
+};
+
+struct EventTelemetry {
+    long counts[EVENT_TYPE_COUNT] = {};
+    long killsBySource[SOURCE_COUNT] = {};
+    long lastTick = 0;  // events drained by the last tick
+    long maxTick = 0;
+
+    void Count(const GameEvent& e) {
+        counts[e.type]++;
+        if (e.type == EVENT_KILL) killsBySource[e.source]++;
+    }
+
+    void EndTick(size_t drained) {
+        lastTick = (long)drained;
+        if (lastTick > maxTick) maxTick = lastTick;
+    }
+};
+
+#endif
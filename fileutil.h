@@ -0,0 +1,66 @@
+#ifndef FILEUTIL_H
+#define FILEUTIL_H
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include <sys/stat.h>
+
+//#####################
+//File helpers
+//#####################
+// Shared by the asset pack, the leaderboard and the tuning file, none of
+// which should need raylib just to read or hash bytes.
+
+// FNV-1a style mix over 8-byte words, then the tail bytes.
+inline uint64_t PackHash(const void* data, size_t size) {
+    const unsigned char* bytes = (const unsigned char*)data;
+    uint64_t hash = 0xCBF29CE484222325ull;
+    size_t i = 0;
+    for (; i + 8 <= size; i += 8) {
+        uint64_t word;
+        memcpy(&word, bytes + i, 8);
+        hash = (hash ^ word) * 0x100000001B3ull;
+        hash ^= hash >> 29;
+    }
+    for (; i < size; i++) {
+        hash = (hash ^ bytes[i]) * 0x100000001B3ull;
+    }
+    return hash;
+}
+
+inline bool ReadWholeFile(const char* path, std::vector<unsigned char>& out) {
+    FILE* file = fopen(path, "rb");
+    if (!file) return false;
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    out.resize(size > 0 ? size : 0);
+    bool ok = size >= 0 && fread(out.data(), 1, out.size(), file) == out.size();
+    fclose(file);
+    return ok;
+}
+
+// 0 when the file cannot be read.
+inline uint64_t HashFile(const char* path) {
+    std::vector<unsigned char> bytes;
+    if (!ReadWholeFile(path, bytes)) return 0;
+    return PackHash(bytes.data(), bytes.size());
+}
+
+// Size and modification time in ns; false when the file cannot be stat'ed.
+inline bool FileStamp(const char* path, uint64_t& size, int64_t& time) {
+    struct stat info;
+    if (stat(path, &info) != 0) return false;
+    size = (uint64_t)info.st_size;
+#if defined(_WIN32) || defined(__APPLE__)
+    time = (int64_t)info.st_mtime * 1000000000;
+#else
+    time = (int64_t)info.st_mtim.tv_sec * 1000000000 + info.st_mtim.tv_nsec;
+#endif
+    return true;
+}
+
+#endif
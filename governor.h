@@ -0,0 +1,181 @@
+#ifndef GOVERNOR_H
+#define GOVERNOR_H
+
+#include <algorithm>
+#include <cstdio>
+
+//#####################
+//Load-shedding governor
+//#####################
+// Watches a rolling window of frame work times and steps through shed levels
+// when the window's 90th percentile leaves the budget. Escalating and relaxing
+// use different thresholds and dwell times so it does not flap between levels.
+
+enum DrawQuality { DRAW_FULL = 0, DRAW_REDUCED, DRAW_MINIMAL };
+
+struct ShedLevel {
+    float spawnIntervalScale;  // multiplies every Spawn*Command interval; thins level spawns alike
+    int maxLiveBullets;        // 0 = unlimited
+    int maxLiveObstacles;      // 0 = unlimited
+    float cosmeticScale;       // fraction of particles/background work to keep
+    DrawQuality drawQuality;
+};
+
+static const ShedLevel SHED_LEVELS[] = {
+    {1.0f,   0,    0, 1.00f, DRAW_FULL},
+    {1.0f, 256,    0, 0.50f, DRAW_FULL},
+    {1.5f, 128, 1024, 0.25f, DRAW_REDUCED},
+    {2.5f,  64,  512, 0.00f, DRAW_REDUCED},
+    {4.0f,  32,  256, 0.00f, DRAW_MINIMAL},
+};
+static const int SHED_LEVEL_COUNT = sizeof(SHED_LEVELS) / sizeof(SHED_LEVELS[0]);
+
+struct GovernorMetrics {
+    long framesObserved = 0;
+    long framesOverBudget = 0;
+    long escalations = 0;
+    long relaxations = 0;
+    long framesAtLevel[SHED_LEVEL_COUNT] = {};
+    long spawnsDeferred = 0;    // stretched interval had not elapsed, or a level spawn was thinned out
+    long spawnsRejected = 0;    // obstacle cap reached
+    long bulletsRejected = 0;   // bullet cap reached
+    float windowMeanMs = 0.0f;
+    float windowP90Ms = 0.0f;
+    float worstMs = 0.0f;
+};
+
+class LoadGovernor {
+public:
+    static const int WINDOW = 30;
+
+    float budgetMs;
+    float highWater;      // escalate when p90 > budget * highWater ...
+    float lowWater;       // ... relax when p90 < budget * lowWater
+    int escalateAfter;    // consecutive hot frames before stepping up
+    int relaxAfter;       // consecutive cool frames before stepping down
+    int cooldown;         // frames to wait after any change so its effect shows in the window
+    bool enabled;
+
+    LoadGovernor(float budgetMs = 12.0f)
+        : budgetMs(budgetMs), highWater(0.95f), lowWater(0.60f),
+          escalateAfter(3), relaxAfter(120), cooldown(WINDOW), enabled(true) {
+        Reset();
+    }
+
+    void Reset() {
+        for (int i = 0; i < WINDOW; i++) samples[i] = 0.0f;
+        count = 0;
+        head = 0;
+        level = 0;
+        hotFrames = 0;
+        coolFrames = 0;
+        sinceChange = cooldown;
+        metrics = GovernorMetrics();
+    }
+
+    // Feed the work time of the frame that just finished.
+    void Observe(float frameMs) {
+        samples[head] = frameMs;
+        head = (head + 1) % WINDOW;
+        if (count < WINDOW) count++;
+
+        metrics.framesObserved++;
+        metrics.framesAtLevel[level]++;
+        if (frameMs > budgetMs) metrics.framesOverBudget++;
+        if (frameMs > metrics.worstMs) metrics.worstMs = frameMs;
+
+        float sorted[WINDOW];
+        float sum = 0.0f;
+        for (int i = 0; i < count; i++) {
+            sorted[i] = samples[i];
+            sum += samples[i];
+        }
+        int p90 = (count * 9) / 10;
+        if (p90 >= count) p90 = count - 1;
+        std::nth_element(sorted, sorted + p90, sorted + count);
+        metrics.windowMeanMs = sum / count;
+        metrics.windowP90Ms = sorted[p90];
+
+        if (!enabled) return;
+
+        sinceChange++;
+        if (metrics.windowP90Ms > budgetMs * highWater) {
+            hotFrames++;
+            coolFrames = 0;
+        } else if (metrics.windowP90Ms < budgetMs * lowWater) {
+            coolFrames++;
+            hotFrames = 0;
+        } else {
+            hotFrames = 0;
+            coolFrames = 0;
+        }
+
+        if (sinceChange < cooldown) return;
+
+        if (hotFrames >= escalateAfter && level < SHED_LEVEL_COUNT - 1) {
+            level++;
+            metrics.escalations++;
+            sinceChange = 0;
+            hotFrames = 0;
+        } else if (coolFrames >= relaxAfter && level > 0) {
+            level--;
+            metrics.relaxations++;
+            sinceChange = 0;
+            coolFrames = 0;
+        }
+    }
+
+    int Level() const { return level; }
+    const ShedLevel& Current() const { return SHED_LEVELS[level]; }
+    float SpawnIntervalScale() const { return Current().spawnIntervalScale; }
+    float CosmeticScale() const { return Current().cosmeticScale; }
+    DrawQuality Quality() const { return Current().drawQuality; }
+
+    bool AllowBullet(int liveBullets) {
+        int cap = Current().maxLiveBullets;
+        if (cap > 0 && liveBullets >= cap) {
+            metrics.bulletsRejected++;
+            return false;
+        }
+        return true;
+    }
+
+    bool AllowObstacle(int liveObstacles) {
+        int cap = Current().maxLiveObstacles;
+        if (cap > 0 && liveObstacles >= cap) {
+            metrics.spawnsRejected++;
+            return false;
+        }
+        return true;
+    }
+
+    void NoteSpawnDeferred() { metrics.spawnsDeferred++; }
+
+    const GovernorMetrics& Metrics() const { return metrics; }
+
+    void Report(FILE* out) const {
+        fprintf(out, "governor: budget %.2f ms, level %d, p90 %.2f ms, mean %.2f ms, worst %.2f ms\n",
+                budgetMs, level, metrics.windowP90Ms, metrics.windowMeanMs, metrics.worstMs);
+        fprintf(out, "governor: frames %ld, over budget %ld (%.2f%%), escalations %ld, relaxations %ld\n",
+                metrics.framesObserved, metrics.framesOverBudget,
+                metrics.framesObserved ? 100.0 * metrics.framesOverBudget / metrics.framesObserved : 0.0,
+                metrics.escalations, metrics.relaxations);
+        fprintf(out, "governor: spawns deferred %ld, spawns rejected %ld, bullets rejected %ld\n",
+                metrics.spawnsDeferred, metrics.spawnsRejected, metrics.bulletsRejected);
+        fprintf(out, "governor: frames at level");
+        for (int i = 0; i < SHED_LEVEL_COUNT; i++) fprintf(out, " L%d=%ld", i, metrics.framesAtLevel[i]);
+        fprintf(out, "\n");
+    }
+
+private:
+    float samples[WINDOW];
+    int count;
+    int head;
+    int level;
+    int hotFrames;
+    int coolFrames;
+    int sinceChange;
+    GovernorMetrics metrics;
+};
+
+#endif
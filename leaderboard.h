@@ -0,0 +1,585 @@
+#ifndef LEADERBOARD_H
+#define LEADERBOARD_H
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "fileutil.h"
+
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+//#####################
+//Leaderboard
+//#####################
+// Finished runs go into an append-only log of fixed-size slots:
+//
+//   LogHeader | LogSlot | LogSlot | ...
+//
+// A slot is a RunRecord and a checksum over it, and sequence numbers go up by
+// one from slot to slot. The file is mapped shared and written by a
+// background thread, so the game only queues a record. The checksum is
+// written last, so a process killed halfway through a slot leaves one that
+// fails the check. Opening walks the slots from the start and stops at the
+// first one that fails or breaks the sequence; appends resume there.
+//
+// Queries never read the log. The index keeps the best runs in full, the best
+// run of each day, and how many runs got each score, which answers top-K,
+// rank and per-day best without touching every run. Once the log holds
+// compactAfter records the writer saves its own copy of the index as a
+// snapshot (to a temporary file, then renamed over the old one) and starts
+// the log again from slot 0. Records the snapshot covers are skipped when the
+// log is replayed, so a kill at any point of this loses nothing.
+
+static const char LOG_MAGIC[4] = {'G', 'L', 'O', 'G'};
+static const char SNAPSHOT_MAGIC[4] = {'G', 'S', 'N', 'P'};
+static const uint32_t LEADERBOARD_VERSION = 1;
+static const int LEADERBOARD_TOP = 1000;      // runs kept in full for top-K
+static const size_t LEADERBOARD_SLOTS = 4096;  // slots a new log starts with
+static const int64_t SECONDS_PER_DAY = 86400;
+
+struct RunRecord {
+    uint64_t sequence;
+    uint64_t seed;
+    int64_t timestamp;  // unix seconds
+    int32_t score;
+    uint32_t durationMs;
+};
+
+struct LogHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t slotSize;
+    uint32_t reserved;
+};
+
+struct LogSlot {
+    RunRecord run;
+    uint64_t checksum;
+};
+
+struct SnapshotHeader {
+    char magic[4];
+    uint32_t version;
+    uint64_t lastSequence;
+    uint64_t runs;
+    uint32_t topCount;
+    uint32_t dayCount;
+    uint32_t scoreCount;
+    uint32_t reserved;
+    uint64_t bodyHash;
+};
+
+struct ScoreCount {
+    int32_t score;
+    uint32_t reserved;
+    uint64_t runs;
+};
+
+// Salted so that an all-zero slot never passes.
+inline uint64_t RunChecksum(const RunRecord& run) { return PackHash(&run, sizeof(run)) ^ 0x6C6F6772756E7321ull; }
+
+// UTC day number.
+inline int32_t RunDay(int64_t timestamp) {
+    return (int32_t)(timestamp >= 0 ? timestamp / SECONDS_PER_DAY : (timestamp - SECONDS_PER_DAY + 1) / SECONDS_PER_DAY);
+}
+
+// Higher score first; the earlier run wins a tie.
+inline bool BetterRun(const RunRecord& a, const RunRecord& b) {
+    return a.score != b.score ? a.score > b.score : a.sequence < b.sequence;
+}
+
+class LeaderboardIndex {
+public:
+    void Clear() {
+        top.clear();
+        counts.clear();
+        days.clear();
+        runs = 0;
+        lastSequence = 0;
+        aboveDirty = true;
+    }
+
+    void Add(const RunRecord& run) {
+        runs++;
+        lastSequence = std::max(lastSequence, run.sequence);
+
+        auto at = std::upper_bound(top.begin(), top.end(), run, BetterRun);
+        if (at - top.begin() < LEADERBOARD_TOP) {
+            top.insert(at, run);
+            if ((int)top.size() > LEADERBOARD_TOP) top.pop_back();
+        }
+
+        auto count = FindScore(run.score);
+        if (count != counts.end() && count->score == run.score) {
+            count->runs++;
+            if (!aboveDirty) {
+                for (size_t i = count - counts.begin() + 1; i < above.size(); i += i & (0 - i)) above[i]++;
+            }
+        } else {
+            // Every later position moves, so the tree is rebuilt when next
+            // asked. New scores get rare once the board has some history.
+            counts.insert(count, {run.score, 0, 1});
+            aboveDirty = true;
+        }
+
+        auto day = days.find(RunDay(run.timestamp));
+        if (day == days.end()) {
+            days.emplace(RunDay(run.timestamp), run);
+        } else if (BetterRun(run, day->second)) {
+            day->second = run;
+        }
+    }
+
+    long Runs() const { return (long)runs; }
+    uint64_t LastSequence() const { return lastSequence; }
+
+    // Up to k best runs, best first. k is capped at LEADERBOARD_TOP.
+    void Top(int k, std::vector<RunRecord>& out) const {
+        out.assign(top.begin(), top.begin() + std::min((size_t)std::max(0, k), top.size()));
+    }
+
+    // Runs that scored higher, so a new run's place is Above(score) + 1.
+    long Above(int32_t score) const {
+        if (aboveDirty) {
+            above.assign(counts.size() + 1, 0);
+            for (size_t i = 1; i < above.size(); i++) {
+                above[i] += counts[i - 1].runs;
+                size_t parent = i + (i & (0 - i));
+                if (parent < above.size()) above[parent] += above[i];
+            }
+            aboveDirty = false;
+        }
+        uint64_t sum = 0;
+        for (size_t i = FindScore(score) - counts.begin(); i > 0; i -= i & (0 - i)) sum += above[i];
+        return (long)sum;
+    }
+
+    // Percentage of runs that scored lower.
+    double Percentile(int32_t score) const {
+        if (runs == 0) return 0.0;
+        long atLeast = score == INT32_MIN ? (long)runs : Above(score - 1);
+        return 100.0 * (double)(runs - atLeast) / runs;
+    }
+
+    bool DayBest(int32_t day, RunRecord& out) const {
+        auto it = days.find(day);
+        if (it == days.end()) return false;
+        out = it->second;
+        return true;
+    }
+
+    const std::map<int32_t, RunRecord>& Days() const { return days; }
+    size_t DistinctScores() const { return counts.size(); }
+
+    bool Matches(const LeaderboardIndex& other) const {
+        if (runs != other.runs || lastSequence != other.lastSequence) return false;
+        if (top.size() != other.top.size() || counts.size() != other.counts.size() || days.size() != other.days.size()) {
+            return false;
+        }
+        if (!top.empty() && memcmp(top.data(), other.top.data(), top.size() * sizeof(RunRecord)) != 0) return false;
+        if (!counts.empty() && memcmp(counts.data(), other.counts.data(), counts.size() * sizeof(ScoreCount)) != 0) {
+            return false;
+        }
+        for (auto a = days.begin(), b = other.days.begin(); a != days.end(); ++a, ++b) {
+            if (a->first != b->first || memcmp(&a->second, &b->second, sizeof(RunRecord)) != 0) return false;
+        }
+        return true;
+    }
+
+    // Writes the index to path + ".tmp", syncs it and renames it over path.
+    bool WriteSnapshot(const std::string& path, std::string& error) const {
+        std::vector<unsigned char> body;
+        Append(body, top.data(), top.size() * sizeof(RunRecord));
+        for (const auto& day : days) Append(body, &day.second, sizeof(RunRecord));
+        Append(body, counts.data(), counts.size() * sizeof(ScoreCount));
+
+        SnapshotHeader header;
+        memset(&header, 0, sizeof(header));
+        memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic));
+        header.version = LEADERBOARD_VERSION;
+        header.lastSequence = lastSequence;
+        header.runs = runs;
+        header.topCount = (uint32_t)top.size();
+        header.dayCount = (uint32_t)days.size();
+        header.scoreCount = (uint32_t)counts.size();
+        header.bodyHash = PackHash(body.data(), body.size());
+
+        std::string temporary = path + ".tmp";
+        FILE* file = fopen(temporary.c_str(), "wb");
+        if (!file) {
+            error = "cannot create " + temporary;
+            return false;
+        }
+        bool ok = fwrite(&header, sizeof(header), 1, file) == 1 &&
+                  (body.empty() || fwrite(body.data(), body.size(), 1, file) == 1) && fflush(file) == 0;
+#if !defined(_WIN32)
+        ok = ok && fsync(fileno(file)) == 0;
+#endif
+        ok = fclose(file) == 0 && ok;
+        if (!ok || rename(temporary.c_str(), path.c_str()) != 0) {
+            error = "cannot write " + path;
+            remove(temporary.c_str());
+            return false;
+        }
+        return true;
+    }
+
+    // A missing snapshot is an empty board. False only for a damaged one.
+    bool ReadSnapshot(const std::string& path, std::string& error) {
+        Clear();
+        std::vector<unsigned char> bytes;
+        if (!ReadWholeFile(path.c_str(), bytes)) return true;
+        SnapshotHeader header;
+        if (bytes.size() < sizeof(header)) {
+            error = "truncated snapshot " + path;
+            return false;
+        }
+        memcpy(&header, bytes.data(), sizeof(header));
+        size_t bodySize = ((size_t)header.topCount + header.dayCount) * sizeof(RunRecord) +
+                          (size_t)header.scoreCount * sizeof(ScoreCount);
+        if (memcmp(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic)) != 0 || header.version != LEADERBOARD_VERSION ||
+            bytes.size() != sizeof(header) + bodySize ||
+            PackHash(bytes.data() + sizeof(header), bodySize) != header.bodyHash) {
+            error = "damaged snapshot " + path;
+            return false;
+        }
+        const unsigned char* at = bytes.data() + sizeof(header);
+        top.resize(header.topCount);
+        if (!top.empty()) memcpy(top.data(), at, top.size() * sizeof(RunRecord));
+        at += top.size() * sizeof(RunRecord);
+        for (uint32_t i = 0; i < header.dayCount; i++, at += sizeof(RunRecord)) {
+            RunRecord run;
+            memcpy(&run, at, sizeof(run));
+            days.emplace(RunDay(run.timestamp), run);
+        }
+        counts.resize(header.scoreCount);
+        if (!counts.empty()) memcpy(counts.data(), at, counts.size() * sizeof(ScoreCount));
+        runs = header.runs;
+        lastSequence = header.lastSequence;
+        return true;
+    }
+
+private:
+    std::vector<RunRecord> top;      // best first
+    std::vector<ScoreCount> counts;  // highest score first
+    std::map<int32_t, RunRecord> days;
+    uint64_t runs = 0;
+    uint64_t lastSequence = 0;
+    // Fenwick tree over the runs in counts, so a rank is a sum of log n
+    // entries. above[i] covers counts[i - (i & -i), i).
+    mutable std::vector<uint64_t> above;
+    mutable bool aboveDirty = true;
+
+    // First entry whose score is not higher.
+    std::vector<ScoreCount>::iterator FindScore(int32_t score) {
+        return std::lower_bound(counts.begin(), counts.end(), score,
+                                [](const ScoreCount& c, int32_t s) { return c.score > s; });
+    }
+
+    std::vector<ScoreCount>::const_iterator FindScore(int32_t score) const {
+        return std::lower_bound(counts.begin(), counts.end(), score,
+                                [](const ScoreCount& c, int32_t s) { return c.score > s; });
+    }
+
+    static void Append(std::vector<unsigned char>& out, const void* data, size_t size) {
+        out.insert(out.end(), (const unsigned char*)data, (const unsigned char*)data + size);
+    }
+};
+
+struct LeaderboardMetrics {
+    long recovered = 0;     // log records replayed by Open
+    bool tornTail = false;  // the log ended in a half-written slot
+    long written = 0;
+    long logRecords = 0;    // in the log since the last compaction
+    long compactions = 0;
+    double compactMsMax = 0.0;
+    long failures = 0;      // appends and compactions the disk refused
+};
+
+class LeaderboardStore {
+public:
+    size_t compactAfter = 65536;  // 0 never compacts
+
+    LeaderboardStore() : fd(-1), base(nullptr), mapped(0), capacity(0), writePos(0), nextSequence(1),
+                         stopping(false), busy(false), open(false) {}
+    ~LeaderboardStore() { Close(); }
+
+    LeaderboardStore(const LeaderboardStore&) = delete;
+    LeaderboardStore& operator=(const LeaderboardStore&) = delete;
+
+    // Loads path + ".snap", replays path, and starts the writer. Creates the
+    // log if there is none.
+    bool Open(const std::string& path, std::string& error) {
+        Close();
+#if defined(_WIN32)
+        (void)path;
+        error = "the leaderboard is not supported on Windows";
+        return false;
+#else
+        logPath = path;
+        snapshotPath = path + ".snap";
+        metrics = LeaderboardMetrics();
+        if (!index.ReadSnapshot(snapshotPath, error)) return false;
+
+        fd = ::open(logPath.c_str(), O_RDWR | O_CREAT, 0644);
+        if (fd < 0) {
+            error = "cannot open " + logPath;
+            return false;
+        }
+        struct stat info;
+        if (fstat(fd, &info) != 0) {
+            error = "cannot stat " + logPath;
+            Unmap();
+            return false;
+        }
+        if (info.st_size == 0) {
+            LogHeader header;
+            memset(&header, 0, sizeof(header));
+            memcpy(header.magic, LOG_MAGIC, sizeof(header.magic));
+            header.version = LEADERBOARD_VERSION;
+            header.slotSize = sizeof(LogSlot);
+            if (pwrite(fd, &header, sizeof(header), 0) != (ssize_t)sizeof(header) ||
+                ftruncate(fd, sizeof(LogHeader) + LEADERBOARD_SLOTS * sizeof(LogSlot)) != 0) {
+                error = "cannot create " + logPath;
+                Unmap();
+                return false;
+            }
+            info.st_size = sizeof(LogHeader) + LEADERBOARD_SLOTS * sizeof(LogSlot);
+        }
+        if (info.st_size < (off_t)sizeof(LogHeader) || !Map(info.st_size)) {
+            error = "cannot map " + logPath;
+            Unmap();
+            return false;
+        }
+        LogHeader header;
+        memcpy(&header, base, sizeof(header));
+        if (memcmp(header.magic, LOG_MAGIC, sizeof(header.magic)) != 0 || header.version != LEADERBOARD_VERSION ||
+            header.slotSize != sizeof(LogSlot)) {
+            error = logPath + " is not a leaderboard log";
+            Unmap();
+            return false;
+        }
+
+        size_t valid = 0;
+        uint64_t previous = 0;
+        for (; valid < capacity; valid++) {
+            const LogSlot& slot = Slots()[valid];
+            if (slot.checksum != RunChecksum(slot.run)) break;
+            if (valid > 0 && slot.run.sequence != previous + 1) break;
+            previous = slot.run.sequence;
+        }
+        if (valid < capacity) {
+            const unsigned char* bytes = (const unsigned char*)&Slots()[valid];
+            metrics.tornTail = Slots()[valid].checksum != RunChecksum(Slots()[valid].run) &&
+                               std::any_of(bytes, bytes + sizeof(LogSlot), [](unsigned char b) { return b != 0; });
+        }
+        // The snapshot may already hold some or all of these.
+        uint64_t covered = index.LastSequence();
+        for (size_t i = 0; i < valid; i++) {
+            if (Slots()[i].run.sequence <= covered) continue;
+            index.Add(Slots()[i].run);
+            metrics.recovered++;
+        }
+        writePos = valid > 0 && previous > covered ? valid : 0;
+        nextSequence = std::max(covered, previous) + 1;
+        metrics.logRecords = (long)writePos;
+
+        written = index;
+        stopping = false;
+        busy = false;
+        open = true;
+        writer = std::thread([this] { Write(); });
+        return true;
+#endif
+    }
+
+    // Writes whatever is still queued first.
+    void Close() {
+        if (writer.joinable()) {
+            {
+                std::lock_guard<std::mutex> lock(queueMutex);
+                stopping = true;
+            }
+            wake.notify_one();
+            writer.join();
+        }
+        Unmap();
+        open = false;
+    }
+
+    bool IsOpen() const { return open; }
+
+    // Game thread. Queues the run for the writer; the index sees it at once.
+    void Submit(int32_t score, uint32_t durationMs, uint64_t seed, int64_t timestamp) {
+        if (!open) return;
+        RunRecord run = {nextSequence++, seed, timestamp, score, durationMs};
+        index.Add(run);
+        bool idle;
+        {
+            std::lock_guard<std::mutex> lock(queueMutex);
+            idle = queue.empty();
+            queue.push_back(run);
+        }
+        // A writer that has not taken the last batch yet will see this one.
+        if (idle) wake.notify_one();
+    }
+
+    // Waits until everything submitted so far is in the log.
+    void Flush() {
+        std::unique_lock<std::mutex> lock(queueMutex);
+        drained.wait(lock, [this] { return queue.empty() && !busy; });
+    }
+
+    // Game thread only.
+    const LeaderboardIndex& Index() const { return index; }
+
+    LeaderboardMetrics Metrics() const {
+        std::lock_guard<std::mutex> lock(metricsMutex);
+        return metrics;
+    }
+
+private:
+    std::string logPath, snapshotPath;
+    int fd;
+    unsigned char* base;
+    size_t mapped;
+    size_t capacity;   // slots
+    size_t writePos;   // writer only once open
+    uint64_t nextSequence;
+    LeaderboardIndex index;    // game thread
+    LeaderboardIndex written;  // writer: what the log and snapshot hold
+
+    std::thread writer;
+    std::mutex queueMutex;
+    std::condition_variable wake, drained;
+    std::vector<RunRecord> queue;
+    bool stopping;
+    bool busy;
+    bool open;
+
+    mutable std::mutex metricsMutex;
+    LeaderboardMetrics metrics;
+
+    LogSlot* Slots() { return (LogSlot*)(base + sizeof(LogHeader)); }
+
+    bool Map(size_t size) {
+#if defined(_WIN32)
+        (void)size;
+        return false;
+#else
+        void* at = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (at == MAP_FAILED) return false;
+        base = (unsigned char*)at;
+        mapped = size;
+        capacity = (size - sizeof(LogHeader)) / sizeof(LogSlot);
+        return true;
+#endif
+    }
+
+    void Unmap() {
+#if !defined(_WIN32)
+        if (base) munmap(base, mapped);
+        if (fd >= 0) ::close(fd);
+#endif
+        fd = -1;
+        base = nullptr;
+        mapped = 0;
+        capacity = 0;
+    }
+
+    // Doubles the log. Only the writer touches the mapping once open. The old
+    // mapping goes only once the new one is in place; on failure the log
+    // keeps its size and the run counts as a failed write.
+    bool Grow() {
+#if defined(_WIN32)
+        return false;
+#else
+        size_t size = sizeof(LogHeader) + std::max(capacity * 2, LEADERBOARD_SLOTS) * sizeof(LogSlot);
+        if (ftruncate(fd, size) != 0) return false;
+        unsigned char* old = base;
+        size_t oldSize = mapped;
+        if (!Map(size)) return false;
+        munmap(old, oldSize);
+        return true;
+#endif
+    }
+
+    // The checksum goes to zero before the record changes and is set after
+    // it, so a slot is never valid with half its fields.
+    bool Append(const RunRecord& run) {
+        if (writePos == capacity && !Grow()) return false;
+        LogSlot& slot = Slots()[writePos];
+        slot.checksum = 0;
+        std::atomic_thread_fence(std::memory_order_release);
+        slot.run = run;
+        std::atomic_thread_fence(std::memory_order_release);
+        slot.checksum = RunChecksum(run);
+        writePos++;
+        return true;
+    }
+
+    void Compact() {
+        auto start = std::chrono::steady_clock::now();
+        std::string error;
+        bool ok = written.WriteSnapshot(snapshotPath, error);
+        // Slot 0 is reused only once the snapshot holds everything before it.
+        if (ok) writePos = 0;
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        std::lock_guard<std::mutex> lock(metricsMutex);
+        if (ok) {
+            metrics.compactions++;
+            metrics.compactMsMax = std::max(metrics.compactMsMax, ms);
+            metrics.logRecords = 0;
+        } else {
+            metrics.failures++;
+        }
+    }
+
+    void Write() {
+        std::vector<RunRecord> batch;
+        for (;;) {
+            {
+                std::unique_lock<std::mutex> lock(queueMutex);
+                busy = false;
+                drained.notify_all();
+                wake.wait(lock, [this] { return stopping || !queue.empty(); });
+                if (queue.empty()) return;
+                batch.swap(queue);
+                busy = true;
+            }
+            long appended = 0, failed = 0;
+            for (const RunRecord& run : batch) {
+                if (Append(run)) {
+                    written.Add(run);
+                    appended++;
+                } else {
+                    failed++;
+                }
+            }
+            batch.clear();
+            {
+                std::lock_guard<std::mutex> lock(metricsMutex);
+                metrics.written += appended;
+                metrics.failures += failed;
+                metrics.logRecords = (long)writePos;
+            }
+            if (compactAfter > 0 && writePos >= compactAfter) Compact();
+        }
+    }
+};
+
+#endif
@@ -1,11 +1,80 @@
 #include <iostream>
 #include <raylib.h>
 #include <vector>
+#include <cstdio>
+#include <cstring>
+#include <cmath>
+#include <chrono>
+#include <ctime>
+#include <thread>
+#include "governor.h"
+#include "pacing.h"
+#include "rng.h"
+#include "narrowphase.h"
+#include "assets.h"
+#include "particles.h"
+#include "audio.h"
+#include "spatial.h"
+#include "wave.h"
+#include "chunks.h"
+#include "simcore.h"
+#include "spectate.h"
+#include "events.h"
+#include "autopilot.h"
+#include "boss.h"
+#include "entities.h"
+#include "leaderboard.h"
+#include "background.h"
+#include "tuning.h"
+#include "rollback.h"
+
+#if !defined(_WIN32)
+#include <signal.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
 
 using namespace std;
 
 typedef enum gameScreen { GAMEPLAY = 0, GAMEOVER} gameScreen;
 
+//#####################
+//Simulation clock
+//#####################
+// Headless runs have no window, so raylib's frame time and screen size are
+// meaningless there. Gameplay code reads these wrappers instead; the windowed
+// game leaves them pointing at raylib.
+struct SimClock {
+    bool headless = false;
+    float frameTime = 0.0f;
+    int width = 1280;
+    int height = 720;
+    int nominalFrames = 0;  // windowed frames left that use frameTime, see the idle wake in main
+};
+
+thread_local SimClock simClock;
+
+float FrameTime() {
+    return simClock.headless || simClock.nominalFrames > 0 ? simClock.frameTime : GetFrameTime();
+}
+
+int FieldWidth() {
+    return simClock.headless ? simClock.width : GetScreenWidth();
+}
+
+int FieldHeight() {
+    return simClock.headless ? simClock.height : GetScreenHeight();
+}
+
+// Headless runs keep the decoded size but never touch the GPU.
+Texture2D UploadTexture(Image image) {
+    if (simClock.headless) {
+        return {0, image.width, image.height, image.mipmaps, image.format};
+    }
+    return LoadTextureFromImage(image);
+}
+
 //#####################
 //Game objects
 //#####################
@@ -21,31 +90,21 @@ public:
     float deceleration;  
     Vector2 initialPosition;
 
-    Ship(const char* texturePath, int screenWidth, int screenHeight) {
-        Image image = LoadImage(texturePath);
-        if (image.data == nullptr) {
-            cerr << "Failed to load image!" << endl;
-            exit(-1);
-        }
-
-        texture = LoadTextureFromImage(image);
-        UnloadImage(image);
-
-        int shipWidth = texture.width;
-        int shipHeight = texture.height;
-
-        sourceRec = {0.0f, 0.0f, (float)shipWidth, (float)shipHeight};
+    // The texture arrives later from the asset loader, see AttachTexture.
+    Ship(int screenWidth, int screenHeight) {
+        texture = {0};
+        sourceRec = {0.0f, 0.0f, 0.0f, 0.0f};
         destRec = {
             screenWidth - 1080.0f,
             screenHeight / 2.0f,
-            shipWidth / 3.0f,
-            shipHeight / 3.0f
+            0.0f,
+            0.0f
         };
         origin = {0.0f, 0.0f};
         rotation = 0.0f;
         velocity = 0.0f;
-        acceleration = 1500.0f;  
-        deceleration = 1500.0f;
+        acceleration = 0.0f;  // set by World::ApplyTuning
+        deceleration = 0.0f;
         initialPosition = {screenWidth - 1080.0f, screenHeight / 2.0f};
     }
 
@@ -53,20 +112,35 @@ public:
         UnloadTexture(texture);
     }
 
+    bool Ready() const {
+        return texture.width > 0;
+    }
+
+    void AttachTexture(Texture2D loaded) {
+        texture = loaded;
+
+        int shipWidth = texture.width;
+        int shipHeight = texture.height;
+
+        sourceRec = {0.0f, 0.0f, (float)shipWidth, (float)shipHeight};
+        destRec.width = shipWidth / 3.0f;
+        destRec.height = shipHeight / 3.0f;
+    }
+
     void Fly(bool isFlying) {
         if (isFlying) {
-            velocity -= acceleration * GetFrameTime();  
+            velocity -= acceleration * FrameTime();  
         } else {
-            velocity += deceleration * GetFrameTime(); 
+            velocity += deceleration * FrameTime(); 
         }
 
-        destRec.y += velocity * GetFrameTime();  
+        destRec.y += velocity * FrameTime();  
 
         if (destRec.y < 0) {
             destRec.y = 0;
             velocity = 0;
-        } else if (destRec.y + destRec.height > GetScreenHeight()) {
-            destRec.y = GetScreenHeight() - destRec.height;
+        } else if (destRec.y + destRec.height > FieldHeight()) {
+            destRec.y = FieldHeight() - destRec.height;
             velocity = 0;
         }
     }
@@ -90,7 +164,7 @@ public:
 
     Bullet(float x, float y) {
         position = {x, y};
-        velocity = {500.0f, 0.0f};  
+        velocity = {0.0f, 0.0f};  // the prototype's speed comes from World::ApplyTuning
         radius = 5.0f;
         active = false;
     }
@@ -104,8 +178,8 @@ public:
 
     void Update() {
         if (active) {
-            position.x += velocity.x * GetFrameTime();
-            if (position.x > GetScreenWidth()) {
+            position.x += velocity.x * FrameTime();
+            if (position.x > FieldWidth()) {
                 active = false;
             }
         }
@@ -116,6 +190,105 @@ public:
             DrawCircleV(position, radius, WHITE);
         }
     }
+
+    void DrawFlat() {
+        if (active) {
+            DrawRectangleRec({position.x - radius, position.y - radius, radius * 2, radius * 2}, WHITE);
+        }
+    }
+};
+
+// Locks onto the nearest obstacle and keeps it until it is gone; the world
+// picks the target and supplies its position.
+class Missile {
+public:
+    Vector2 position, velocity;
+    float speed;
+    float turnRate;  // fraction of the way to the target heading per second
+    float life;
+    bool active;
+    EntityHandle target;
+
+    Missile(float x, float y) {
+        position = {x, y};
+        speed = 420.0f;
+        velocity = {speed, 0.0f};
+        turnRate = 6.0f;
+        life = 3.0f;
+        active = true;
+    }
+
+    void Update(bool hasTarget, Vector2 target) {
+        if (!active) return;
+        float dt = FrameTime();
+        if (hasTarget) {
+            float tx = target.x - position.x;
+            float ty = target.y - position.y;
+            float length = sqrtf(tx * tx + ty * ty);
+            if (length > 0.0f) {
+                float blend = fminf(1.0f, turnRate * dt);
+                float hx = velocity.x / speed + (tx / length - velocity.x / speed) * blend;
+                float hy = velocity.y / speed + (ty / length - velocity.y / speed) * blend;
+                float h = sqrtf(hx * hx + hy * hy);
+                if (h > 0.0f) velocity = {hx / h * speed, hy / h * speed};
+            }
+        }
+        position.x += velocity.x * dt;
+        position.y += velocity.y * dt;
+        life -= dt;
+        if (life <= 0.0f || position.x < -50.0f || position.x > FieldWidth() + 50.0f ||
+            position.y < -50.0f || position.y > FieldHeight() + 50.0f) {
+            active = false;
+        }
+    }
+
+    Rectangle Bounds() const {
+        return {position.x - 4.0f, position.y - 4.0f, 8.0f, 8.0f};
+    }
+
+    void Draw() {
+        if (active) {
+            DrawLineV(position, {position.x - velocity.x * 0.03f, position.y - velocity.y * 0.03f}, ORANGE);
+            DrawCircleV(position, 4.0f, YELLOW);
+        }
+    }
+};
+
+// A piercing beam along the ship's row. The world resolves what it hits on
+// the next update and sets its length; it then stays on screen briefly.
+class LaserBeam {
+public:
+    Vector2 origin;
+    float length;
+    float thickness;
+    int pierce;      // obstacles it can destroy
+    float timeLeft;
+    bool resolved;
+    bool active;
+
+    LaserBeam(float x, float y) {
+        origin = {x, y};
+        length = 0.0f;
+        thickness = 6.0f;
+        pierce = 4;
+        timeLeft = 0.12f;
+        resolved = false;
+        active = true;
+    }
+
+    void Update() {
+        if (active && resolved) {
+            timeLeft -= FrameTime();
+            if (timeLeft <= 0.0f) active = false;
+        }
+    }
+
+    void Draw() {
+        if (active && resolved) {
+            DrawRectangleRec({origin.x, origin.y - thickness / 2, length, thickness}, SKYBLUE);
+            DrawRectangleRec({origin.x, origin.y - 1.0f, length, 2.0f}, WHITE);
+        }
+    }
 };
 
 class Asteroid {
@@ -125,7 +298,7 @@ public:
     bool active;
 
     Asteroid(float y, float vx, float rad) {
-        position = {GetScreenWidth() + 50.0f, y};
+        position = {FieldWidth() + 50.0f, y};
         velocity = {vx, 0.0f};
         this->radius = rad;
         active = false;
@@ -140,7 +313,7 @@ public:
 
     void Update() {
         if (active) {
-            position.x += velocity.x * GetFrameTime();
+            position.x += velocity.x * FrameTime();
             if (position.x < -50) {
                 active = false;
             }
@@ -154,6 +327,11 @@ public:
     }
 };
 
+// Tags obstacles in the spatial index and in game events. Worth kind + 1
+// points for a kill unless the tuning file says otherwise, and costs as much
+// when it gets past.
+enum ObstacleKind {KIND_STAR = 0, KIND_POLRI, KIND_OPM, KIND_GIBRAN, KIND_MA, KIND_COUNT};
+
 class Star {
 public:
     Vector2 position, velocity;
@@ -162,24 +340,20 @@ public:
     Rectangle destRec;
     Vector2 origin;
     bool active;
+    bool ownsTexture;
 
-    Star(const char* texturePath, float vx, float scale) {
-        Image image = LoadImage(texturePath);
-        if (image.data == nullptr) {
-            cerr << "Failed to load Star texture!" << endl;
-            exit(-1);
-        }
-
-        texture = LoadTextureFromImage(image);
-        UnloadImage(image);
-
-        sourceRec = {0.0f, 0.0f, (float)texture.width, (float)texture.height};
-        destRec = {GetScreenWidth() + 50.0f, 0.0f, (float)texture.width, (float)texture.height};
+    // Prototypes start without a texture; the asset loader attaches it.
+    Star(float vx) {
+        texture = {0};
+        sourceRec = {0.0f, 0.0f, 0.0f, 0.0f};
+        destRec = {FieldWidth() + 50.0f, 0.0f, 0.0f, 0.0f};
         origin = {0.0f, 0.0f};
         velocity = {vx, 0.0f};
         active = false;
+        ownsTexture = false;
     }
 
+    // Clones share the prototype's texture, only the prototype unloads it.
     Star(const Star& other) {
         texture = other.texture; 
         sourceRec = other.sourceRec;
@@ -188,20 +362,33 @@ public:
         velocity = other.velocity;
         position = other.position;
         active = other.active;
+        ownsTexture = false;
     }
 
     ~Star() {
-        UnloadTexture(texture);
+        if (ownsTexture) UnloadTexture(texture);
+    }
+
+    bool Ready() const {
+        return texture.width > 0;
+    }
+
+    void AttachTexture(Texture2D loaded) {
+        texture = loaded;
+        ownsTexture = true;
+        sourceRec = {0.0f, 0.0f, (float)texture.width, (float)texture.height};
+        destRec.width = (float)texture.width;
+        destRec.height = (float)texture.height;
     }
 
-    void Update(int& score) {
+    void Update(EventBuffer& events) {
         if (active) {
-            position.x += velocity.x * GetFrameTime();
+            position.x += velocity.x * FrameTime();
             destRec.x = position.x;
 
             if (position.x + destRec.width < 0) {
                 active = false;
-                score -= 1;
+                events.Push(EVENT_MISS, SOURCE_NONE, KIND_STAR, destRec.x, destRec.y, destRec.width, destRec.height);
             }
         }
     }
@@ -221,22 +408,16 @@ public:
     Rectangle destRec;
     Vector2 origin;
     bool active;
+    bool ownsTexture;
 
-    Polri(const char* texturePath, float vx, float scale) {
-        Image image = LoadImage(texturePath);
-        if (image.data == nullptr) {
-            cerr << "Failed to load Polri texture!" << endl;
-            exit(-1);
-        }
-
-        texture = LoadTextureFromImage(image);
-        UnloadImage(image);
-
-        sourceRec = {0.0f, 0.0f, (float)texture.width, (float)texture.height};
-        destRec = {GetScreenWidth() + 50.0f, 0.0f, (float)texture.width, (float)texture.height};
+    Polri(float vx) {
+        texture = {0};
+        sourceRec = {0.0f, 0.0f, 0.0f, 0.0f};
+        destRec = {FieldWidth() + 50.0f, 0.0f, 0.0f, 0.0f};
         origin = {0.0f, 0.0f};
         velocity = {vx, 0.0f};
         active = false;
+        ownsTexture = false;
     }
 
     Polri(const Polri& other) {
@@ -247,20 +428,33 @@ public:
         velocity = other.velocity;
         position = other.position;
         active = other.active;
+        ownsTexture = false;
     }
 
     ~Polri() {
-        UnloadTexture(texture);
+        if (ownsTexture) UnloadTexture(texture);
     }
 
-    void Update(int& score) {
+    bool Ready() const {
+        return texture.width > 0;
+    }
+
+    void AttachTexture(Texture2D loaded) {
+        texture = loaded;
+        ownsTexture = true;
+        sourceRec = {0.0f, 0.0f, (float)texture.width, (float)texture.height};
+        destRec.width = (float)texture.width;
+        destRec.height = (float)texture.height;
+    }
+
+    void Update(EventBuffer& events) {
         if (active) {
-            position.x += velocity.x * GetFrameTime();
+            position.x += velocity.x * FrameTime();
             destRec.x = position.x;
 
             if (position.x + destRec.width < 0) {
                 active = false;
-                score -= 2;
+                events.Push(EVENT_MISS, SOURCE_NONE, KIND_POLRI, destRec.x, destRec.y, destRec.width, destRec.height);
             }
         }
     }
@@ -280,22 +474,16 @@ public:
     Rectangle destRec;
     Vector2 origin;
     bool active;
+    bool ownsTexture;
 
-    OPM(const char* texturePath, float vx, float scale) {
-        Image image = LoadImage(texturePath);
-        if (image.data == nullptr) {
-            cerr << "Failed to load OPM texture!" << endl;
-            exit(-1);
-        }
-
-        texture = LoadTextureFromImage(image);
-        UnloadImage(image);
-
-        sourceRec = {0.0f, 0.0f, (float)texture.width, (float)texture.height};
-        destRec = {GetScreenWidth() + 50.0f, 0.0f, (float)texture.width, (float)texture.height};
+    OPM(float vx) {
+        texture = {0};
+        sourceRec = {0.0f, 0.0f, 0.0f, 0.0f};
+        destRec = {FieldWidth() + 50.0f, 0.0f, 0.0f, 0.0f};
         origin = {0.0f, 0.0f};
         velocity = {vx, 0.0f};
         active = false;
+        ownsTexture = false;
     }
 
     OPM(const OPM& other) {
@@ -306,20 +494,33 @@ public:
         velocity = other.velocity;
         position = other.position;
         active = other.active;
+        ownsTexture = false;
     }
 
     ~OPM() {
-        UnloadTexture(texture);
+        if (ownsTexture) UnloadTexture(texture);
+    }
+
+    bool Ready() const {
+        return texture.width > 0;
+    }
+
+    void AttachTexture(Texture2D loaded) {
+        texture = loaded;
+        ownsTexture = true;
+        sourceRec = {0.0f, 0.0f, (float)texture.width, (float)texture.height};
+        destRec.width = (float)texture.width;
+        destRec.height = (float)texture.height;
     }
 
-    void Update(int& score) {
+    void Update(EventBuffer& events) {
         if (active) {
-            position.x += velocity.x * GetFrameTime();
+            position.x += velocity.x * FrameTime();
             destRec.x = position.x;
 
             if (position.x + destRec.width < 0) {
                 active = false;
-                score -= 3;
+                events.Push(EVENT_MISS, SOURCE_NONE, KIND_OPM, destRec.x, destRec.y, destRec.width, destRec.height);
             }
         }
     }
@@ -339,22 +540,16 @@ public:
     Rectangle destRec;
     Vector2 origin;
     bool active;
+    bool ownsTexture;
 
-    Gibran(const char* texturePath, float vx, float scale) {
-        Image image = LoadImage(texturePath);
-        if (image.data == nullptr) {
-            cerr << "Failed to load Gibran texture!" << endl;
-            exit(-1);
-        }
-
-        texture = LoadTextureFromImage(image);
-        UnloadImage(image);
-
-        sourceRec = {0.0f, 0.0f, (float)texture.width, (float)texture.height};
-        destRec = {GetScreenWidth() + 50.0f, 0.0f, (float)texture.width, (float)texture.height};
+    Gibran(float vx) {
+        texture = {0};
+        sourceRec = {0.0f, 0.0f, 0.0f, 0.0f};
+        destRec = {FieldWidth() + 50.0f, 0.0f, 0.0f, 0.0f};
         origin = {0.0f, 0.0f};
         velocity = {vx, 0.0f};
         active = false;
+        ownsTexture = false;
     }
 
     Gibran(const Gibran& other) {
@@ -365,20 +560,33 @@ public:
         velocity = other.velocity;
         position = other.position;
         active = other.active;
+        ownsTexture = false;
     }
 
     ~Gibran() {
-        UnloadTexture(texture);
+        if (ownsTexture) UnloadTexture(texture);
+    }
+
+    bool Ready() const {
+        return texture.width > 0;
     }
 
-    void Update(int& score) {
+    void AttachTexture(Texture2D loaded) {
+        texture = loaded;
+        ownsTexture = true;
+        sourceRec = {0.0f, 0.0f, (float)texture.width, (float)texture.height};
+        destRec.width = (float)texture.width;
+        destRec.height = (float)texture.height;
+    }
+
+    void Update(EventBuffer& events) {
         if (active) {
-            position.x += velocity.x * GetFrameTime();
+            position.x += velocity.x * FrameTime();
             destRec.x = position.x;
 
             if (position.x + destRec.width < 0) {
                 active = false;
-                score -= 4;
+                events.Push(EVENT_MISS, SOURCE_NONE, KIND_GIBRAN, destRec.x, destRec.y, destRec.width, destRec.height);
             }
         }
     }
@@ -398,22 +606,16 @@ public:
     Rectangle destRec;
     Vector2 origin;
     bool active;
+    bool ownsTexture;
 
-    MA(const char* texturePath, float vx, float scale) {
-        Image image = LoadImage(texturePath);
-        if (image.data == nullptr) {
-            cerr << "Failed to load MA texture!" << endl;
-            exit(-1);
-        }
-
-        texture = LoadTextureFromImage(image);
-        UnloadImage(image);
-
-        sourceRec = {0.0f, 0.0f, (float)texture.width, (float)texture.height};
-        destRec = {GetScreenWidth() + 50.0f, 0.0f, (float)texture.width, (float)texture.height};
+    MA(float vx) {
+        texture = {0};
+        sourceRec = {0.0f, 0.0f, 0.0f, 0.0f};
+        destRec = {FieldWidth() + 50.0f, 0.0f, 0.0f, 0.0f};
         origin = {0.0f, 0.0f};
         velocity = {vx, 0.0f};
         active = false;
+        ownsTexture = false;
     }
 
     MA(const MA& other) {
@@ -424,20 +626,33 @@ public:
         velocity = other.velocity;
         position = other.position;
         active = other.active;
+        ownsTexture = false;
     }
 
     ~MA() {
-        UnloadTexture(texture);
+        if (ownsTexture) UnloadTexture(texture);
+    }
+
+    bool Ready() const {
+        return texture.width > 0;
+    }
+
+    void AttachTexture(Texture2D loaded) {
+        texture = loaded;
+        ownsTexture = true;
+        sourceRec = {0.0f, 0.0f, (float)texture.width, (float)texture.height};
+        destRec.width = (float)texture.width;
+        destRec.height = (float)texture.height;
     }
 
-    void Update(int& score) {
+    void Update(EventBuffer& events) {
         if (active) {
-            position.x += velocity.x * GetFrameTime();
+            position.x += velocity.x * FrameTime();
             destRec.x = position.x;
 
             if (position.x + destRec.width < 0) {
                 active = false;
-                score -= 5;
+                events.Push(EVENT_MISS, SOURCE_NONE, KIND_MA, destRec.x, destRec.y, destRec.width, destRec.height);
             }
         }
     }
@@ -455,7 +670,7 @@ public:
 class BulletPrototype {
 public:
     virtual ~BulletPrototype() {}
-    virtual Bullet* clone(float x, float y) = 0;
+    virtual Bullet clone(float x, float y) = 0;
 };
 
 class BulletSpawn : public BulletPrototype {
@@ -465,10 +680,10 @@ private:
 public:
     BulletSpawn(Bullet* bullet) : prototypeBullet(bullet) {}
 
-    Bullet* clone(float x, float y) override {
-        Bullet* bullet = new Bullet(*prototypeBullet);
-        bullet->position = {x, y};
-        bullet->active = true;
+    Bullet clone(float x, float y) override {
+        Bullet bullet(*prototypeBullet);
+        bullet.position = {x, y};
+        bullet.active = true;
         return bullet;
     }
 };
@@ -476,7 +691,7 @@ public:
 class AsteroidPrototype {
 public:
     virtual ~AsteroidPrototype() {}
-    virtual Asteroid* clone(float y, float vx, float rad) = 0;
+    virtual Asteroid clone(float y, float vx, float rad) = 0;
 };
 
 class AsteroidSpawn : public AsteroidPrototype {
@@ -485,12 +700,12 @@ private:
 
 public:
     AsteroidSpawn(Asteroid* asteroid) : prototypeAsteroid(asteroid) {}
-    Asteroid* clone(float y, float vx, float rad) override {
-        Asteroid* asteroid = new Asteroid(*prototypeAsteroid);
-        asteroid->position = {GetScreenWidth() + 50.0f, y};
-        asteroid->velocity = {vx, 0.0f};
-        asteroid->radius = rad;
-        asteroid->active = true;
+    Asteroid clone(float y, float vx, float rad) override {
+        Asteroid asteroid(*prototypeAsteroid);
+        asteroid.position = {FieldWidth() + 50.0f, y};
+        asteroid.velocity = {vx, 0.0f};
+        asteroid.radius = rad;
+        asteroid.active = true;
         return asteroid;
     }
 };
@@ -498,7 +713,7 @@ public:
 class StarPrototype {
 public:
     virtual ~StarPrototype() {}
-    virtual Star* clone(float y, float vx, float scale) = 0;
+    virtual Star clone(float y, float vx, float scale) = 0;
 };
 
 class StarSpawn : public StarPrototype {
@@ -508,14 +723,14 @@ private:
 public:
     StarSpawn(Star* star) : prototypeStar(star) {}
 
-    Star* clone(float y, float vx, float scale) override {
-        Star* star = new Star(*prototypeStar);
-        star->position = {GetScreenWidth() + 50.0f, y};
-        star->velocity = {vx, 0.0f};
-        star->destRec.y = y;
-        star->destRec.width = prototypeStar->texture.width * scale;
-        star->destRec.height = prototypeStar->texture.height * scale;
-        star->active = true;
+    Star clone(float y, float vx, float scale) override {
+        Star star(*prototypeStar);
+        star.position = {FieldWidth() + 50.0f, y};
+        star.velocity = {vx, 0.0f};
+        star.destRec.y = y;
+        star.destRec.width = prototypeStar->texture.width * scale;
+        star.destRec.height = prototypeStar->texture.height * scale;
+        star.active = true;
         return star;
     }
 };
@@ -523,7 +738,7 @@ public:
 class PolriPrototype {
 public:
     virtual ~PolriPrototype() {}
-    virtual Polri* clone(float y, float vx, float scale) = 0;
+    virtual Polri clone(float y, float vx, float scale) = 0;
 };
 
 class PolriSpawn : public PolriPrototype {
@@ -533,14 +748,14 @@ private:
 public:
     PolriSpawn(Polri* polri) : prototypePolri(polri) {}
 
-    Polri* clone(float y, float vx, float scale) override {
-        Polri* polri = new Polri(*prototypePolri);
-        polri->position = {GetScreenWidth() + 50.0f, y};
-        polri->velocity = {vx, 0.0f};
-        polri->destRec.y = y;
-        polri->destRec.width = prototypePolri->texture.width * scale;
-        polri->destRec.height = prototypePolri->texture.height * scale;
-        polri->active = true;
+    Polri clone(float y, float vx, float scale) override {
+        Polri polri(*prototypePolri);
+        polri.position = {FieldWidth() + 50.0f, y};
+        polri.velocity = {vx, 0.0f};
+        polri.destRec.y = y;
+        polri.destRec.width = prototypePolri->texture.width * scale;
+        polri.destRec.height = prototypePolri->texture.height * scale;
+        polri.active = true;
         return polri;
     }
 };
@@ -548,7 +763,7 @@ public:
 class OPMPrototype {
 public:
     virtual ~OPMPrototype() {}
-    virtual OPM* clone(float y, float vx, float scale) = 0;
+    virtual OPM clone(float y, float vx, float scale) = 0;
 };
 
 class OPMSpawn : public OPMPrototype {
@@ -558,14 +773,14 @@ private:
 public:
     OPMSpawn(OPM* opm) : prototypeOPM(opm) {}
 
-    OPM* clone(float y, float vx, float scale) override {
-        OPM* opm = new OPM(*prototypeOPM);
-        opm->position = {GetScreenWidth() + 50.0f, y};
-        opm->velocity = {vx, 0.0f};
-        opm->destRec.y = y;
-        opm->destRec.width = prototypeOPM->texture.width * scale;
-        opm->destRec.height = prototypeOPM->texture.height * scale;
-        opm->active = true;
+    OPM clone(float y, float vx, float scale) override {
+        OPM opm(*prototypeOPM);
+        opm.position = {FieldWidth() + 50.0f, y};
+        opm.velocity = {vx, 0.0f};
+        opm.destRec.y = y;
+        opm.destRec.width = prototypeOPM->texture.width * scale;
+        opm.destRec.height = prototypeOPM->texture.height * scale;
+        opm.active = true;
         return opm;
     }
 };
@@ -573,7 +788,7 @@ public:
 class GibranPrototype {
 public:
     virtual ~GibranPrototype() {}
-    virtual Gibran* clone(float y, float vx, float scale) = 0;
+    virtual Gibran clone(float y, float vx, float scale) = 0;
 };
 
 class GibranSpawn : public GibranPrototype {
@@ -583,14 +798,14 @@ private:
 public:
     GibranSpawn(Gibran* gibran) : prototypeGibran(gibran) {}
 
-    Gibran* clone(float y, float vx, float scale) override {
-        Gibran* gibran = new Gibran(*prototypeGibran);
-        gibran->position = {GetScreenWidth() + 50.0f, y};
-        gibran->velocity = {vx, 0.0f};
-        gibran->destRec.y = y;
-        gibran->destRec.width = prototypeGibran->texture.width * scale;
-        gibran->destRec.height = prototypeGibran->texture.height * scale;
-        gibran->active = true;
+    Gibran clone(float y, float vx, float scale) override {
+        Gibran gibran(*prototypeGibran);
+        gibran.position = {FieldWidth() + 50.0f, y};
+        gibran.velocity = {vx, 0.0f};
+        gibran.destRec.y = y;
+        gibran.destRec.width = prototypeGibran->texture.width * scale;
+        gibran.destRec.height = prototypeGibran->texture.height * scale;
+        gibran.active = true;
         return gibran;
     }
 };
@@ -598,7 +813,7 @@ public:
 class MAPrototype {
 public:
     virtual ~MAPrototype() {}
-    virtual MA* clone(float y, float vx, float scale) = 0;
+    virtual MA clone(float y, float vx, float scale) = 0;
 };
 
 class MASpawn : public MAPrototype {
@@ -608,14 +823,14 @@ private:
 public:
     MASpawn(MA* ma) : prototypeMA(ma) {}
 
-    MA* clone(float y, float vx, float scale) override {
-        MA* ma = new MA(*prototypeMA);
-        ma->position = {GetScreenWidth() + 50.0f, y};
-        ma->velocity = {vx, 0.0f};
-        ma->destRec.y = y;
-        ma->destRec.width = prototypeMA->texture.width * scale;
-        ma->destRec.height = prototypeMA->texture.height * scale;
-        ma->active = true;
+    MA clone(float y, float vx, float scale) override {
+        MA ma(*prototypeMA);
+        ma.position = {FieldWidth() + 50.0f, y};
+        ma.velocity = {vx, 0.0f};
+        ma.destRec.y = y;
+        ma.destRec.width = prototypeMA->texture.width * scale;
+        ma.destRec.height = prototypeMA->texture.height * scale;
+        ma.active = true;
         return ma;
     }
 };
@@ -623,6 +838,21 @@ public:
 //#####################
 //Command
 //#####################
+// Every spawner draws from its own stream of the world seed.
+enum RandomStreamId {
+    STREAM_ASTEROID = 1,
+    STREAM_STAR,
+    STREAM_POLRI,
+    STREAM_OPM,
+    STREAM_GIBRAN,
+    STREAM_MA,
+    STREAM_EFFECTS,
+    STREAM_WAVES,
+    STREAM_CHUNKS,
+    STREAM_SIM,  // to STREAM_SIM + SIM_KINDS - 1
+    STREAM_PILOT = STREAM_SIM + SIM_KINDS,
+};
+
 class Command {
 public:
     virtual ~Command() {}
@@ -631,146 +861,247 @@ public:
 
 class FlyCommand : public Command {
 private:
-    Ship* ship;  
+    Ship& ship;
     bool isFlying;
 
 public:
-    FlyCommand(Ship* ship, bool isFlying) : ship(ship), isFlying(isFlying) {}
+    FlyCommand(Ship& ship, bool isFlying) : ship(ship), isFlying(isFlying) {}
 
     void execute() override {
-        ship->Fly(isFlying);
+        ship.Fly(isFlying);
     }
 };
 
 class ShootCommand : public Command {
 private:
-    Ship* ship;
-    BulletSpawn* bulletPrototype;
-    vector<Bullet*>& bullets;
+    Ship& ship;
+    BulletSpawn& bulletPrototype;
+    EntityPool<Bullet>& bullets;
+    LoadGovernor* governor;
+    EventQueue* events;
 
 public:
-    ShootCommand(Ship* ship, BulletSpawn* spawnBullet, vector<Bullet*>& bullets)
-        : ship(ship), bulletPrototype(spawnBullet), bullets(bullets) {}
+    ShootCommand(Ship& ship, BulletSpawn& spawnBullet, EntityPool<Bullet>& bullets, LoadGovernor* governor = nullptr,
+                 EventQueue* events = nullptr)
+        : ship(ship), bulletPrototype(spawnBullet), bullets(bullets), governor(governor), events(events) {}
 
     void execute() override {
-        float bulletX = ship->destRec.x + ship->destRec.width;
-        float bulletY = ship->destRec.y + ship->destRec.height / 2;
-        Bullet* bullet = bulletPrototype->clone(bulletX, bulletY);
-        bullets.push_back(bullet);
+        if (governor && !governor->AllowBullet((int)bullets.size())) {
+            return;
+        }
+        float bulletX = ship.destRec.x + ship.destRec.width;
+        float bulletY = ship.destRec.y + ship.destRec.height / 2;
+        bullets.Add(bulletPrototype.clone(bulletX, bulletY));
+        if (events) events->Buffer(PHASE_INPUT).Push(EVENT_SHOT, SOURCE_BULLET, -1, bulletX, bulletY, 0.0f, 0.0f);
+    }
+};
+
+// Missiles and lasers count against the governor's bullet cap together
+// with the bullets already in flight.
+class MissileCommand : public Command {
+private:
+    Ship& ship;
+    const EntityPool<Bullet>& bullets;
+    EntityPool<Missile>& missiles;
+    LoadGovernor* governor;
+
+public:
+    MissileCommand(Ship& ship, const EntityPool<Bullet>& bullets, EntityPool<Missile>& missiles,
+                   LoadGovernor* governor = nullptr)
+        : ship(ship), bullets(bullets), missiles(missiles), governor(governor) {}
+
+    void execute() override {
+        if (governor && !governor->AllowBullet((int)(bullets.size() + missiles.size()))) {
+            return;
+        }
+        missiles.Add(Missile(ship.destRec.x + ship.destRec.width, ship.destRec.y + ship.destRec.height / 2));
+    }
+};
+
+class LaserCommand : public Command {
+private:
+    Ship& ship;
+    const EntityPool<Bullet>& bullets;
+    const EntityPool<Missile>& missiles;
+    EntityPool<LaserBeam>& lasers;
+    LoadGovernor* governor;
+
+public:
+    LaserCommand(Ship& ship, const EntityPool<Bullet>& bullets, const EntityPool<Missile>& missiles,
+                 EntityPool<LaserBeam>& lasers, LoadGovernor* governor = nullptr)
+        : ship(ship), bullets(bullets), missiles(missiles), lasers(lasers), governor(governor) {}
+
+    void execute() override {
+        if (governor && !governor->AllowBullet((int)(bullets.size() + missiles.size() + lasers.size()))) {
+            return;
+        }
+        lasers.Add(LaserBeam(ship.destRec.x + ship.destRec.width, ship.destRec.y + ship.destRec.height / 2));
     }
 };
 
 class SpawnAsteroidCommand : public Command {
 private:
-    AsteroidSpawn* asteroidPrototype;
-    vector<Asteroid*>& asteroids;
+    AsteroidSpawn& asteroidPrototype;
+    EntityPool<Asteroid>& asteroids;
+    RandomStream rng;
 
 public:
-    SpawnAsteroidCommand(AsteroidSpawn* spawnAsteroid, vector<Asteroid*>& asteroids)
-        : asteroidPrototype(spawnAsteroid), asteroids(asteroids) {}
+    SpawnAsteroidCommand(AsteroidSpawn& spawnAsteroid, EntityPool<Asteroid>& asteroids, uint64_t seed = 0)
+        : asteroidPrototype(spawnAsteroid), asteroids(asteroids), rng(seed, STREAM_ASTEROID) {}
     void execute() override {
-        float y = GetRandomValue(0, GetScreenHeight());
-        float vx = GetRandomValue(-2000, -1000) / 10.0f;
-        float rad = GetRandomValue(10, 50);
+        float y = rng.Range(0, FieldHeight());
+        float vx = rng.Range(-2000, -1000) / 10.0f;
+        float rad = rng.Range(10, 50);
 
-        Asteroid* asteroid = asteroidPrototype->clone(y, vx, rad);
-        asteroids.push_back(asteroid);
+        asteroids.Add(asteroidPrototype.clone(y, vx, rad));
     }
 };
 
+// Draws a whole burst's parameters in one batch, with the same results as
+// calling the command's execute() count times.
+template <typename Spawn, typename T>
+void SpawnBurst(RandomStream& rng, const KindTuning& tuning, vector<SpawnParams>& scratch, Spawn& prototype,
+                EntityPool<T>& pool, int count) {
+    scratch.resize(count);
+    FillSpawnBatch(rng, {0, FieldHeight(), tuning.vxMin, tuning.vxMax, tuning.vxDivisor, tuning.scaleMin,
+                         tuning.scaleMax, tuning.scaleDivisor},
+                   scratch.data(), count);
+    for (const SpawnParams& p : scratch) pool.Add(prototype.clone(p.y, p.vx, p.scale));
+}
+
 class SpawnStarCommand : public Command {
 private:
-    StarSpawn* StarPrototype;
-    std::vector<Star*>& stars;
+    StarSpawn& StarPrototype;
+    EntityPool<Star>& stars;
+    const KindTuning& tuning;
+    RandomStream rng;
+    vector<SpawnParams> burst;  // reused by executeBurst
 
 public:
-    SpawnStarCommand(StarSpawn* spawnStar, std::vector<Star*>& stars)
-        : StarPrototype(spawnStar), stars(stars) {}
+    SpawnStarCommand(StarSpawn& spawnStar, EntityPool<Star>& stars, const KindTuning& tuning, uint64_t seed = 0)
+        : StarPrototype(spawnStar), stars(stars), tuning(tuning), rng(seed, STREAM_STAR) {}
+
+    void reseed(uint64_t seed) {
+        rng.Seed(seed, STREAM_STAR);
+    }
 
     void execute() override {
-        float y = GetRandomValue(0, GetScreenHeight());
-        float vx = GetRandomValue(-2000, -1000) / 10.0f;
-        float scale = GetRandomValue(20, 50) / 100.0f;
+        float y = rng.Range(0, FieldHeight());
+        float vx = rng.Range(tuning.vxMin, tuning.vxMax) / tuning.vxDivisor;
+        float scale = rng.Range(tuning.scaleMin, tuning.scaleMax) / tuning.scaleDivisor;
 
-        Star* star = StarPrototype->clone(y, vx, scale);
-        stars.push_back(star);
+        stars.Add(StarPrototype.clone(y, vx, scale));
     }
+
+    void executeBurst(int count) { SpawnBurst(rng, tuning, burst, StarPrototype, stars, count); }
 };
 
 class SpawnPolriCommand : public Command {
 private:
-    PolriSpawn* PolriPrototype;
-    std::vector<Polri*>& polris;
+    PolriSpawn& PolriPrototype;
+    EntityPool<Polri>& polris;
+    const KindTuning& tuning;
+    RandomStream rng;
+    vector<SpawnParams> burst;  // reused by executeBurst
 
 public:
-    SpawnPolriCommand(PolriSpawn* spawnPolri, std::vector<Polri*>& polris)
-        : PolriPrototype(spawnPolri), polris(polris) {}
+    SpawnPolriCommand(PolriSpawn& spawnPolri, EntityPool<Polri>& polris, const KindTuning& tuning, uint64_t seed = 0)
+        : PolriPrototype(spawnPolri), polris(polris), tuning(tuning), rng(seed, STREAM_POLRI) {}
+
+    void reseed(uint64_t seed) {
+        rng.Seed(seed, STREAM_POLRI);
+    }
 
     void execute() override {
-        float y = GetRandomValue(0, GetScreenHeight());
-        float vx = GetRandomValue(-2000, -1000) / 10.0f;
-        float scale = GetRandomValue(20, 50) / 500.0f;
+        float y = rng.Range(0, FieldHeight());
+        float vx = rng.Range(tuning.vxMin, tuning.vxMax) / tuning.vxDivisor;
+        float scale = rng.Range(tuning.scaleMin, tuning.scaleMax) / tuning.scaleDivisor;
 
-        Polri* polri = PolriPrototype->clone(y, vx, scale);
-        polris.push_back(polri);
+        polris.Add(PolriPrototype.clone(y, vx, scale));
     }
+
+    void executeBurst(int count) { SpawnBurst(rng, tuning, burst, PolriPrototype, polris, count); }
 };
 
 class SpawnOPMCommand : public Command {
 private:
-    OPMSpawn* OPMPrototype;
-    std::vector<OPM*>& opms;
+    OPMSpawn& OPMPrototype;
+    EntityPool<OPM>& opms;
+    const KindTuning& tuning;
+    RandomStream rng;
+    vector<SpawnParams> burst;  // reused by executeBurst
 
 public:
-    SpawnOPMCommand(OPMSpawn* spawnOPM, std::vector<OPM*>& opms)
-        : OPMPrototype(spawnOPM), opms(opms) {}
+    SpawnOPMCommand(OPMSpawn& spawnOPM, EntityPool<OPM>& opms, const KindTuning& tuning, uint64_t seed = 0)
+        : OPMPrototype(spawnOPM), opms(opms), tuning(tuning), rng(seed, STREAM_OPM) {}
+
+    void reseed(uint64_t seed) {
+        rng.Seed(seed, STREAM_OPM);
+    }
 
     void execute() override {
-        float y = GetRandomValue(0, GetScreenHeight());
-        float vx = GetRandomValue(-2000, -1000) / 10.0f;
-        float scale = GetRandomValue(20, 50) / 100.0f;
+        float y = rng.Range(0, FieldHeight());
+        float vx = rng.Range(tuning.vxMin, tuning.vxMax) / tuning.vxDivisor;
+        float scale = rng.Range(tuning.scaleMin, tuning.scaleMax) / tuning.scaleDivisor;
 
-        OPM* opm = OPMPrototype->clone(y, vx, scale);
-        opms.push_back(opm);
+        opms.Add(OPMPrototype.clone(y, vx, scale));
     }
+
+    void executeBurst(int count) { SpawnBurst(rng, tuning, burst, OPMPrototype, opms, count); }
 };
 
 class SpawnGibranCommand : public Command {
 private:
-    GibranSpawn* GibranPrototype;
-    std::vector<Gibran*>& gibrans;
+    GibranSpawn& GibranPrototype;
+    EntityPool<Gibran>& gibrans;
+    const KindTuning& tuning;
+    RandomStream rng;
+    vector<SpawnParams> burst;  // reused by executeBurst
 
 public:
-    SpawnGibranCommand(GibranSpawn* spawnGibran, std::vector<Gibran*>& gibrans)
-        : GibranPrototype(spawnGibran), gibrans(gibrans) {}
+    SpawnGibranCommand(GibranSpawn& spawnGibran, EntityPool<Gibran>& gibrans, const KindTuning& tuning, uint64_t seed = 0)
+        : GibranPrototype(spawnGibran), gibrans(gibrans), tuning(tuning), rng(seed, STREAM_GIBRAN) {}
+
+    void reseed(uint64_t seed) {
+        rng.Seed(seed, STREAM_GIBRAN);
+    }
 
     void execute() override {
-        float y = GetRandomValue(0, GetScreenHeight());
-        float vx = GetRandomValue(-2000, -1000) / 10.0f;
-        float scale = GetRandomValue(20, 30) / 100.0f;
+        float y = rng.Range(0, FieldHeight());
+        float vx = rng.Range(tuning.vxMin, tuning.vxMax) / tuning.vxDivisor;
+        float scale = rng.Range(tuning.scaleMin, tuning.scaleMax) / tuning.scaleDivisor;
 
-        Gibran* gibran = GibranPrototype->clone(y, vx, scale);
-        gibrans.push_back(gibran);
+        gibrans.Add(GibranPrototype.clone(y, vx, scale));
     }
+
+    void executeBurst(int count) { SpawnBurst(rng, tuning, burst, GibranPrototype, gibrans, count); }
 };
 
 class SpawnMACommand : public Command {
 private:
-    MASpawn* MAPrototype;
-    std::vector<MA*>& mas;
+    MASpawn& MAPrototype;
+    EntityPool<MA>& mas;
+    const KindTuning& tuning;
+    RandomStream rng;
+    vector<SpawnParams> burst;  // reused by executeBurst
 
 public:
-    SpawnMACommand(MASpawn* spawnMA, std::vector<MA*>& mas)
-        : MAPrototype(spawnMA), mas(mas) {}
+    SpawnMACommand(MASpawn& spawnMA, EntityPool<MA>& mas, const KindTuning& tuning, uint64_t seed = 0)
+        : MAPrototype(spawnMA), mas(mas), tuning(tuning), rng(seed, STREAM_MA) {}
+
+    void reseed(uint64_t seed) {
+        rng.Seed(seed, STREAM_MA);
+    }
 
     void execute() override {
-        float y = GetRandomValue(0, GetScreenHeight());
-        float vx = GetRandomValue(-2000, -1000) / 10.0f;
-        float scale = GetRandomValue(20, 50) / 500.0f;
+        float y = rng.Range(0, FieldHeight());
+        float vx = rng.Range(tuning.vxMin, tuning.vxMax) / tuning.vxDivisor;
+        float scale = rng.Range(tuning.scaleMin, tuning.scaleMax) / tuning.scaleDivisor;
 
-        MA* ma = MAPrototype->clone(y, vx, scale);
-        mas.push_back(ma);
+        mas.Add(MAPrototype.clone(y, vx, scale));
     }
+
+    void executeBurst(int count) { SpawnBurst(rng, tuning, burst, MAPrototype, mas, count); }
 };
 
 class InputHandler {
@@ -778,10 +1109,13 @@ private:
     Command* flyCommand;
     Command* fallCommand;
     Command* shootCommand;
+    Command* missileCommand;
+    Command* laserCommand;
 
 public:
-    InputHandler(Command* flyCmd, Command* fallCmd, Command* shootCmd)
-        : flyCommand(flyCmd), fallCommand(fallCmd), shootCommand(shootCmd) {}
+    InputHandler(Command* flyCmd, Command* fallCmd, Command* shootCmd, Command* missileCmd, Command* laserCmd)
+        : flyCommand(flyCmd), fallCommand(fallCmd), shootCommand(shootCmd),
+          missileCommand(missileCmd), laserCommand(laserCmd) {}
 
     void handleInput() {
         if (IsMouseButtonDown(MOUSE_BUTTON_LEFT)) {
@@ -792,456 +1126,3892 @@ public:
         if (IsKeyPressed(KEY_E)) { 
             shootCommand->execute();
         }
+        if (IsKeyPressed(KEY_Q)) {
+            missileCommand->execute();
+        }
+        if (IsKeyPressed(KEY_F)) {
+            laserCommand->execute();
+        }
     }
 };
 
 //#####################
 //Main Game Loop
 //#####################
-// Function to reset all obstacles
-void ResetObstacles(std::vector<Star*>& stars, std::vector<Polri*>& polris,
-                    std::vector<OPM*>& opms, std::vector<Gibran*>& gibrans,
-                    std::vector<MA*>& mas) {
-    for (auto* star : stars) {
-        star->active = false;
-        star->position = {GetScreenWidth() + 50.0f, 0.0f};
-        star->destRec.x = star->position.x;
-        star->destRec.y = 0.0f; 
-    }
-
-    for (auto* polri : polris) {
-        polri->active = false;
-        polri->position = {GetScreenWidth() + 50.0f, 0.0f};
-        polri->destRec.x = polri->position.x;
-        polri->destRec.y = 0.0f; 
-    }
+// Drops inactive entities so the per-frame loops only walk live objects.
+// Order is kept, so the collision loops still see bullets oldest first.
+template <typename T>
+void SweepInactive(EntityPool<T>& items) {
+    items.RemoveIf([](const T& item) { return !item.active; });
+}
 
-    for (auto* opm : opms) {
-        opm->active = false;
-        opm->position = {GetScreenWidth() + 50.0f, 0.0f};
-        opm->destRec.x = opm->position.x;
-        opm->destRec.y = 0.0f; 
-    }
+//#####################
+//Text
+//#####################
+// A line of text that is formatted and measured again only when it changes.
+class TextLine {
+public:
+    explicit TextLine(int fontSize) : fontSize(fontSize) {}
 
-    for (auto* gibran : gibrans) {
-        gibran->active = false;
-        gibran->position = {GetScreenWidth() + 50.0f, 0.0f};
-        gibran->destRec.x = gibran->position.x;
-        gibran->destRec.y = 0.0f; 
+    void Set(const char* line) {
+        if (text == line) return;
+        text = line;
+        width = MeasureText(text.c_str(), fontSize);
+        layouts++;
     }
 
-    for (auto* ma : mas) {
-        ma->active = false;
-        ma->position = {GetScreenWidth() + 50.0f, 0.0f};
-        ma->destRec.x = ma->position.x;
-        ma->destRec.y = 0.0f; 
+    // Skips the formatting as well while the value stays the same.
+    void SetNumber(const char* format, int value) {
+        if (format == lastFormat && value == lastValue) return;
+        char line[64];
+        snprintf(line, sizeof(line), format, value);
+        lastFormat = format;
+        lastValue = value;
+        Set(line);
     }
-    
-}
-
 
-void ResetGame(Ship& ship, vector<Bullet*>& bullets, vector<Asteroid*>& asteroids, 
-               vector<Star*>& stars, vector<Polri*>& polris, vector<OPM*>& opms,
-               vector<Gibran*>& gibrans, vector<MA*>& mas) {
-    ship.Reset();
-
-    for (Bullet* bullet : bullets) {
-        delete bullet;
+    void Draw(int x, int y, Color color) const {
+        DrawText(text.c_str(), x, y, fontSize, color);
     }
-    bullets.clear();
 
-    for (Asteroid* asteroid : asteroids) {
-        delete asteroid;
+    void DrawCentered(int centerX, int y, Color color) const {
+        Draw(centerX - width / 2, y, color);
     }
-    asteroids.clear();
-
-    ResetObstacles(stars, polris, opms, gibrans, mas);
-}
-
-int main() {
-    int screenWidth = 1280;
-    int screenHeight = 720;
-
-    InitWindow(screenWidth, screenHeight, "GARUDA PANCASILA");
-
-    gameScreen currentScreen = GAMEPLAY;
-
-    Ship ship("src/ship.png", screenWidth, screenHeight);
-    Bullet bulletPrototype(0, 0);
-    BulletSpawn spawnBullets(&bulletPrototype);
-
-    vector<Bullet*> bullets;
 
-    Asteroid asteroidPrototype(0, 0, 0);
-    AsteroidSpawn spawnAsteroids(&asteroidPrototype);
+    long Layouts() const { return layouts; }
 
-    vector<Asteroid*> asteroids;
-
-    Star starPrototype("src/star.png", 0, 0.1f); 
-    StarSpawn spawnStars(&starPrototype);
-    
-    vector<Star*> stars;
-
-    Polri PolriPrototype("src/polri.png", 0, 0.1f);
-    PolriSpawn spawnPolris(&PolriPrototype);
-
-    vector<Polri*> polris;
-
-    OPM OPMPrototype("src/opm.png", 0, 0.1f);
-    OPMSpawn spawnOPMS(&OPMPrototype);
-
-    vector<OPM*> opms;
+private:
+    string text;
+    int fontSize;
+    int width = 0;
+    long layouts = 0;
+    const char* lastFormat = nullptr;
+    int lastValue = 0;
+};
 
-    Gibran GibranPrototype("src/gibran.png", 0, 0.1f);
-    GibranSpawn spawnGibrans(&GibranPrototype);
+//#####################
+//World
+//#####################
+// Every texture the game loads, in request order. The packer uses the same list.
+enum GameAsset {ASSET_SHIP = 0, ASSET_STAR, ASSET_POLRI, ASSET_OPM, ASSET_GIBRAN, ASSET_MA, ASSET_MILL, ASSET_COUNT};
 
-    vector<Gibran*> gibrans;
+static const char* const ASSET_PATHS[ASSET_COUNT] = {
+    "src/ship.png", "src/star.png", "src/polri.png", "src/opm.png", "src/gibran.png", "src/MA.png", "src/mill.png"
+};
 
-    MA MAPrototype("src/MA.png", 0, 0.1f);
-    MASpawn spawnMAs(&MAPrototype);
+static const char* const DEFAULT_ASSET_PACK = "assets.pack";
+static const char* const DEFAULT_LEADERBOARD = "leaderboard.log";
+static const char* const DEFAULT_TUNING = "tuning.txt";
+
+static const Color KIND_COLORS[KIND_COUNT] = {GOLD, SKYBLUE, RED, GREEN, PURPLE};
+
+// A boss drifts through every 45 seconds; each plate shot off scores a point.
+static const float BOSS_INTERVAL = 45.0f;
+static const int BOSS_PARTS = 400;
+static const float BOSS_PLATE = 14.0f;
+// Far layers first. The game scrolls the background at BACKGROUND_SPEED.
+static const float BACKGROUND_SPEED = 200.0f;
+static const vector<ParallaxLayerParams> BACKGROUND_LAYERS = {
+    {0.08f, 256.0f, 192, 5.0f, 12.0f, 0.02f, 0.98f, {90, 90, 130, 90}},
+    {0.2f, 320.0f, 64, 12.0f, 30.0f, 0.15f, 1.0f, {120, 120, 160, 120}},
+    {0.45f, 384.0f, 14, 36.0f, 84.0f, 0.6f, 1.0f, {160, 160, 180, 150}},
+};
 
-    vector<MA*> mas;
+// Middle of each kind's random spawn scale.
+static const float KIND_WAVE_SCALE[KIND_COUNT] = {0.35f, 0.07f, 0.35f, 0.25f, 0.07f};
+static_assert(KIND_COUNT == TUNING_KINDS, "tuning.h lists the obstacle kinds in the same order");
 
-    FlyCommand flyCommand(&ship, true);
-    FlyCommand fallCommand(&ship, false);
-    ShootCommand shootCommand(&ship, &spawnBullets, bullets);
-    //SpawnAsteroidCommand spawnAsteroidCommand(&spawnAsteroids, asteroids);
-    SpawnStarCommand spawnStarCommand(&spawnStars, stars);
-    SpawnPolriCommand spawnPolriCommand(&spawnPolris, polris);
-    SpawnOPMCommand spawnOPMCommand(&spawnOPMS, opms);
-    SpawnGibranCommand spawnGibranCommand(&spawnGibrans, gibrans);
-    SpawnMACommand spawnMACommand(&spawnMAs, mas);
+class World;
+WaveTask WaveDirector(World& world);
 
-    InputHandler inputHandler(&flyCommand, &fallCommand, &shootCommand);
+class World {
+public:
+    // Owns every spawned entity through the pools below; declared first so
+    // that it outlives them.
+    EntityRegistry entities;
+
+    LoadGovernor governor;
+
+    Ship ship;
+    Bullet bulletPrototype;
+    BulletSpawn spawnBullets;
+    EntityPool<Bullet> bullets{entities};
+
+    Asteroid asteroidPrototype;
+    AsteroidSpawn spawnAsteroids;
+    EntityPool<Asteroid> asteroids{entities};
+
+    Star starPrototype;
+    StarSpawn spawnStars;
+    EntityPool<Star> stars{entities};
+
+    Polri polriPrototype;
+    PolriSpawn spawnPolris;
+    EntityPool<Polri> polris{entities};
+
+    OPM opmPrototype;
+    OPMSpawn spawnOPMS;
+    EntityPool<OPM> opms{entities};
+
+    Gibran gibranPrototype;
+    GibranSpawn spawnGibrans;
+    EntityPool<Gibran> gibrans{entities};
+
+    MA maPrototype;
+    MASpawn spawnMAs;
+    EntityPool<MA> mas{entities};
+
+    BoxBatch bulletBoxes;
+
+    EntityPool<Missile> missiles{entities};
+    EntityPool<LaserBeam> lasers{entities};
+
+    Boss boss;
+    float bossTimer = 0.0f;
+
+    // Every live obstacle, rebuilt each update for the homing and laser queries.
+    SpatialIndex obstacleIndex;
+    vector<SpatialHit> laserHits;
+    vector<int> missileHits;
+
+    // Hit and death debris. Purely cosmetic: the governor scales emission down.
+    ParticleSystem particles;
+    vector<ParticleQuad> particleQuads;
+    RandomStream effectRng;
+    ThreadPool effectsPool;
+
+    // Scenery behind the play field, drawn with the mill sprite.
+    ParallaxBackground background;
+    vector<BackgroundQuad> backgroundQuads;
+    Texture2D millTexture = {0};
+    bool millReady = false;
+
+    // Mixed here; main feeds it to the audio device.
+    AudioMixer audio;
+
+    // Everything gameplay reports this tick, consumed by ProcessEvents.
+    EventQueue events;
+    EventTelemetry eventStats;
+
+    // Scripted formations on top of the random spawns, see WaveDirector. Off
+    // while the level streams: a wall would close the way through that the
+    // chunk worker checked.
+    WaveScheduler waves;
+    RandomStream waveRng;
+
+    // Procedural level streamed from a worker, see chunks.h. When on it
+    // replaces the per-kind spawn timers and the waves; headless runs keep
+    // both.
+    bool levelChunks = false;
+    ChunkStreamer chunks{STREAM_CHUNKS};
+
+    FlyCommand flyCommand;
+    FlyCommand fallCommand;
+    ShootCommand shootCommand;
+    MissileCommand missileCommand;
+    LaserCommand laserCommand;
+    // Gameplay numbers from the tuning file, see ApplyTuning. Declared
+    // before the spawn commands, which keep a reference into it.
+    TuningParams tuning;
+
+    //SpawnAsteroidCommand spawnAsteroidCommand;
+    SpawnStarCommand spawnStarCommand;
+    SpawnPolriCommand spawnPolriCommand;
+    SpawnOPMCommand spawnOPMCommand;
+    SpawnGibranCommand spawnGibranCommand;
+    SpawnMACommand spawnMACommand;
 
     /* float asteroidSpawnTimer = 0.0f;
     float asteroidSpawnInterval = 0.5f; */
 
     float starSpawnTimer = 0.0f;
-    float starSpawnInterval = 1.0f;
 
     float polriSpawnTimer = 0.0f;
-    float polriSpawnInterval = 2.0f;
 
     float opmSpawnTimer = 0.0f;
-    float opmSpawnInterval = 3.0f;
 
     float gibranSpawnTimer = 0.0f;
-    float gibranSpawnInterval = 4.0f;
-    
+
     float maSpawnTimer = 0.0f;
-    float maSpawnInterval = 5.0f;
-    
-    int score = 0;
 
-    SetTargetFPS(60);
+    // Set once a timer's due spawn has been held back, see SpawnDue.
+    bool spawnDeferred[KIND_COUNT] = {};
 
-    while (!WindowShouldClose()) {
-        switch (currentScreen) {
-            case GAMEPLAY: {
-                inputHandler.handleInput();
+    // Multiplies every spawn rate. Normal play is 1, stress runs ramp it up.
+    float spawnRateMultiplier = 1.0f;
+    float chunkSpawnCredit = 0.0f;  // see UpdateChunks
+    // Stress runs keep playing through ship hits.
+    bool godMode = false;
 
-               /*  for (Obstacle* obstacle : obstacles) {
-                    if (obstacle->active) {
-                        cout << "Obstacle position: " << obstacle->position.x << ", " << obstacle->position.y << endl;
-                        DrawCircle(obstacle->position.x, obstacle->position.y, 5, RED);
-                    }
-                } */
+    int score = 0;
+    double runSeconds = 0.0;  // of the game being played
+    gameScreen currentScreen = GAMEPLAY;
+    uint64_t seed;
+
+    TextLine scoreText{20};
+    TextLine gameOverText{50};
+    TextLine finalScoreText{25};
+    TextLine retryText{20};
+    TextLine rankText{20};  // set by RecordRun
+
+    // Asset request ids, -1 until RequestAssets.
+    int shipAsset = -1;
+    int starAsset = -1;
+    int polriAsset = -1;
+    int opmAsset = -1;
+    int gibranAsset = -1;
+    int maAsset = -1;
+    int millAsset = -1;
+
+    World(int screenWidth, int screenHeight, uint64_t seed = 0)
+        : ship(screenWidth, screenHeight),
+          bulletPrototype(0, 0),
+          spawnBullets(&bulletPrototype),
+          asteroidPrototype(0, 0, 0),
+          spawnAsteroids(&asteroidPrototype),
+          starPrototype(0),
+          spawnStars(&starPrototype),
+          polriPrototype(0),
+          spawnPolris(&polriPrototype),
+          opmPrototype(0),
+          spawnOPMS(&opmPrototype),
+          gibranPrototype(0),
+          spawnGibrans(&gibranPrototype),
+          maPrototype(0),
+          spawnMAs(&maPrototype),
+          flyCommand(ship, true),
+          fallCommand(ship, false),
+          shootCommand(ship, spawnBullets, bullets, &governor, &events),
+          missileCommand(ship, bullets, missiles, &governor),
+          laserCommand(ship, bullets, missiles, lasers, &governor),
+          spawnStarCommand(spawnStars, stars, tuning.kinds[KIND_STAR], seed),
+          spawnPolriCommand(spawnPolris, polris, tuning.kinds[KIND_POLRI], seed),
+          spawnOPMCommand(spawnOPMS, opms, tuning.kinds[KIND_OPM], seed),
+          spawnGibranCommand(spawnGibrans, gibrans, tuning.kinds[KIND_GIBRAN], seed),
+          spawnMACommand(spawnMAs, mas, tuning.kinds[KIND_MA], seed),
+          seed(seed) {
+        effectRng.Seed(seed, STREAM_EFFECTS);
+        waveRng.Seed(seed, STREAM_WAVES);
+        waves.Start(WaveDirector(*this));
+        background.Configure(BACKGROUND_LAYERS, seed);
+        ApplyTuning();
+    }
 
+    // The ship goes first so gameplay can start while the obstacles decode.
+    void RequestAssets(AssetLoader& loader) {
+        shipAsset = loader.Request(ASSET_PATHS[ASSET_SHIP]);
+        starAsset = loader.Request(ASSET_PATHS[ASSET_STAR]);
+        polriAsset = loader.Request(ASSET_PATHS[ASSET_POLRI]);
+        opmAsset = loader.Request(ASSET_PATHS[ASSET_OPM]);
+        gibranAsset = loader.Request(ASSET_PATHS[ASSET_GIBRAN]);
+        maAsset = loader.Request(ASSET_PATHS[ASSET_MA]);
+        millAsset = loader.Request(ASSET_PATHS[ASSET_MILL]);
+    }
 
-              /*   asteroidSpawnTimer += GetFrameTime();
-                if (asteroidSpawnTimer >= asteroidSpawnInterval) {
-                    spawnAsteroidCommand.execute();
-                    asteroidSpawnTimer = 0.0f;
-                }
+    // Main thread only: uploads a decoded image and enables whatever uses it.
+    void AcceptAsset(const DecodedAsset& asset) {
+        if (asset.image.data == nullptr) {
+            cerr << "Failed to load " << asset.path << "!" << endl;
+            exit(-1);
+        }
 
-                for (Asteroid* asteroid : asteroids) {
-                    asteroid->Update();
-                } */
+        auto start = chrono::steady_clock::now();
+        Texture2D texture = UploadTexture(asset.image);
+        if (!asset.mapped) UnloadImage(asset.image);
+        double uploadMs = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+
+        if (asset.id == shipAsset) ship.AttachTexture(texture);
+        else if (asset.id == starAsset) starPrototype.AttachTexture(texture);
+        else if (asset.id == polriAsset) polriPrototype.AttachTexture(texture);
+        else if (asset.id == opmAsset) opmPrototype.AttachTexture(texture);
+        else if (asset.id == gibranAsset) gibranPrototype.AttachTexture(texture);
+        else if (asset.id == maAsset) maPrototype.AttachTexture(texture);
+        else if (asset.id == millAsset) {
+            millTexture = texture;
+            millReady = true;
+        }
 
-                starSpawnTimer += GetFrameTime();
-                if(starSpawnTimer >= starSpawnInterval){
-                    spawnStarCommand.execute();
-                    starSpawnTimer = 0.0f;
-                }
+        if (asset.mapped) {
+            TraceLog(LOG_INFO, "ASSETS: %s mapped from pack, uploaded in %.2f ms", asset.path.c_str(), uploadMs);
+        } else {
+            TraceLog(LOG_INFO, "ASSETS: %s decoded in %.2f ms on worker %d, uploaded in %.2f ms",
+                     asset.path.c_str(), asset.decodeMs, asset.worker, uploadMs);
+        }
+    }
 
-                for(Star* star : stars){
-                    star->Update(score);
-                }
-                
-                polriSpawnTimer += GetFrameTime();
-                if(polriSpawnTimer >= polriSpawnInterval){
-                    spawnPolriCommand.execute();
-                    polriSpawnTimer = 0.0f;
-                }
+    // Blocking load for headless runs.
+    void LoadAssets(const AssetPack* pack = nullptr) {
+        AssetLoader loader;
+        loader.UsePack(pack);
+        RequestAssets(loader);
+        DecodedAsset asset;
+        while (loader.Wait(asset)) {
+            AcceptAsset(asset);
+        }
+    }
 
-                for(Polri* polri : polris){
-                    polri->Update(score);
-                }
+    bool ObstaclesReady() const {
+        return starPrototype.Ready() && polriPrototype.Ready() && opmPrototype.Ready() &&
+               gibranPrototype.Ready() && maPrototype.Ready();
+    }
 
-                opmSpawnTimer += GetFrameTime();
-                if(opmSpawnTimer >= opmSpawnInterval){
-                    spawnOPMCommand.execute();
-                    opmSpawnTimer = 0.0f;
-                }
+    // Kind ranges match the spawn commands; sizes need the loaded textures.
+    // Intervals count against the built-in ones: halving a kind's interval
+    // makes it turn up twice as often in the level, the others unchanged.
+    ChunkParams LevelParams() const {
+        const TuningParams builtIn;
+        ChunkParams params;
+        params.fieldWidth = (float)FieldWidth();
+        params.fieldHeight = (float)FieldHeight();
+        params.shipX = ship.destRec.x;
+        params.shipWidth = ship.destRec.width;
+        params.shipHeight = ship.destRec.height;
+        const Texture2D* textures[KIND_COUNT] = {&starPrototype.texture, &polriPrototype.texture, &opmPrototype.texture,
+                                                 &gibranPrototype.texture, &maPrototype.texture};
+        float weightSum = 0.0f;
+        float rateSum = 0.0f;
+        for (int k = 0; k < KIND_COUNT; k++) {
+            const KindTuning& t = tuning.kinds[k];
+            float weight = t.weight * (builtIn.kinds[k].interval / t.interval);
+            weightSum += t.weight;
+            rateSum += weight;
+            params.kinds.push_back({weight, t.vxMin / t.vxDivisor, t.vxMax / t.vxDivisor, t.scaleMin / t.scaleDivisor,
+                                    t.scaleMax / t.scaleDivisor, (float)textures[k]->width, (float)textures[k]->height});
+        }
+        if (weightSum > 0.0f) {
+            // Capped so a tiny interval cannot make a chunk too big to balance.
+            float scale = min(rateSum / weightSum, 8.0f);
+            params.density *= scale;
+            params.densityGrowth *= scale;
+            params.densityMax *= scale;
+        }
+        return params;
+    }
 
-                for(OPM* opm : opms){
-                    opm->Update(score);
-                }
+    // Passes tuning on to the ship and the bullet prototype, at start and
+    // after the watcher copied a new block into it. Timer spawns and scores
+    // read tuning directly and change at once; the level generator copied its
+    // numbers when it started, so they reach the level from the next game.
+    void ApplyTuning() {
+        ship.acceleration = tuning.shipAcceleration;
+        ship.deceleration = tuning.shipDeceleration;
+        bulletPrototype.velocity.x = tuning.bulletSpeed;
+    }
 
-                gibranSpawnTimer += GetFrameTime();
-                if(gibranSpawnTimer >= gibranSpawnInterval){
-                    spawnGibranCommand.execute();
-                    gibranSpawnTimer = 0.0f;
-                }
+    // Starts streaming once every obstacle texture is in, then spawns
+    // whatever the current chunk has due.
+    void UpdateChunks() {
+        if (!chunks.Running()) {
+            if (!ObstaclesReady()) return;
+            chunks.Start(LevelParams(), seed);
+        }
+        chunks.Advance(FrameTime(), [this](const ChunkSpawn& spawn) {
+            // The governor's interval stretch thins the level instead: each
+            // spawn earns 1 / scale of a spawn. Dropping obstacles never closes
+            // the way through that the worker checked.
+            chunkSpawnCredit += 1.0f / governor.SpawnIntervalScale();
+            if (chunkSpawnCredit < 1.0f) {
+                governor.NoteSpawnDeferred();
+                return;
+            }
+            chunkSpawnCredit -= 1.0f;
+            SpawnAt((ObstacleKind)spawn.kind, spawn.y, spawn.vx, spawn.scale);
+        });
+    }
 
-                for(Gibran* gibran : gibrans){
-                    gibran->Update(score);
-                }
+    int LiveObstacles() const {
+        return (int)(stars.size() + polris.size() + opms.size() + gibrans.size() + mas.size());
+    }
 
-                maSpawnTimer += GetFrameTime();
-                if(maSpawnTimer >= maSpawnInterval){
-                    spawnMACommand.execute();
-                    maSpawnTimer = 0.0f;
-                }
+    // Pops one due spawn off a timer. The governor stretches the interval and
+    // caps live obstacles when the frame budget is under pressure. A stretched
+    // spawn counts as deferred once, on the frame it would have been due.
+    bool SpawnDue(float& timer, float interval, bool& deferred) {
+        float base = interval / spawnRateMultiplier;
+        float scaled = base * governor.SpawnIntervalScale();
+        if (timer < scaled) {
+            if (timer >= base && !deferred) {
+                deferred = true;
+                governor.NoteSpawnDeferred();
+            }
+            return false;
+        }
+        timer -= scaled;
+        deferred = false;
+        return governor.AllowObstacle(LiveObstacles());
+    }
 
-                for(MA* ma : mas){
-                    ma->Update(score);
-                }
+    // Same clone path as the spawn commands, for scripted waves. Obeys the
+    // governor's obstacle cap; returns false if nothing was spawned.
+    bool SpawnAt(ObstacleKind kind, float y, float vx, float scale) {
+        if (!governor.AllowObstacle(LiveObstacles())) return false;
+        switch (kind) {
+            case KIND_STAR:
+                if (!starPrototype.Ready()) return false;
+                stars.Add(spawnStars.clone(y, vx, scale));
+                break;
+            case KIND_POLRI:
+                if (!polriPrototype.Ready()) return false;
+                polris.Add(spawnPolris.clone(y, vx, scale));
+                break;
+            case KIND_OPM:
+                if (!opmPrototype.Ready()) return false;
+                opms.Add(spawnOPMS.clone(y, vx, scale));
+                break;
+            case KIND_GIBRAN:
+                if (!gibranPrototype.Ready()) return false;
+                gibrans.Add(spawnGibrans.clone(y, vx, scale));
+                break;
+            case KIND_MA:
+                if (!maPrototype.Ready()) return false;
+                mas.Add(spawnMAs.clone(y, vx, scale));
+                break;
+            default:
+                return false;
+        }
+        return true;
+    }
 
-                for (Bullet* bullet : bullets) {
-                    bullet->Update();
-                }
+    // Consumes the first live bullet overlapping rec, in the same order the
+    // old per-bullet loop walked them. bulletBoxes mirrors bullets by index.
+    bool TakeBulletHit(const Rectangle& rec) {
+        int hit = bulletBoxes.FirstOverlap(rec.x, rec.y, rec.width, rec.height);
+        if (hit < 0) return false;
+        bullets[hit].active = false;
+        bulletBoxes.Remove(hit);
+        return true;
+    }
 
+    // Pans by horizontal position on the field.
+    void Cue(SoundId id, float x, float gain = 1.0f) {
+        audio.Play(id, gain, x / FieldWidth() * 2.0f - 1.0f);
+    }
 
-                /* for (Asteroid* asteroid : asteroids) {
-                    if (!asteroid->active) continue;
-                    for (Bullet* bullet : bullets) {
-                        if (!bullet->active) continue;
-                        if (CheckCollisionCircles(asteroid->position, asteroid->radius, bullet->position, bullet->radius)) {
-                            asteroid->active = false;
-                            bullet->active = false;
-                            score += 1;
-                        }
-                    }
-                }
+    void Explode(const Rectangle& rec, Color tint, int count) {
+        int n = (int)(count * governor.CosmeticScale());
+        if (n <= 0) return;
+        ParticleBurst burst = {rec.x + rec.width / 2, rec.y + rec.height / 2, n, 60.0f, 260.0f, 0.4f, 1.1f, 2.0f, 5.0f, tint};
+        particles.Emit(burst, effectRng);
+    }
 
-                for (Asteroid* asteroid : asteroids) {
-                    if (!asteroid->active) continue;
-                    if (CheckCollisionCircleRec(asteroid->position, asteroid->radius, ship.destRec)) {
-                        asteroid->active = false;
-                        currentScreen = GAMEOVER;
-                    }
-                } */
+    void ExplodeShip() {
+        int n = (int)(400 * governor.CosmeticScale());
+        if (n <= 0) return;
+        const Rectangle& rec = ship.destRec;
+        ParticleBurst burst = {rec.x + rec.width / 2, rec.y + rec.height / 2, n, 80.0f, 420.0f, 0.8f, 2.0f, 2.0f, 6.0f, ORANGE};
+        particles.Emit(burst, effectRng);
+    }
 
-                for (Star* star : stars) {
-                    if (!star->active) continue;
+    // Runs on the game over screen too, so the ship's debris settles.
+    void UpdateEffects() {
+        particles.Update(FrameTime(), &effectsPool);
+    }
 
-                    for (Bullet* bullet : bullets) {
-                        if (!bullet->active) continue;
-                        Rectangle bulletRec = {bullet->position.x - bullet->radius, bullet->position.y - bullet->radius, bullet->radius * 2, bullet->radius * 2};
+    template <typename T>
+    void IndexObstacles(EntityPool<T>& items, ObstacleKind kind) {
+        for (int i = 0; i < (int)items.size(); i++) {
+            if (!items[i].active) continue;
+            const Rectangle& rec = items[i].destRec;
+            obstacleIndex.Add(rec.x, rec.y, rec.width, rec.height, kind, i);
+        }
+    }
 
-                        if (CheckCollisionRecs(star->destRec, bulletRec)) {
-                            star->active = false;
-                            bullet->active = false;
-                            score += 1;
-                            break;
-                        }
-                    }
-                }
+    void RebuildObstacleIndex() {
+        obstacleIndex.Clear();
+        IndexObstacles(stars, KIND_STAR);
+        IndexObstacles(polris, KIND_POLRI);
+        IndexObstacles(opms, KIND_OPM);
+        IndexObstacles(gibrans, KIND_GIBRAN);
+        IndexObstacles(mas, KIND_MA);
+        obstacleIndex.Build((float)FieldHeight());
+    }
 
-                for(Star* star : stars){
-                    if(!star->active) continue;
-                    if(CheckCollisionRecs(star->destRec, ship.destRec)){
-                        star->active = false;
-                        currentScreen = GAMEOVER;
-                    }
-                }
+    template <typename T>
+    bool Destroy(T& item, ObstacleKind kind, GameEventSource source) {
+        if (!item.active) return false;
+        item.active = false;
+        const Rectangle& rec = item.destRec;
+        events.Buffer(PHASE_WEAPONS).Push(EVENT_KILL, source, kind, rec.x, rec.y, rec.width, rec.height);
+        return true;
+    }
+
+    // False if something else already destroyed it this update.
+    bool DestroyObstacle(const SpatialItem& item, GameEventSource source) {
+        switch (item.kind) {
+            case KIND_STAR: return Destroy(stars[item.index], KIND_STAR, source);
+            case KIND_POLRI: return Destroy(polris[item.index], KIND_POLRI, source);
+            case KIND_OPM: return Destroy(opms[item.index], KIND_OPM, source);
+            case KIND_GIBRAN: return Destroy(gibrans[item.index], KIND_GIBRAN, source);
+            case KIND_MA: return Destroy(mas[item.index], KIND_MA, source);
+            default: return false;
+        }
+    }
 
-                for(Polri* polri : polris){
-                    if(!polri->active) continue;
+    EntityHandle ObstacleHandle(const SpatialItem& item) const {
+        switch (item.kind) {
+            case KIND_STAR: return stars.HandleAt(item.index);
+            case KIND_POLRI: return polris.HandleAt(item.index);
+            case KIND_OPM: return opms.HandleAt(item.index);
+            case KIND_GIBRAN: return gibrans.HandleAt(item.index);
+            case KIND_MA: return mas.HandleAt(item.index);
+            default: return {};
+        }
+    }
 
-                    for(Bullet* bullet : bullets){
-                        if(!bullet->active) continue;
-                        Rectangle bulletRec = {bullet->position.x - bullet->radius, bullet->position.y - bullet->radius, bullet->radius * 2, bullet->radius * 2};
+    template <typename T>
+    static bool ActiveBounds(const EntityPool<T>& items, EntityHandle handle, Rectangle& rec) {
+        const T* item = items.Get(handle);
+        if (!item || !item->active) return false;
+        rec = item->destRec;
+        return true;
+    }
 
-                        if(CheckCollisionRecs(polri->destRec, bulletRec)){
-                            polri->active = false;
-                            bullet->active = false;
-                            score += 2;
-                            break;
-                        }
-                    }
+    // False once the obstacle is destroyed or gone past, whatever kind it is.
+    bool ObstacleBounds(EntityHandle handle, Rectangle& rec) const {
+        return ActiveBounds(stars, handle, rec) || ActiveBounds(polris, handle, rec) || ActiveBounds(opms, handle, rec) ||
+               ActiveBounds(gibrans, handle, rec) || ActiveBounds(mas, handle, rec);
+    }
+
+    void UpdateWeapons() {
+        for (Missile& missile : missiles) {
+            Rectangle target;
+            bool locked = ObstacleBounds(missile.target, target);
+            if (!locked) {
+                int nearest = obstacleIndex.Nearest(missile.position.x, missile.position.y);
+                if (nearest >= 0) {
+                    missile.target = ObstacleHandle(obstacleIndex.Item(nearest));
+                    locked = ObstacleBounds(missile.target, target);
+                }
+            }
+            Vector2 aim = {0.0f, 0.0f};
+            if (locked) aim = {target.x + target.width / 2, target.y + target.height / 2};
+            missile.Update(locked, aim);
+            if (!missile.active) continue;
+
+            Rectangle bounds = missile.Bounds();
+            obstacleIndex.Overlapping(bounds.x, bounds.y, bounds.width, bounds.height, missileHits);
+            for (int hit : missileHits) {
+                if (DestroyObstacle(obstacleIndex.Item(hit), SOURCE_MISSILE)) {
+                    missile.active = false;
+                    break;
                 }
+            }
+        }
 
-                for(Polri* polri : polris){
-                    if(!polri->active) continue;
-                    if(CheckCollisionRecs(polri->destRec, ship.destRec)){
-                        polri->active = false;
-                        currentScreen = GAMEOVER;
+        for (LaserBeam& laser : lasers) {
+            if (!laser.resolved) {
+                float reach = FieldWidth() - laser.origin.x;
+                laser.length = reach;
+                obstacleIndex.RayCastRight(laser.origin.x, laser.origin.y - laser.thickness / 2,
+                                           laser.origin.y + laser.thickness / 2, laserHits);
+                int destroyed = 0;
+                for (const SpatialHit& hit : laserHits) {
+                    if (hit.distance >= reach) break;
+                    if (destroyed == laser.pierce) {
+                        laser.length = hit.distance;
+                        break;
                     }
+                    if (DestroyObstacle(obstacleIndex.Item(hit.item), SOURCE_LASER)) destroyed++;
                 }
+                laser.resolved = true;
+                events.Buffer(PHASE_WEAPONS).Push(EVENT_SHOT, SOURCE_LASER, -1, laser.origin.x, laser.origin.y,
+                                                  laser.length, laser.thickness);
+            }
+            laser.Update();
+        }
+
+        SweepInactive(missiles);
+        SweepInactive(lasers);
+    }
 
-                for(OPM* opm : opms){
-                    if(!opm->active) continue;
+    // Bullets first, then the ship, so a bullet saves the ship from anything
+    // it hits on the same tick.
+    template <typename T>
+    void CollideObstacles(EntityPool<T>& items, ObstacleKind kind) {
+        EventBuffer& out = events.Buffer(PHASE_COLLISION);
+        for (T& item : items) {
+            if (!item.active) continue;
+            const Rectangle& rec = item.destRec;
+            if (TakeBulletHit(rec)) {
+                item.active = false;
+                out.Push(EVENT_KILL, SOURCE_BULLET, kind, rec.x, rec.y, rec.width, rec.height);
+            }
+        }
+        for (T& item : items) {
+            if (!item.active) continue;
+            const Rectangle& rec = item.destRec;
+            if (CheckCollisionRecs(rec, ship.destRec)) {
+                item.active = false;
+                out.Push(EVENT_SHIP_HIT, SOURCE_SHIP, kind, rec.x, rec.y, rec.width, rec.height);
+            }
+        }
+    }
 
-                    for(Bullet* bullet : bullets){
-                        if(!bullet->active) continue;
-                        Rectangle bulletRec = {bullet->position.x - bullet->radius, bullet->position.y - bullet->radius, bullet->radius * 2, bullet->radius * 2};
+    void SpawnBoss() {
+        boss.Build(BossDisc(BOSS_PARTS, BOSS_PLATE));
+        boss.x = FieldWidth() + boss.Radius();
+        boss.y = FieldHeight() / 2.0f;
+        boss.angle = 0.0f;
+        boss.vx = -45.0f;
+        boss.spin = 0.6f;
+        boss.active = true;
+        boss.Refit();
+    }
 
-                        if(CheckCollisionRecs(opm->destRec, bulletRec)){
-                            opm->active = false;
-                            bullet->active = false;
-                            score += 3;
-                            break;
-                        }
-                    }
-                }
+    void UpdateBoss() {
+        if (!boss.active) {
+            bossTimer += FrameTime();
+            if (bossTimer >= BOSS_INTERVAL) {
+                bossTimer = 0.0f;
+                SpawnBoss();
+            }
+            return;
+        }
+        boss.x += boss.vx * FrameTime();
+        boss.angle += boss.spin * FrameTime();
+        boss.Refit();
+        if (boss.x + boss.Radius() < 0 || boss.Alive() == 0) boss.active = false;
+    }
+
+    // Bullets the obstacles left over, then the ship, against the plates.
+    void CollideBoss() {
+        if (!boss.active) return;
+        EventBuffer& out = events.Buffer(PHASE_COLLISION);
+        float minX, minY, maxX, maxY;
+        for (Bullet& bullet : bullets) {
+            if (!bullet.active) continue;
+            int part = boss.FirstCircleHit(bullet.position.x, bullet.position.y, bullet.radius);
+            if (part < 0) continue;
+            bullet.active = false;
+            boss.Destroy(part);
+            boss.PartBox(part, minX, minY, maxX, maxY);
+            out.Push(EVENT_PART, SOURCE_BULLET, -1, minX, minY, maxX - minX, maxY - minY);
+        }
+        const Rectangle& rec = ship.destRec;
+        int part = boss.FirstBoxHit(rec.x, rec.y, rec.width, rec.height);
+        if (part >= 0) {
+            boss.Destroy(part);
+            boss.PartBox(part, minX, minY, maxX, maxY);
+            out.Push(EVENT_SHIP_HIT, SOURCE_SHIP, -1, minX, minY, maxX - minX, maxY - minY);
+        }
+    }
 
-                for(OPM* opm : opms){
-                    if(!opm->active) continue;
-                    if(CheckCollisionRecs(opm->destRec, ship.destRec)){
-                        opm->active = false;
+    // The only place the tick's outcome is applied: score, screen, effects,
+    // audio and telemetry all read the same drained stream.
+    void ProcessEvents() {
+        size_t drained = events.Drain([this](const GameEvent& e) {
+            eventStats.Count(e);
+            Rectangle rec = {e.x, e.y, e.w, e.h};
+            switch (e.type) {
+                case EVENT_KILL:
+                    score += tuning.kinds[e.kind].points;
+                    Explode(rec, KIND_COLORS[e.kind], 32);
+                    Cue(SOUND_HIT, e.x);
+                    break;
+                case EVENT_MISS:
+                    score -= tuning.kinds[e.kind].points;
+                    Cue(SOUND_MISS, 0.0f, 0.8f);
+                    break;
+                case EVENT_SHIP_HIT:
+                    Explode(rec, e.kind >= 0 ? KIND_COLORS[e.kind] : ORANGE, 32);
+                    Cue(SOUND_HIT, e.x);
+                    if (!godMode && currentScreen != GAMEOVER) {
                         currentScreen = GAMEOVER;
+                        ExplodeShip();
+                        Cue(SOUND_GAMEOVER, ship.destRec.x);
                     }
-                }
+                    break;
+                case EVENT_SHOT:
+                    Cue(SOUND_SHOT, e.x, e.source == SOURCE_LASER ? 1.0f : 0.6f);
+                    break;
+                case EVENT_PART:
+                    score += tuning.bossPartPoints;
+                    Explode(rec, ORANGE, 6);
+                    Cue(SOUND_HIT, e.x, 0.4f);
+                    break;
+                default:
+                    break;
+            }
+        });
+        eventStats.EndTick(drained);
+    }
 
-                for(Gibran* gibran : gibrans){
-                    if(!gibran->active) continue;
+    void Reseed(uint64_t newSeed) {
+        seed = newSeed;
+        spawnStarCommand.reseed(seed);
+        spawnPolriCommand.reseed(seed);
+        spawnOPMCommand.reseed(seed);
+        spawnGibranCommand.reseed(seed);
+        spawnMACommand.reseed(seed);
+        effectRng.Seed(seed, STREAM_EFFECTS);
+        waveRng.Seed(seed, STREAM_WAVES);
+        chunks.Stop();
+    }
 
-                    for(Bullet* bullet : bullets){
-                        if(!bullet->active) continue;
-                        Rectangle bulletRec = {bullet->position.x - bullet->radius, bullet->position.y - bullet->radius, bullet->radius * 2, bullet->radius * 2};
+    void Reset() {
+        ship.Reset();
+        bullets.Clear();
+        asteroids.Clear();
+        stars.Clear();
+        polris.Clear();
+        opms.Clear();
+        gibrans.Clear();
+        mas.Clear();
+        missiles.Clear();
+        lasers.Clear();
+        particles.Clear();
+        audio.StopAll();
+        waves.Clear();
+        waves.Start(WaveDirector(*this));
+        chunks.Stop();
+        events.Clear();
+        boss.active = false;
+        bossTimer = 0.0f;
+        score = 0;
+        runSeconds = 0.0;
+        rankText.Set("");
+        currentScreen = GAMEPLAY;
+    }
 
-                        if(CheckCollisionRecs(gibran->destRec, bulletRec)){
-                            gibran->active = false;
-                            bullet->active = false;
-                            score += 4;
-                            break;
-                        }
-                    }
-                }
+    void Update() {
+        runSeconds += FrameTime();
+        background.Scroll(BACKGROUND_SPEED * FrameTime());
 
-                for(Gibran* gibran : gibrans){
-                    if(!gibran->active) continue;
-                    if(CheckCollisionRecs(gibran->destRec, ship.destRec)){
-                        gibran->active = false;
-                        currentScreen = GAMEOVER;
-                    }
-                }
+       /*  for (Obstacle* obstacle : obstacles) {
+            if (obstacle->active) {
+                cout << "Obstacle position: " << obstacle->position.x << ", " << obstacle->position.y << endl;
+                DrawCircle(obstacle->position.x, obstacle->position.y, 5, RED);
+            }
+        } */
 
-                for(MA* ma : mas){
-                    if(!ma->active) continue;
 
-                    for(Bullet* bullet : bullets){
-                        if(!bullet->active) continue;
-                        Rectangle bulletRec = {bullet->position.x - bullet->radius, bullet->position.y - bullet->radius, bullet->radius * 2, bullet->radius * 2};
+      /*   asteroidSpawnTimer += FrameTime();
+        if (asteroidSpawnTimer >= asteroidSpawnInterval) {
+            spawnAsteroidCommand.execute();
+            asteroidSpawnTimer = 0.0f;
+        }
 
-                        if(CheckCollisionRecs(ma->destRec, bulletRec)){
-                            ma->active = false;
-                            bullet->active = false;
-                            score += 5;
-                            break;
-                        }
-                    }
-                }
+        for (Asteroid* asteroid : asteroids) {
+            asteroid->Update();
+        } */
 
-                for(MA* ma : mas){
-                    if(!ma->active) continue;
-                    if(CheckCollisionRecs(ma->destRec, ship.destRec)){
-                        ma->active = false;
-                        currentScreen = GAMEOVER;
-                    }
-                }
+        if (levelChunks) UpdateChunks();
+        else waves.Advance(FrameTime());
 
-            } break;
-            case GAMEOVER: {
-                if (IsKeyPressed(KEY_R)) {
-                    ResetGame(ship, bullets, asteroids, stars, polris, opms, gibrans, mas);
-                    score = 0;
-                    currentScreen = GAMEPLAY;
+        if(!levelChunks && starPrototype.Ready()){
+            starSpawnTimer += FrameTime();
+            while(SpawnDue(starSpawnTimer, tuning.kinds[KIND_STAR].interval, spawnDeferred[KIND_STAR])){
+                spawnStarCommand.execute();
+            }
+        }
+
+        for(Star& star : stars){
+            star.Update(events.Buffer(PHASE_MOTION, KIND_STAR));
+        }
+
+        if(!levelChunks && polriPrototype.Ready()){
+            polriSpawnTimer += FrameTime();
+            while(SpawnDue(polriSpawnTimer, tuning.kinds[KIND_POLRI].interval, spawnDeferred[KIND_POLRI])){
+                spawnPolriCommand.execute();
+            }
+        }
+
+        for(Polri& polri : polris){
+            polri.Update(events.Buffer(PHASE_MOTION, KIND_POLRI));
+        }
+
+        if(!levelChunks && opmPrototype.Ready()){
+            opmSpawnTimer += FrameTime();
+            while(SpawnDue(opmSpawnTimer, tuning.kinds[KIND_OPM].interval, spawnDeferred[KIND_OPM])){
+                spawnOPMCommand.execute();
+            }
+        }
+
+        for(OPM& opm : opms){
+            opm.Update(events.Buffer(PHASE_MOTION, KIND_OPM));
+        }
+
+        if(!levelChunks && gibranPrototype.Ready()){
+            gibranSpawnTimer += FrameTime();
+            while(SpawnDue(gibranSpawnTimer, tuning.kinds[KIND_GIBRAN].interval, spawnDeferred[KIND_GIBRAN])){
+                spawnGibranCommand.execute();
+            }
+        }
+
+        for(Gibran& gibran : gibrans){
+            gibran.Update(events.Buffer(PHASE_MOTION, KIND_GIBRAN));
+        }
+
+        if(!levelChunks && maPrototype.Ready()){
+            maSpawnTimer += FrameTime();
+            while(SpawnDue(maSpawnTimer, tuning.kinds[KIND_MA].interval, spawnDeferred[KIND_MA])){
+                spawnMACommand.execute();
+            }
+        }
+
+        for(MA& ma : mas){
+            ma.Update(events.Buffer(PHASE_MOTION, KIND_MA));
+        }
+
+        UpdateBoss();
+        RebuildObstacleIndex();
+        UpdateWeapons();
+
+        for (Bullet& bullet : bullets) {
+            bullet.Update();
+        }
+
+        bulletBoxes.Clear();
+        for (const Bullet& bullet : bullets) {
+            bulletBoxes.Push(bullet.position.x - bullet.radius, bullet.position.y - bullet.radius,
+                             bullet.radius * 2, bullet.radius * 2, bullet.active);
+        }
+
+        /* for (Asteroid* asteroid : asteroids) {
+            if (!asteroid->active) continue;
+            for (Bullet* bullet : bullets) {
+                if (!bullet->active) continue;
+                if (CheckCollisionCircles(asteroid->position, asteroid->radius, bullet->position, bullet->radius)) {
+                    asteroid->active = false;
+                    bullet->active = false;
+                    score += 1;
                 }
-            } break;
-            default:
-                break;
+            }
         }
 
-        BeginDrawing();
-        ClearBackground(BLACK);
+        for (Asteroid* asteroid : asteroids) {
+            if (!asteroid->active) continue;
+            if (CheckCollisionCircleRec(asteroid->position, asteroid->radius, ship.destRec)) {
+                asteroid->active = false;
+                currentScreen = GAMEOVER;
+            }
+        } */
+
+        CollideObstacles(stars, KIND_STAR);
+        CollideObstacles(polris, KIND_POLRI);
+        CollideObstacles(opms, KIND_OPM);
+        CollideObstacles(gibrans, KIND_GIBRAN);
+        CollideObstacles(mas, KIND_MA);
+        CollideBoss();
+
+        ProcessEvents();
+        UpdateEffects();
+
+        SweepInactive(bullets);
+        SweepInactive(stars);
+        SweepInactive(polris);
+        SweepInactive(opms);
+        SweepInactive(gibrans);
+        SweepInactive(mas);
+    }
+
+    // Inner plates red, outer ones maroon.
+    void DrawBoss() {
+        if (!boss.active) return;
+        float rotation = boss.angle * RAD2DEG;
+        float c = cosf(boss.angle), s = sinf(boss.angle);
+        float inner = boss.Radius() * boss.Radius() / 4;
+        for (int p = 0; p < boss.PartCount(); p++) {
+            const BossPart& part = boss.Part(p);
+            if (!part.alive) continue;
+            float wx = boss.x + part.lx * c - part.ly * s;
+            float wy = boss.y + part.lx * s + part.ly * c;
+            Color color = part.lx * part.lx + part.ly * part.ly < inner ? RED : MAROON;
+            DrawRectanglePro({wx, wy, part.half * 2, part.half * 2}, {part.half, part.half}, rotation, color);
+        }
+    }
+
+    // At DRAW_MINIMAL the obstacles become flat rectangles, which all batch
+    // into one draw call instead of switching texture per kind.
+    template <typename T>
+    void DrawObstacles(EntityPool<T>& items, Color flatColor) {
+        if (governor.Quality() == DRAW_MINIMAL) {
+            for (const T& item : items) {
+                if (item.active) DrawRectangleRec(item.destRec, flatColor);
+            }
+            return;
+        }
+        for (T& item : items) {
+            item.Draw();
+        }
+    }
+
+    void DrawEffects() {
+        particles.BuildDrawList(particleQuads, FieldWidth(), FieldHeight());
+        for (const ParticleQuad& quad : particleQuads) {
+            DrawRectangleRec({quad.x, quad.y, quad.size, quad.size}, quad.color);
+        }
+    }
+
+    // Drawn behind everything, also while the game is over. Far layers go
+    // first when the governor sheds cosmetic work.
+    void DrawBackground() {
+        if (!millReady) return;
+        background.BuildDrawList(backgroundQuads, FieldWidth(), FieldHeight(), governor.CosmeticScale());
+        const Rectangle source = {0.0f, 0.0f, (float)millTexture.width, (float)millTexture.height};
+        for (const BackgroundQuad& quad : backgroundQuads) {
+            DrawTexturePro(millTexture, source, {quad.x, quad.y, quad.size, quad.size}, {0.0f, 0.0f}, 0.0f, quad.color);
+        }
+    }
+
+    long TextLayouts() const {
+        return scoreText.Layouts() + gameOverText.Layouts() + finalScoreText.Layouts() + retryText.Layouts() +
+               rankText.Layouts();
+    }
+
+    void Draw() {
+        int screenWidth = FieldWidth();
+        int screenHeight = FieldHeight();
 
         switch (currentScreen) {
             case GAMEPLAY: {
-                DrawText(TextFormat("SCORE: %d", score), 10, 10, 20, WHITE);
-              
+                DrawBackground();
+                scoreText.SetNumber("SCORE: %d", score);
+                scoreText.Draw(10, 10, WHITE);
+
                 ship.Draw();
 
-                for (Bullet* bullet : bullets) {
-                    bullet->Draw();
+                for (Bullet& bullet : bullets) {
+                    if (governor.Quality() == DRAW_FULL) {
+                        bullet.Draw();
+                    } else {
+                        bullet.DrawFlat();
+                    }
                 }
 
-                /* for (Asteroid* asteroid : asteroids) {
-                    asteroid->Draw();
-                } */
-                 
-                for(Star* star : stars){
-                    star->Draw();
+                for (Missile& missile : missiles) {
+                    missile.Draw();
                 }
 
-                for(Polri* polri : polris){
-                    polri->Draw();
+                for (LaserBeam& laser : lasers) {
+                    laser.Draw();
                 }
 
-                for(OPM* opm : opms){
-                    opm->Draw();
-                }
+                /* for (Asteroid* asteroid : asteroids) {
+                    asteroid->Draw();
+                } */
 
-                for(Gibran* gibran : gibrans){
-                    gibran->Draw();
-                }
+                DrawObstacles(stars, GOLD);
+                DrawObstacles(polris, SKYBLUE);
+                DrawObstacles(opms, RED);
+                DrawObstacles(gibrans, GREEN);
+                DrawObstacles(mas, PURPLE);
+                DrawBoss();
 
-                for(MA* ma : mas){
-                    ma->Draw();
-                }
+                DrawEffects();
 
                //DrawTexture(obstaclePrototype.texture, screenWidth - obstaclePrototype.texture.width - 10, 10, WHITE);
 
             } break;
             case GAMEOVER: {
-                DrawText("GAME OVER", screenWidth / 2 - MeasureText("GAME OVER", 50) / 2, screenHeight / 2 - 20, 50, PINK);
-                DrawText(TextFormat("SCORE: %d", score), screenWidth / 2 - MeasureText(TextFormat("SCORE: %d", score), 25) / 2, screenHeight / 2 + 30, 25, PINK);
-                DrawText("PRESS 'R' TO RETRY || PRESS 'ESC' TO QUIT", screenWidth / 2 - MeasureText("PRESS 'R' TO RETRY || PRESS 'ESC' TO QUIT", 20) / 2, screenHeight / 2 + 75, 20, PINK);
+                DrawBackground();
+                DrawEffects();
+                gameOverText.Set("GAME OVER");
+                gameOverText.DrawCentered(screenWidth / 2, screenHeight / 2 - 20, PINK);
+                finalScoreText.SetNumber("SCORE: %d", score);
+                finalScoreText.DrawCentered(screenWidth / 2, screenHeight / 2 + 30, PINK);
+                retryText.Set("PRESS 'R' TO RETRY || PRESS 'ESC' TO QUIT");
+                retryText.DrawCentered(screenWidth / 2, screenHeight / 2 + 75, PINK);
+                rankText.DrawCentered(screenWidth / 2, screenHeight / 2 + 105, PINK);
             }
         }
+    }
+};
 
-        EndDrawing();
+//#####################
+//Waves
+//#####################
+static const float WAVE_SPEED = -160.0f;
+
+// One kind in a row at the same height, entering one after another.
+WaveTask LineWave(World& world, ObstacleKind kind, float y, int count, double gap) {
+    for (int i = 0; i < count; i++) {
+        world.SpawnAt(kind, y, WAVE_SPEED, KIND_WAVE_SCALE[kind]);
+        co_await world.waves.Delay(gap);
     }
+}
 
-    for (Bullet* bullet : bullets) {
-        delete bullet;
+// Leader first, then pairs trailing above and below it.
+WaveTask VeeWave(World& world, ObstacleKind kind, float y, int arms) {
+    world.SpawnAt(kind, y, WAVE_SPEED, KIND_WAVE_SCALE[kind]);
+    for (int i = 1; i <= arms; i++) {
+        co_await world.waves.Delay(0.15);
+        world.SpawnAt(kind, y - 45.0f * i, WAVE_SPEED, KIND_WAVE_SCALE[kind]);
+        world.SpawnAt(kind, y + 45.0f * i, WAVE_SPEED, KIND_WAVE_SCALE[kind]);
+    }
+}
+
+WaveTask SnakeWave(World& world, ObstacleKind kind, float y, float amplitude, int count) {
+    for (int i = 0; i < count; i++) {
+        world.SpawnAt(kind, y + amplitude * sinf(i * 0.6f), WAVE_SPEED, KIND_WAVE_SCALE[kind]);
+        co_await world.waves.Ticks(6);
+    }
+}
+
+// A column across the whole field with one gap to fly through.
+WaveTask WallWave(World& world, ObstacleKind kind, float gapY, float gapSize) {
+    for (float y = 0.0f; y < FieldHeight(); y += 60.0f) {
+        if (y + 60.0f > gapY && y < gapY + gapSize) continue;
+        world.SpawnAt(kind, y, WAVE_SPEED * 0.75f, KIND_WAVE_SCALE[kind]);
+    }
+    co_return;
+}
+
+// Starts a random formation every 6 to 12 seconds.
+WaveTask WaveDirector(World& world) {
+    co_await world.waves.Delay(6.0);
+    for (;;) {
+        RandomStream& rng = world.waveRng;
+        ObstacleKind kind = (ObstacleKind)rng.Range(0, KIND_COUNT - 1);
+        float y = (float)rng.Range(80, FieldHeight() - 80);
+        switch (rng.Range(0, 3)) {
+            case 0: world.waves.Start(LineWave(world, kind, y, rng.Range(5, 10), 0.25)); break;
+            case 1: world.waves.Start(VeeWave(world, kind, y, rng.Range(2, 4))); break;
+            case 2: world.waves.Start(SnakeWave(world, kind, y, 120.0f, rng.Range(10, 16))); break;
+            default: world.waves.Start(WallWave(world, kind, y - 60.0f, 150.0f)); break;
+        }
+        co_await world.waves.Delay(rng.Range(60, 120) / 10.0);
+    }
+}
+
+//#####################
+//Spectating
+//#####################
+// Turns each tick of a world into one spectator frame. Obstacles and bullets
+// get stream ids by entity handle, which no later entity reuses.
+static const int SPECTATOR_PORT = 7777;
+
+class SpectatorFeed {
+public:
+    SpectatorEncoder encoder;
+
+    long frames = 0;
+    long moves = 0;            // corrections sent because the model drifted
+    double encodeMsSum = 0.0;
+    double encodeMsMax = 0.0;
+    long bytesSum = 0;
+    size_t bytesMax = 0;
+    long snapshotBytesSum = 0; // what sending every position would have cost
+
+    // dt is how far the world moved since the last call, 0 if it did not.
+    void Publish(World& world, SpectatorServer& server, float dt) {
+        if (!server.Running()) return;
+        auto start = chrono::steady_clock::now();
+        SpectatorFrame* frame = server.Frame();
+        encoder.Begin(*frame, SPECTATE_DELTA, tick++, dt);
+        encoder.model.Advance(dt);
+        stamp++;
+
+        TrackObstacles(world.stars, KIND_STAR);
+        TrackObstacles(world.polris, KIND_POLRI);
+        TrackObstacles(world.opms, KIND_OPM);
+        TrackObstacles(world.gibrans, KIND_GIBRAN);
+        TrackObstacles(world.mas, KIND_MA);
+        for (size_t i = 0; i < world.bullets.size(); i++) {
+            const Bullet& bullet = world.bullets[i];
+            if (!bullet.active) continue;
+            float d = bullet.radius * 2;
+            Track(world.bullets.HandleAt(i), SPECTATE_BULLET, bullet.position.x, bullet.position.y, d, d, bullet.velocity.x);
+        }
+        for (auto it = ids.begin(); it != ids.end();) {
+            if (it->second.stamp == stamp) {
+                ++it;
+                continue;
+            }
+            encoder.Remove(it->second.id);
+            it = ids.erase(it);
+        }
+
+        const Rectangle& ship = world.ship.destRec;
+        const SpectatorModel& known = encoder.model;
+        if (ship.x != known.shipX || ship.y != known.shipY || ship.width != known.shipW || ship.height != known.shipH) {
+            encoder.Ship(ship.x, ship.y, ship.width, ship.height);
+        }
+        if (world.score != known.score) encoder.Score(world.score);
+        if (world.currentScreen != known.screen) encoder.Screen((uint8_t)world.currentScreen);
+        encoder.End();
+
+        double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+        frames++;
+        encodeMsSum += ms;
+        encodeMsMax = max(encodeMsMax, ms);
+        bytesSum += frame->bytes.size();
+        bytesMax = max(bytesMax, frame->bytes.size());
+        snapshotBytesSum += 13 + 16 + ids.size() * 24;
+        server.Publish(frame);
+
+        if (server.WantsKeyframe()) {
+            SpectatorFrame* key = server.Frame();
+            encoder.Keyframe(*key);
+            server.Publish(key);
+        }
+    }
+
+private:
+    struct Tracked {
+        uint32_t id;
+        unsigned stamp;
+    };
+    unordered_map<uint32_t, Tracked> ids;  // by handle bits
+    uint32_t nextId = 1;
+    uint32_t tick = 0;
+    unsigned stamp = 0;
+
+    template <typename T>
+    void TrackObstacles(const EntityPool<T>& items, ObstacleKind kind) {
+        for (size_t i = 0; i < items.size(); i++) {
+            const T& item = items[i];
+            if (!item.active) continue;
+            const Rectangle& rec = item.destRec;
+            Track(items.HandleAt(i), (uint8_t)kind, rec.x, rec.y, rec.width, rec.height, item.velocity.x);
+        }
+    }
+
+    void Track(EntityHandle handle, uint8_t kind, float x, float y, float w, float h, float vx) {
+        auto it = ids.find(handle.bits);
+        if (it != ids.end()) {
+            const SpectatorEntity& known = encoder.model.entities[it->second.id];
+            it->second.stamp = stamp;
+            if (known.x != x || known.y != y) {
+                encoder.Move(it->second.id, x, y);
+                moves++;
+            }
+            return;
+        }
+        uint32_t id = nextId++;
+        encoder.Spawn(id, {kind, x, y, w, h, vx});
+        ids[handle.bits] = {id, stamp};
+    }
+};
+
+//#####################
+//Autopilot input
+//#####################
+// Stands in for InputHandler: hands the world's obstacles to the planner in
+// autopilot.h and runs the same commands a player's input would.
+class AutopilotInput {
+public:
+    Autopilot pilot;
+    bool enabled = false;
+    long lives = 0;             // games that ended in a crash
+    double lifeSeconds = 0.0;   // of the game being played
+    double lifeSecondsSum = 0.0;
+    double lifeSecondsMax = 0.0;
+
+    AutopilotInput(World& world, uint64_t seed) : pilot(seed, STREAM_PILOT), world(world) {}
+
+    void handleInput() {
+        obstacles.clear();
+        Collect(world.stars);
+        Collect(world.polris);
+        Collect(world.opms);
+        Collect(world.gibrans);
+        Collect(world.mas);
+        // The whole boss as one box: it turns, but a disc's box hardly changes.
+        if (world.boss.active && world.boss.Alive() > 0) {
+            const BossNode& b = world.boss.Bounds();
+            obstacles.push_back({b.minX, b.minY, b.maxX - b.minX, b.maxY - b.minY, world.boss.vx});
+        }
+        const Ship& ship = world.ship;
+        PilotShip state = {ship.destRec.x, ship.destRec.y, ship.destRec.width, ship.destRec.height,
+                           ship.velocity, ship.acceleration, ship.deceleration};
+        pilot.params.fieldWidth = (float)FieldWidth();
+        pilot.params.fieldHeight = (float)FieldHeight();
+        pilot.params.bulletSpeed = world.bulletPrototype.velocity.x;
+        pilot.params.bulletRadius = world.bulletPrototype.radius;
+
+        PilotDecision decision = pilot.Plan(state, obstacles, FrameTime());
+        if (decision.fly) {
+            world.flyCommand.execute();
+        } else {
+            world.fallCommand.execute();
+        }
+        if (decision.shoot) world.shootCommand.execute();
+        lifeSeconds += FrameTime();
+    }
+
+    // Once per game over while it was flying.
+    void EndLife() {
+        lives++;
+        lifeSecondsSum += lifeSeconds;
+        lifeSecondsMax = max(lifeSecondsMax, lifeSeconds);
+        lifeSeconds = 0.0;
+        pilot.Reset();
+    }
+
+private:
+    World& world;
+    vector<PilotObstacle> obstacles;
+
+    template <typename T>
+    void Collect(const EntityPool<T>& items) {
+        for (const T& item : items) {
+            if (!item.active) continue;
+            const Rectangle& rec = item.destRec;
+            obstacles.push_back({rec.x, rec.y, rec.width, rec.height, item.velocity.x});
+        }
+    }
+};
+
+void DrawGovernorOverlay(const LoadGovernor& governor) {
+    const GovernorMetrics& m = governor.Metrics();
+    DrawText(TextFormat("GOV L%d  p90 %.2f ms  budget %.1f ms", governor.Level(), m.windowP90Ms, governor.budgetMs), 10, 40, 10, LIGHTGRAY);
+    DrawText(TextFormat("over %ld  up %ld  down %ld", m.framesOverBudget, m.escalations, m.relaxations), 10, 52, 10, LIGHTGRAY);
+    DrawText(TextFormat("deferred %ld  spawn rej %ld  bullet rej %ld", m.spawnsDeferred, m.spawnsRejected, m.bulletsRejected), 10, 64, 10, LIGHTGRAY);
+}
+
+void DrawChunkOverlay(const ChunkStreamer& chunks) {
+    ChunkMetrics m = chunks.Metrics();
+    DrawText(TextFormat("CHUNKS %ld played  lead min %.0f mean %.0f ms  late %ld", m.consumed, m.leadMinMs, m.LeadMeanMs(), m.late), 10, 120, 10, LIGHTGRAY);
+    DrawText(TextFormat("gen max %.2f ms  attempts %ld  moved %ld  removed %ld", m.generateMaxMs, m.attempts, m.moved, m.removed), 10, 132, 10, LIGHTGRAY);
+}
+
+void DrawEventOverlay(const EventTelemetry& stats) {
+    DrawText(TextFormat("EVENTS %ld/tick (max %ld)  kills %ld bullet %ld missile %ld laser  misses %ld  shots %ld  boss plates %ld",
+                        stats.lastTick, stats.maxTick, stats.killsBySource[SOURCE_BULLET], stats.killsBySource[SOURCE_MISSILE],
+                        stats.killsBySource[SOURCE_LASER], stats.counts[EVENT_MISS], stats.counts[EVENT_SHOT],
+                        stats.counts[EVENT_PART]), 10, 164, 10, LIGHTGRAY);
+}
+void DrawAutopilotOverlay(const AutopilotInput& autopilot) {
+    const PilotMetrics& m = autopilot.pilot.Metrics();
+    DrawText(TextFormat("AUTOPILOT plan %.0f us (mean %.0f, max %.0f, budget %.0f)  %d candidates", m.lastPlanUs,
+                        m.PlanUsMean(), m.planUsMax, autopilot.pilot.params.budgetUs, m.lastCandidates), 10, 180, 10, LIGHTGRAY);
+    DrawText(TextFormat("life %.1f s  %ld crashes, mean life %.1f s, best %.1f s", autopilot.lifeSeconds, autopilot.lives,
+                        autopilot.lives ? autopilot.lifeSecondsSum / autopilot.lives : 0.0, autopilot.lifeSecondsMax), 10, 192, 10, LIGHTGRAY);
+}
+void DrawSpectatorOverlay(const SpectatorServer& server, const SpectatorFeed& feed) {
+    SpectatorServerMetrics m = server.Metrics();
+    long frames = max(1L, feed.frames);
+    DrawText(TextFormat("SPECTATE port %d  %d viewers  %.0f B/tick  encode %.1f us", server.Port(), m.clients,
+                        (double)feed.bytesSum / frames, feed.encodeMsSum * 1000.0 / frames), 10, 148, 10, LIGHTGRAY);
+}
+
+// raylib links GLFW in on the desktop but does not declare its wait call.
+#if defined(PLATFORM_DESKTOP)
+extern "C" void glfwWaitEventsTimeout(double timeout);
+#endif
+
+// Blocks until an input event arrives or ms pass. GLFW feeds the events into
+// raylib's input state without rolling it over like PollInputEvents() does,
+// so a press that ends the wait still reads as pressed this frame.
+void WaitInputEvents(double ms) {
+#if defined(PLATFORM_DESKTOP)
+    glfwWaitEventsTimeout(ms / 1000.0);
+#else
+    WaitTime(ms / 1000.0);
+    PollInputEvents();
+#endif
+}
+
+// GetKeyPressed() would take the key off raylib's queue, so this reads the
+// key state instead and leaves the press for IsKeyPressed() to see.
+bool AnyKeyPressed() {
+    for (int key = KEY_SPACE; key <= KEY_KB_MENU; key++) {
+        if (IsKeyPressed(key)) return true;
+    }
+    return false;
+}
+
+void DrawIdleOverlay(const IdleGate& idle, long textLayouts) {
+    DrawText(TextFormat("IDLE %ld frames skipped  %.1f s asleep  %ld polls  %ld wakes  %ld text layouts",
+                        idle.Skipped(), idle.IdleMs() / 1000.0, idle.Polls(), idle.Wakes(), textLayouts),
+             10, 208, 10, LIGHTGRAY);
+}
+
+void DrawTuningOverlay(const TuningWatcher& tuning) {
+    TuningMetrics m = tuning.Metrics();
+    DrawText(TextFormat("TUNING %ld loads  %ld rejected  parse %.2f ms  picked up %.1f ms after the change (max %.1f)",
+                        m.loads, m.rejected, m.parseMs, m.adoptMs, m.adoptMaxMs), 10, 240, 10, LIGHTGRAY);
+}
+
+void DrawPacingOverlay(const FramePacer& pacer) {
+    DrawText(TextFormat("PACE %s  spin margin %.2f ms", PaceModeName(pacer.mode), pacer.SpinMarginMs()), 10, 80, 10, LIGHTGRAY);
+    DrawText(TextFormat("interval %.2f sd %.3f  p99 %.2f ms", pacer.interval.Mean(), pacer.interval.StdDev(), pacer.interval.Percentile(0.99f)), 10, 92, 10, LIGHTGRAY);
+    DrawText(TextFormat("work p99 %.2f  wait p50 %.2f  error p99 %.2f ms", pacer.work.Percentile(0.99f), pacer.wait.Percentile(0.5f), pacer.error.Percentile(0.99f)), 10, 104, 10, LIGHTGRAY);
+}
+
+//#####################
+//Leaderboard
+//#####################
+// Called once per game over. The game thread only queues the run, and the
+// rank line is laid out here rather than every frame.
+void RecordRun(LeaderboardStore& board, World& world) {
+    if (!board.IsOpen()) return;
+    int64_t now = (int64_t)time(nullptr);
+    board.Submit(world.score, (uint32_t)(world.runSeconds * 1000.0), world.seed, now);
+    const LeaderboardIndex& index = board.Index();
+    RunRecord best = {};
+    index.DayBest(RunDay(now), best);
+    char line[128];
+    snprintf(line, sizeof(line), "RANK %ld OF %ld  |  BETTER THAN %.0f%% OF RUNS  |  BEST TODAY %d",
+             index.Above(world.score) + 1, index.Runs(), index.Percentile(world.score), best.score);
+    world.rankText.Set(line);
+}
+
+void DrawLeaderboardOverlay(const LeaderboardStore& board) {
+    LeaderboardMetrics m = board.Metrics();
+    DrawText(TextFormat("BOARD %ld runs  %ld in the log  %ld compactions (max %.1f ms)  %ld failures",
+                        board.Index().Runs(), m.logRecords, m.compactions, m.compactMsMax, m.failures),
+             10, 224, 10, LIGHTGRAY);
+}
+
+//#####################
+//Headless stress test
+//#####################
+struct StressSample {
+    float demand;
+    float workMs;
+    int obstacles;
+    int bullets;
+    int level;
+};
+
+// Ramps spawn and fire rates from 1x to 100x and times each gameplay update.
+// Nothing is drawn, so the budget here is the simulation's share of a frame.
+vector<StressSample> RunStressPass(bool governed, float budgetMs, int ticks) {
+    simClock.headless = true;
+    simClock.frameTime = 1.0f / 60.0f;
+    World world(simClock.width, simClock.height, 1234);
+    world.LoadAssets();
+    world.godMode = true;
+    world.governor.budgetMs = budgetMs;
+    world.governor.enabled = governed;
+
+    const float baseShotInterval = 0.25f;
+    float shotTimer = 0.0f;
+
+    vector<StressSample> samples;
+    samples.reserve(ticks);
+    for (int tick = 0; tick < ticks; tick++) {
+        float demand = 1.0f + 99.0f * tick / (ticks - 1);
+        world.spawnRateMultiplier = demand;
+
+        auto start = chrono::steady_clock::now();
+
+        // The bot sweeps the ship up and down and fires at the ramped rate.
+        if (sinf(tick * 0.02f) > 0.0f) {
+            world.flyCommand.execute();
+        } else {
+            world.fallCommand.execute();
+        }
+        shotTimer += simClock.frameTime;
+        float shotInterval = baseShotInterval / demand;
+        while (shotTimer >= shotInterval) {
+            shotTimer -= shotInterval;
+            world.shootCommand.execute();
+        }
+        world.Update();
+
+        float workMs = chrono::duration<float, milli>(chrono::steady_clock::now() - start).count();
+        world.governor.Observe(workMs);
+        samples.push_back({demand, workMs, world.LiveObstacles(), (int)world.bullets.size(), world.governor.Level()});
+    }
+
+    printf("%s pass:\n", governed ? "governed" : "ungoverned");
+    world.governor.Report(stdout);
+    return samples;
+}
+
+float Percentile(vector<float> values, float p) {
+    if (values.empty()) return 0.0f;
+    size_t k = (size_t)(p * (values.size() - 1));
+    nth_element(values.begin(), values.begin() + k, values.end());
+    return values[k];
+}
+
+void PrintStressTable(const vector<StressSample>& samples, float budgetMs) {
+    const int segments = 10;
+    printf("  demand  obstacles  bullets  level   p50 ms   p99 ms  over%%\n");
+    for (int s = 0; s < segments; s++) {
+        size_t from = samples.size() * s / segments;
+        size_t to = samples.size() * (s + 1) / segments;
+        vector<float> work;
+        int obstacles = 0, bullets = 0, level = 0, over = 0;
+        for (size_t i = from; i < to; i++) {
+            work.push_back(samples[i].workMs);
+            obstacles = max(obstacles, samples[i].obstacles);
+            bullets = max(bullets, samples[i].bullets);
+            level = max(level, samples[i].level);
+            if (samples[i].workMs > budgetMs) over++;
+        }
+        printf("  %5.0fx  %9d  %7d  %5d  %7.3f  %7.3f  %5.1f\n",
+               samples[to - 1].demand, obstacles, bullets, level,
+               Percentile(work, 0.5f), Percentile(work, 0.99f), 100.0f * over / (to - from));
+    }
+}
+
+float OverBudgetRatio(const vector<StressSample>& samples, float budgetMs) {
+    int over = 0;
+    for (const StressSample& sample : samples) {
+        if (sample.workMs > budgetMs) over++;
     }
+    return samples.empty() ? 0.0f : (float)over / samples.size();
+}
 
-    for (Asteroid* asteroid : asteroids) {
-        delete asteroid;
+// ./game --stress [--budget-ms 2] [--seconds 120] [--governed-only]
+int RunGovernorStress(int argc, char** argv) {
+    float budgetMs = 2.0f;
+    int seconds = 120;
+    bool governedOnly = false;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--budget-ms") == 0 && i + 1 < argc) budgetMs = (float)atof(argv[++i]);
+        else if (strcmp(argv[i], "--seconds") == 0 && i + 1 < argc) seconds = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--governed-only") == 0) governedOnly = true;
     }
+    int ticks = max(seconds * 60, 60);
 
-    for(Star* star : stars){
-        delete star;
+    if (!governedOnly) {
+        vector<StressSample> baseline = RunStressPass(false, budgetMs, ticks);
+        PrintStressTable(baseline, budgetMs);
     }
 
-    for(Polri* polri : polris){
-        delete polri;
+    vector<StressSample> governed = RunStressPass(true, budgetMs, ticks);
+    PrintStressTable(governed, budgetMs);
+
+    // The governor needs a window's worth of frames to react, so allow a few
+    // over-budget frames but not a sustained overrun.
+    float ratio = OverBudgetRatio(governed, budgetMs);
+    bool held = ratio <= 0.05f;
+    printf("budget %s: %.2f%% of governed frames over %.2f ms\n", held ? "HELD" : "MISSED", 100.0f * ratio, budgetMs);
+    return held ? 0 : 1;
+}
+
+//#####################
+//Headless pacing benchmark
+//#####################
+// Runs the same synthetic frame workload under every capped pacing mode and
+// compares how much the frame interval varies, not just its average.
+// ./game --pacing-bench [--frames 600] [--fps 60]
+int RunPacingBench(int argc, char** argv) {
+    int frames = 600;
+    int fps = 60;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc) frames = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--fps") == 0 && i + 1 < argc) fps = atoi(argv[++i]);
     }
 
-    for(OPM* opm : opms){
-        delete opm;
+    const PaceMode modes[] = {PACE_SLEEP, PACE_FIXED, PACE_LOW_LATENCY};
+    double sleepVariance = 0.0;
+    double fixedVariance = 0.0;
+
+    for (PaceMode mode : modes) {
+        FramePacer pacer(mode, fps);
+        pacer.Calibrate();
+
+        // Work between 2 and 8 ms from a fixed sequence, so every mode sees the same load.
+        // The first half second is warm-up and is left out of the histograms.
+        const int warmup = fps / 2;
+        unsigned int state = 12345;
+        for (int frame = 0; frame < warmup + frames; frame++) {
+            if (frame == warmup) pacer.ResetStats();
+            pacer.BeginFrame();
+            state = state * 1664525u + 1013904223u;
+            double workMs = 2.0 + 6.0 * (state >> 8) / 16777216.0;
+            auto until = chrono::steady_clock::now() + chrono::duration<double, milli>(workMs);
+            while (chrono::steady_clock::now() < until) {}
+            pacer.EndFrame();
+        }
+
+        pacer.Report(stdout);
+        pacer.interval.Plot(stdout, "interval histogram");
+        printf("\n");
+
+        if (mode == PACE_SLEEP) sleepVariance = pacer.interval.Variance();
+        if (mode == PACE_FIXED) fixedVariance = pacer.interval.Variance();
     }
 
-    for(Gibran* gibran : gibrans){
-        delete gibran;
+    printf("interval variance: sleep %.4f ms^2, fixed %.4f ms^2, sleep/fixed %.2f\n",
+           sleepVariance, fixedVariance, fixedVariance > 0.0 ? sleepVariance / fixedVariance : 0.0);
+    return 0;
+}
+
+//#####################
+//Headless RNG benchmark
+//#####################
+uint64_t HashU32(const uint32_t* values, size_t n, uint64_t hash = 1469598103934665603ull) {
+    for (size_t i = 0; i < n; i++) {
+        hash = (hash ^ values[i]) * 1099511628211ull;
+    }
+    return hash;
+}
+
+// Hashes `perStream` draws from each of `streams` streams, spreading the
+// streams over `threads` workers. The combined hash must not depend on threads.
+uint64_t HashStreams(uint64_t seed, int streams, size_t perStream, int threads) {
+    vector<uint64_t> hashes(streams);
+    vector<thread> workers;
+    for (int t = 0; t < threads; t++) {
+        workers.emplace_back([&, t]() {
+            vector<uint32_t> values(perStream);
+            for (int id = t; id < streams; id += threads) {
+                RandomStream rng(seed, id);
+                rng.FillU32(values.data(), perStream);
+                hashes[id] = HashU32(values.data(), perStream);
+            }
+        });
+    }
+    for (thread& worker : workers) worker.join();
+
+    uint64_t combined = 0;
+    for (uint64_t hash : hashes) combined = combined * 31 + hash;
+    return combined;
+}
+
+// ./game --rng-bench [--count 1000000] [--burst 5000]
+int RunRngBench(int argc, char** argv) {
+    int count = 1000000;
+    int burst = 5000;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--count") == 0 && i + 1 < argc) count = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--burst") == 0 && i + 1 < argc) burst = atoi(argv[++i]);
+    }
+    const SpawnRanges ranges = {0, 720, -2000, -1000, 10.0f, 20, 50, 100.0f};
+    vector<SpawnParams> params(count);
+    float sink = 0.0f;
+
+    auto start = chrono::steady_clock::now();
+    for (int i = 0; i < count; i++) {
+        params[i].y = GetRandomValue(0, 720);
+        params[i].vx = GetRandomValue(-2000, -1000) / 10.0f;
+        params[i].scale = GetRandomValue(20, 50) / 100.0f;
+    }
+    double raylibMs = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+    sink += params[count / 2].vx;
+
+    RandomStream scalar(42, STREAM_STAR);
+    start = chrono::steady_clock::now();
+    for (int i = 0; i < count; i++) {
+        params[i].y = scalar.Range(0, 720);
+        params[i].vx = scalar.Range(-2000, -1000) / 10.0f;
+        params[i].scale = scalar.Range(20, 50) / 100.0f;
+    }
+    double scalarMs = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+    vector<SpawnParams> scalarParams(params);
+
+    RandomStream batch(42, STREAM_STAR);
+    start = chrono::steady_clock::now();
+    FillSpawnBatch(batch, ranges, params.data(), count);
+    double batchMs = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+    sink += params[count / 2].vx;
+
+    printf("spawn parameters (%d spawns, 3 draws each):\n", count);
+    printf("  GetRandomValue  %8.2f ms  %6.2f ns/spawn\n", raylibMs, raylibMs * 1e6 / count);
+    printf("  stream scalar   %8.2f ms  %6.2f ns/spawn\n", scalarMs, scalarMs * 1e6 / count);
+    printf("  stream batch    %8.2f ms  %6.2f ns/spawn\n", batchMs, batchMs * 1e6 / count);
+
+    bool batchMatches = memcmp(scalarParams.data(), params.data(), sizeof(SpawnParams) * count) == 0;
+    printf("batch matches scalar draws: %s\n", batchMatches ? "yes" : "NO");
+
+    bool threadsMatch = true;
+    uint64_t reference = HashStreams(7, 64, 100000, 1);
+    int maxThreads = max(4, (int)thread::hardware_concurrency());
+    for (int threads = 2; threads <= maxThreads; threads *= 2) {
+        uint64_t hash = HashStreams(7, 64, 100000, threads);
+        printf("64 streams on %2d threads: %016llx\n", threads, (unsigned long long)hash);
+        if (hash != reference) threadsMatch = false;
+    }
+    printf("64 streams on  1 thread:  %016llx (%s)\n", (unsigned long long)reference, threadsMatch ? "all match" : "MISMATCH");
+
+    simClock.headless = true;
+    {
+        World world(simClock.width, simClock.height, 42);
+        world.LoadAssets();
+        start = chrono::steady_clock::now();
+        world.spawnStarCommand.executeBurst(burst);
+        double burstMs = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+
+        RandomStream rng(42, STREAM_STAR);
+        vector<SpawnParams> burstParams(burst);
+        start = chrono::steady_clock::now();
+        FillSpawnBatch(rng, ranges, burstParams.data(), burst);
+        double drawMs = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+        printf("burst of %d stars: %.3f ms total, %.3f ms of it drawing random numbers\n", burst, burstMs, drawMs);
+    }
+
+    if (sink == 12345.0f) printf("\n");
+    return batchMatches && threadsMatch ? 0 : 1;
+}
+
+//#####################
+//Headless narrowphase benchmark
+//#####################
+// Plays the obstacle-vs-bullet loop with first hit wins: returns which bullet
+// each obstacle consumed (-1 for none).
+vector<int> LegacyFirstHits(const vector<Rectangle>& obstacles, vector<Bullet*>& bullets) {
+    vector<int> hits(obstacles.size(), -1);
+    for (Bullet* bullet : bullets) bullet->active = true;
+    for (size_t o = 0; o < obstacles.size(); o++) {
+        for (size_t b = 0; b < bullets.size(); b++) {
+            Bullet* bullet = bullets[b];
+            if (!bullet->active) continue;
+            Rectangle bulletRec = {bullet->position.x - bullet->radius, bullet->position.y - bullet->radius, bullet->radius * 2, bullet->radius * 2};
+            if (CheckCollisionRecs(obstacles[o], bulletRec)) {
+                bullet->active = false;
+                hits[o] = (int)b;
+                break;
+            }
+        }
+    }
+    return hits;
+}
+
+vector<int> BatchFirstHits(const vector<Rectangle>& obstacles, const vector<Bullet*>& bullets, NarrowphaseIsa isa) {
+    BoxBatch boxes;
+    boxes.UseIsa(isa);
+    for (Bullet* bullet : bullets) {
+        boxes.Push(bullet->position.x - bullet->radius, bullet->position.y - bullet->radius, bullet->radius * 2, bullet->radius * 2);
+    }
+    vector<int> hits(obstacles.size(), -1);
+    for (size_t o = 0; o < obstacles.size(); o++) {
+        const Rectangle& rec = obstacles[o];
+        int hit = boxes.FirstOverlap(rec.x, rec.y, rec.width, rec.height);
+        if (hit >= 0) {
+            boxes.Remove(hit);
+            hits[o] = hit;
+        }
+    }
+    return hits;
+}
+
+// ./game --narrowphase-bench [--obstacles 2000] [--bullets 800] [--repeat 20]
+int RunNarrowphaseBench(int argc, char** argv) {
+    int obstacleCount = 2000;
+    int bulletCount = 800;
+    int repeat = 20;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--obstacles") == 0 && i + 1 < argc) obstacleCount = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--bullets") == 0 && i + 1 < argc) bulletCount = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--repeat") == 0 && i + 1 < argc) repeat = atoi(argv[++i]);
+    }
+
+    RandomStream rng(99, 0);
+    vector<Rectangle> obstacles(obstacleCount);
+    for (Rectangle& rec : obstacles) {
+        float size = rng.Range(20, 120);
+        rec = {(float)rng.Range(0, 1280), (float)rng.Range(0, 720), size, size};
+    }
+    vector<Bullet*> bullets;
+    for (int i = 0; i < bulletCount; i++) {
+        Bullet* bullet = new Bullet(rng.Range(0, 1280), rng.Range(0, 720));
+        bullet->active = true;
+        bullets.push_back(bullet);
+    }
+    double pairs = (double)obstacleCount * bulletCount * repeat;
+
+    // Every pair, no early out, so the cost per pair is comparable.
+    long legacyHits = 0;
+    auto start = chrono::steady_clock::now();
+    for (int r = 0; r < repeat; r++) {
+        for (const Rectangle& rec : obstacles) {
+            for (Bullet* bullet : bullets) {
+                if (!bullet->active) continue;
+                Rectangle bulletRec = {bullet->position.x - bullet->radius, bullet->position.y - bullet->radius, bullet->radius * 2, bullet->radius * 2};
+                if (CheckCollisionRecs(rec, bulletRec)) legacyHits++;
+            }
+        }
+    }
+    double legacyMs = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+    printf("%d obstacles x %d bullets, %d repeats\n", obstacleCount, bulletCount, repeat);
+    printf("  %-22s %8.2f ms  %6.3f ns/pair  hits %ld\n", "CheckCollisionRecs", legacyMs, legacyMs * 1e6 / pairs, legacyHits);
+
+    vector<int> reference = LegacyFirstHits(obstacles, bullets);
+    bool allMatch = true;
+
+    for (int isa = ISA_SCALAR; isa < ISA_COUNT; isa++) {
+        if (!NarrowphaseIsaSupported((NarrowphaseIsa)isa)) {
+            printf("  %-22s not supported on this CPU\n", NarrowphaseIsaName((NarrowphaseIsa)isa));
+            continue;
+        }
+        BoxBatch boxes;
+        boxes.UseIsa((NarrowphaseIsa)isa);
+        start = chrono::steady_clock::now();
+        for (Bullet* bullet : bullets) {
+            boxes.Push(bullet->position.x - bullet->radius, bullet->position.y - bullet->radius, bullet->radius * 2, bullet->radius * 2);
+        }
+        double packMs = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+
+        long hits = 0;
+        start = chrono::steady_clock::now();
+        for (int r = 0; r < repeat; r++) {
+            for (const Rectangle& rec : obstacles) {
+                for (int base = 0; base < boxes.Count(); base += NARROWPHASE_BLOCK) {
+                    hits += __builtin_popcount(boxes.BlockMask(base, rec.x, rec.y, rec.width, rec.height));
+                }
+            }
+        }
+        double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+
+        bool match = BatchFirstHits(obstacles, bullets, (NarrowphaseIsa)isa) == reference && hits == legacyHits;
+        if (!match) allMatch = false;
+        printf("  %-22s %8.2f ms  %6.3f ns/pair  hits %ld  pack %.3f ms  %.1fx  first hits %s\n",
+               TextFormat("BoxBatch %s", NarrowphaseIsaName((NarrowphaseIsa)isa)), ms, ms * 1e6 / pairs, hits,
+               packMs, legacyMs / ms, match ? "match" : "DIFFER");
+    }
+
+    for (Bullet* bullet : bullets) delete bullet;
+    return allMatch ? 0 : 1;
+}
+
+// Sleeps a pseudo-random 50-500 ms between wake-ups, forever.
+WaveTask IdleScript(WaveScheduler& waves, uint32_t seed, long& wakeups) {
+    uint32_t state = seed | 1u;
+    for (;;) {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        co_await waves.Delay(0.05 + (state % 450) / 1000.0);
+        wakeups++;
+    }
+}
+
+// Lives for a few ticks, then ends; measures start/finish churn.
+WaveTask ShortScript(WaveScheduler& waves, long& finished) {
+    co_await waves.Ticks(3);
+    finished++;
+}
+
+// Thousands of suspended scripts on one scheduler, stepped at 60 Hz.
+int RunWaveBench(int argc, char** argv) {
+    int scripts = 10000;
+    float seconds = 30.0f;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--scripts") == 0 && i + 1 < argc) scripts = atoi(argv[++i]);
+        if (strcmp(argv[i], "--seconds") == 0 && i + 1 < argc) seconds = (float)atof(argv[++i]);
+    }
+    const double dt = 1.0 / 60.0;
+    int ticks = (int)(seconds * 60.0f);
+    const WaveFramePool::Stats& pool = WaveFramePool::Local().GetStats();
+
+    long wakeups = 0;
+    long finished = 0;
+    double advanceMs = 0.0;
+    double worstMs = 0.0;
+    size_t frameBytes = 0;
+    {
+        WaveScheduler waves;
+        for (int i = 0; i < scripts; i++) waves.Start(IdleScript(waves, 0x9E3779B9u * (i + 1), wakeups));
+        frameBytes = pool.liveBytes;
+        for (int t = 0; t < ticks; t++) {
+            // A little churn on top, like formations starting and ending.
+            for (int k = 0; k < 20; k++) waves.Start(ShortScript(waves, finished));
+            auto start = chrono::steady_clock::now();
+            waves.Advance(dt);
+            double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+            advanceMs += ms;
+            worstMs = max(worstMs, ms);
+        }
+        printf("%d suspended scripts, %d ticks, %zu suspended at the end\n", scripts, ticks, waves.Suspended());
+    }
+    printf("  advance      mean %.4f ms/tick  worst %.4f ms  %.0f resumes/ms\n",
+           advanceMs / ticks, worstMs, (wakeups + finished) / advanceMs);
+    printf("  frames       %zu bytes live for %d scripts (%.0f bytes each)\n",
+           frameBytes, scripts, (double)frameBytes / scripts);
+    printf("  pool         %ld allocations, %.1f%% reused, %ld oversized, %ld still live\n",
+           pool.allocations, 100.0 * pool.reused / max(1L, pool.allocations), pool.oversized, pool.live);
+
+    // Idle cost: everything asleep well past the measured ticks.
+    {
+        WaveScheduler waves;
+        long none = 0;
+        for (int i = 0; i < scripts; i++) waves.Start(IdleScript(waves, 1, none));
+        waves.Advance(dt);
+        auto start = chrono::steady_clock::now();
+        for (int t = 0; t < 1000; t++) waves.Advance(0.0);
+        double idleMs = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+        printf("  idle tick    %.3f us with %zu scripts asleep\n", idleMs, waves.Suspended());
+    }
+    return pool.live == 0 ? 0 : 1;
+}
+
+// Lays chunks out on this thread, checks that another thread lays out the
+// same ones, then plays a headless level through the streamer.
+int RunChunkBench(int argc, char** argv) {
+    int count = 200;
+    float seconds = 120.0f;
+    float speed = 8.0f;
+    uint64_t seed = 1234;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--chunks") == 0 && i + 1 < argc) count = atoi(argv[++i]);
+        if (strcmp(argv[i], "--speed") == 0 && i + 1 < argc) speed = (float)atof(argv[++i]);
+        if (strcmp(argv[i], "--seconds") == 0 && i + 1 < argc) seconds = (float)atof(argv[++i]);
+        if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) seed = strtoull(argv[++i], nullptr, 10);
+    }
+    simClock.headless = true;
+    simClock.frameTime = 1.0f / 60.0f;
+    World world(simClock.width, simClock.height, seed);
+    world.LoadAssets();
+    world.godMode = true;
+    const ChunkParams params = world.LevelParams();
+
+    vector<uint64_t> hashes(count);
+    vector<float> generateMs(count);
+    long spawns = 0, attempts = 0, moved = 0, removed = 0;
+    int blocked = 0;
+    for (int i = 0; i < count; i++) {
+        LevelChunk chunk = GenerateChunk(seed, STREAM_CHUNKS, i, params);
+        hashes[i] = chunk.Hash();
+        generateMs[i] = (float)chunk.generateMs;
+        spawns += chunk.spawns.size();
+        attempts += chunk.attempts;
+        moved += chunk.moved;
+        removed += chunk.removed;
+        if (FirstBlockedStep(chunk.spawns, params) >= 0) blocked++;
+    }
+    float totalMs = 0.0f;
+    for (float ms : generateMs) totalMs += ms;
+    printf("%d chunks of %.0f s, seed %llu\n", count, params.duration, (unsigned long long)seed);
+    printf("  generate     mean %.3f ms  p99 %.3f ms  max %.3f ms\n",
+           totalMs / count, Percentile(generateMs, 0.99f), Percentile(generateMs, 1.0f));
+    printf("  layout       %.1f spawns/chunk  %.2f attempts/chunk  %ld moved by balancing  %ld blockers removed  %d unsolvable\n",
+           (double)spawns / count, (double)attempts / count, moved, removed, blocked);
+
+    // Same indices again, backwards and on another thread.
+    int mismatches = 0;
+    thread other([&] {
+        for (int i = count - 1; i >= 0; i--) {
+            if (GenerateChunk(seed, STREAM_CHUNKS, i, params).Hash() != hashes[i]) mismatches++;
+        }
+    });
+    other.join();
+    printf("  determinism  %s (%d of %d chunks differ)\n", mismatches == 0 ? "OK" : "FAILED", mismatches, count);
+
+    // Paced at `speed` times real time, so the worker gets 1/speed of the
+    // wall time per chunk that it gets in play.
+    world.levelChunks = true;
+    int ticks = (int)(seconds * 60.0f);
+    double updateMs = 0.0, worstMs = 0.0;
+    auto began = chrono::steady_clock::now();
+    for (int t = 0; t < ticks; t++) {
+        auto start = chrono::steady_clock::now();
+        world.Update();
+        double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+        updateMs += ms;
+        worstMs = max(worstMs, ms);
+        this_thread::sleep_until(began + chrono::duration<double>((t + 1) / 60.0 / speed));
+    }
+    ChunkMetrics m = world.chunks.Metrics();
+    printf("  streaming    %d ticks at %.0fx real time, level at %.1f s, %ld chunks played, %ld generated\n",
+           ticks, speed, world.chunks.LevelTime(), m.consumed, m.generated);
+    printf("  lead time    min %.2f ms  mean %.2f ms  %ld late chunks  %ld stalled ticks\n",
+           m.leadMinMs, m.LeadMeanMs(), m.late, m.stalledTicks);
+    printf("  update       mean %.4f ms/tick  worst %.4f ms\n", updateMs / ticks, worstMs);
+    return mismatches == 0 && blocked == 0 ? 0 : 1;
+}
+
+// Bobs up and down and fires every quarter second, offset per game.
+uint8_t ScriptedSimInput(int game, uint64_t tick) {
+    uint8_t input = (tick / 30 + game) % 2 == 0 ? SIM_FLY : 0;
+    if ((tick + game) % 15 == 0) input |= SIM_SHOOT;
+    return input;
+}
+
+// Folds the state hash of every tick into one value, so two runs match only
+// if they matched on every tick.
+template <typename Sim>
+uint64_t PlaySimGame(const SimParams& params, uint64_t seed, int game, int ticks, bool trace) {
+    Sim sim(params, seed + game, STREAM_SIM);
+    uint64_t folded = 0;
+    for (int t = 0; t < ticks; t++) {
+        sim.Step(ScriptedSimInput(game, t));
+        if (trace) folded = (folded ^ sim.Hash()) * 0x100000001b3ull;
+    }
+    return trace ? folded : sim.Hash();
+}
+
+// Game 0, seed 1234, 3600 ticks, godMode. Any build of the fixed-point core
+// must reproduce it.
+static const uint64_t SIM_GOLDEN_HASH = 0x18ce4d32230ea6beull;
+
+int RunSimBench(int argc, char** argv) {
+    int games = 64;
+    int ticks = 3600;
+    int threads = (int)thread::hardware_concurrency();
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--games") == 0 && i + 1 < argc) games = atoi(argv[++i]);
+        if (strcmp(argv[i], "--ticks") == 0 && i + 1 < argc) ticks = atoi(argv[++i]);
+        if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) threads = atoi(argv[++i]);
+    }
+    if (threads < 1) threads = 1;
+    SimParams params;
+    params.godMode = true;
+    const uint64_t seed = 1234;
+
+    uint64_t golden = PlaySimGame<FixedSim>(params, seed, 0, 3600, true);
+    bool goldenOk = golden == SIM_GOLDEN_HASH;
+    printf("golden  %016llx (%s)\n", (unsigned long long)golden, goldenOk ? "match" : "MISMATCH");
+
+    // Throughput, one thread, no hashing.
+    auto timeGames = [&](auto play) {
+        auto start = chrono::steady_clock::now();
+        for (int g = 0; g < games; g++) play(g);
+        return chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+    };
+    double fixedMs = timeGames([&](int g) { PlaySimGame<FixedSim>(params, seed, g, ticks, false); });
+    double floatMs = timeGames([&](int g) { PlaySimGame<FloatSim>(params, seed, g, ticks, false); });
+    double hashMs = timeGames([&](int g) { PlaySimGame<FixedSim>(params, seed, g, ticks, true); }) - fixedMs;
+    double total = (double)games * ticks;
+    printf("%d games of %d ticks\n", games, ticks);
+    printf("  float        %8.0f ticks/ms\n", total / floatMs);
+    printf("  fixed        %8.0f ticks/ms  (%.2fx float)\n", total / fixedMs, floatMs / fixedMs);
+    printf("  state hash   %8.3f us/tick\n", max(0.0, hashMs) * 1000.0 / total);
+
+    // Same games split across 1..threads workers must give the same traces.
+    vector<uint64_t> reference(games);
+    for (int g = 0; g < games; g++) reference[g] = PlaySimGame<FixedSim>(params, seed, g, ticks, true);
+    int mismatches = 0;
+    for (int t = 1; t <= threads; t *= 2) {
+        vector<uint64_t> traces(games);
+        ThreadPool pool(t);
+        auto start = chrono::steady_clock::now();
+        pool.ParallelFor(games, t, [&](int begin, int end) {
+            for (int g = begin; g < end; g++) traces[g] = PlaySimGame<FixedSim>(params, seed, g, ticks, true);
+        });
+        double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+        int differ = 0;
+        for (int g = 0; g < games; g++) differ += traces[g] != reference[g];
+        mismatches += differ;
+        printf("  %2d threads   %8.0f ticks/ms  %d of %d traces differ\n", t, total / ms, differ, games);
+    }
+
+    // How far the float rules drift from the fixed-point ones.
+    int diverged = 0;
+    for (int g = 0; g < games; g++) {
+        FixedSim fixedSim(params, seed + g, STREAM_SIM);
+        FloatSim floatSim(params, seed + g, STREAM_SIM);
+        for (int t = 0; t < ticks; t++) {
+            fixedSim.Step(ScriptedSimInput(g, t));
+            floatSim.Step(ScriptedSimInput(g, t));
+        }
+        diverged += fixedSim.state.score != floatSim.state.score;
+    }
+    printf("  float vs fixed final score differs in %d of %d games\n", diverged, games);
+    return goldenOk && mismatches == 0 ? 0 : 1;
+}
+
+// Steers toward the nearest obstacle still ahead of the ship and fires every
+// quarter second. Reads only the game it plays, so games stay independent.
+uint8_t AimingSimInput(const FixedSim& sim, int player = 0) {
+    typedef FixedSim::Num Num;
+    const Num shipX = FixedMath::Int(sim.params.shipX);
+    const Num shipMid = sim.state.ships[player].y + sim.ShipHeight() / 2;
+    const SimObstacle<Num>* target = nullptr;
+    for (const SimObstacle<Num>& o : sim.state.obstacles) {
+        if (o.x + o.w < shipX) continue;
+        if (!target || o.x < target->x) target = &o;
+    }
+    uint8_t input = sim.state.tick % 15 == 0 ? SIM_SHOOT : 0;
+    if (target && target->y + target->h / 2 < shipMid) input |= SIM_FLY;
+    return input;
+}
+
+// Multipliers on the game's spawn rules, in percent so every run of a
+// config builds exactly the same SimParams.
+struct TuneConfig {
+    int intervalPct;  // ticks between spawns
+    int speedPct;     // obstacle speed range
+    int sizePct;      // obstacle scale range
+
+    SimParams Apply(SimParams params) const {
+        for (SimKind& kind : params.kinds) {
+            kind.interval = max(1, kind.interval * intervalPct / 100);
+            kind.vxMin = kind.vxMin * speedPct / 100;
+            kind.vxMax = kind.vxMax * speedPct / 100;
+            kind.scaleMin = max(1, kind.scaleMin * sizePct / 100);
+            kind.scaleMax = max(kind.scaleMin + 1, kind.scaleMax * sizePct / 100);
+        }
+        return params;
+    }
+};
+
+struct TuneGame {
+    int score;
+    int ticks;   // survived, up to the cap
+    bool dead;
+};
+
+TuneGame PlayTuneGame(const SimParams& params, uint64_t seed, int game, int ticks, bool aim) {
+    FixedSim sim(params, seed + game, STREAM_SIM);
+    while ((int)sim.state.tick < ticks && !sim.state.dead) {
+        sim.Step(aim ? AimingSimInput(sim) : ScriptedSimInput(game, sim.state.tick));
+    }
+    return {sim.state.score, (int)sim.state.tick, sim.state.dead};
+}
+
+// "50,100,150" -> {50, 100, 150}.
+vector<int> ParsePercents(const char* text) {
+    vector<int> values;
+    while (*text) {
+        char* end;
+        long v = strtol(text, &end, 10);
+        if (end == text) break;
+        if (v > 0) values.push_back((int)v);
+        text = *end == ',' ? end + 1 : end;
+    }
+    return values;
+}
+
+// ./game --tune [--games 256] [--ticks 3600] [--threads N] [--bot aim|scripted]
+//               [--intervals 50,75,100,150] [--speeds 75,100,125,150] [--sizes 75,100,125]
+//               [--target-seconds 30] [--seed N] [--csv tuning.csv]
+// Plays every combination of the multipliers on the fixed-point core with
+// ship hits ending the game. Game g of every config uses seed + g, so configs
+// are compared on the same obstacle draws.
+int RunTuner(int argc, char** argv) {
+    int games = 256;
+    int ticks = 3600;
+    int threads = (int)thread::hardware_concurrency();
+    bool aim = true;
+    vector<int> intervals = {50, 75, 100, 150};
+    vector<int> speeds = {75, 100, 125, 150};
+    vector<int> sizes = {75, 100, 125};
+    float targetSeconds = 30.0f;
+    uint64_t seed = 1234;
+    const char* csvPath = "tuning.csv";
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--games") == 0 && i + 1 < argc) games = atoi(argv[++i]);
+        if (strcmp(argv[i], "--ticks") == 0 && i + 1 < argc) ticks = atoi(argv[++i]);
+        if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) threads = atoi(argv[++i]);
+        if (strcmp(argv[i], "--bot") == 0 && i + 1 < argc) aim = strcmp(argv[++i], "scripted") != 0;
+        if (strcmp(argv[i], "--intervals") == 0 && i + 1 < argc) intervals = ParsePercents(argv[++i]);
+        if (strcmp(argv[i], "--speeds") == 0 && i + 1 < argc) speeds = ParsePercents(argv[++i]);
+        if (strcmp(argv[i], "--sizes") == 0 && i + 1 < argc) sizes = ParsePercents(argv[++i]);
+        if (strcmp(argv[i], "--target-seconds") == 0 && i + 1 < argc) targetSeconds = (float)atof(argv[++i]);
+        if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) seed = strtoull(argv[++i], nullptr, 10);
+        if (strcmp(argv[i], "--csv") == 0 && i + 1 < argc) csvPath = argv[++i];
+    }
+    if (threads < 1) threads = 1;
+    if (games < 1 || ticks < 1 || intervals.empty() || speeds.empty() || sizes.empty()) {
+        fprintf(stderr, "tune: nothing to play\n");
+        return 1;
+    }
+
+    vector<TuneConfig> configs;
+    for (int interval : intervals) {
+        for (int speed : speeds) {
+            for (int size : sizes) configs.push_back({interval, speed, size});
+        }
+    }
+    vector<SimParams> params;
+    for (const TuneConfig& config : configs) params.push_back(config.Apply(SimParams()));
+
+    // One slot per game and nothing else written, so workers share no
+    // mutable state. Many more pieces than threads keeps them all busy while
+    // the cheap configs finish early.
+    const int total = (int)configs.size() * games;
+    vector<TuneGame> results(total);
+    ThreadPool pool(max(1, threads - 1));
+    auto start = chrono::steady_clock::now();
+    pool.ParallelFor(total, threads == 1 ? 1 : threads * 16, [&](int begin, int end) {
+        for (int i = begin; i < end; i++) {
+            results[i] = PlayTuneGame(params[i / games], seed, i % games, ticks, aim);
+        }
+    });
+    double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+    long long played = 0;
+    for (const TuneGame& game : results) played += game.ticks;
+    printf("%zu configs x %d games, %s bot, cap %.0f s, %d threads\n", configs.size(), games,
+           aim ? "aim" : "scripted", ticks / (float)SIM_HZ, threads);
+    printf("  %.0f ms, %.0f games/s, %.0f ticks/ms\n", ms, total * 1000.0 / ms, played / ms);
+
+    FILE* csv = fopen(csvPath, "w");
+    if (!csv) {
+        fprintf(stderr, "tune: cannot write %s\n", csvPath);
+        return 1;
+    }
+    fprintf(csv, "interval_pct,speed_pct,size_pct,games,score_mean,score_p10,score_p50,score_p90,"
+                 "survival_mean_s,survival_p10_s,survival_p50_s,survival_p90_s,survived_pct\n");
+    printf("  interval  speed  size   score mean   p10   p50   p90   survival mean   p10   p50   p90  survived\n");
+    int best = 0;
+    float bestGap = 0.0f;
+    for (int c = 0; c < (int)configs.size(); c++) {
+        vector<float> scores, survival;
+        double scoreSum = 0.0, survivalSum = 0.0;
+        int survived = 0;
+        for (int g = 0; g < games; g++) {
+            const TuneGame& game = results[c * games + g];
+            scores.push_back((float)game.score);
+            survival.push_back(game.ticks / (float)SIM_HZ);
+            scoreSum += game.score;
+            survivalSum += game.ticks / (double)SIM_HZ;
+            survived += !game.dead;
+        }
+        const TuneConfig& config = configs[c];
+        float s10 = Percentile(scores, 0.1f), s50 = Percentile(scores, 0.5f), s90 = Percentile(scores, 0.9f);
+        float t10 = Percentile(survival, 0.1f), t50 = Percentile(survival, 0.5f), t90 = Percentile(survival, 0.9f);
+        fprintf(csv, "%d,%d,%d,%d,%.3f,%.0f,%.0f,%.0f,%.3f,%.3f,%.3f,%.3f,%.2f\n", config.intervalPct,
+                config.speedPct, config.sizePct, games, scoreSum / games, s10, s50, s90, survivalSum / games,
+                t10, t50, t90, 100.0 * survived / games);
+        printf("  %7d%%  %4d%%  %3d%%   %10.1f  %4.0f  %4.0f  %4.0f   %11.1f s  %4.1f  %4.1f  %4.1f  %6.1f%%\n",
+               config.intervalPct, config.speedPct, config.sizePct, scoreSum / games, s10, s50, s90,
+               survivalSum / games, t10, t50, t90, 100.0 * survived / games);
+        float gap = fabsf(t50 - targetSeconds);
+        if (c == 0 || gap < bestGap) {
+            best = c;
+            bestGap = gap;
+        }
+    }
+    fclose(csv);
+    printf("closest to %.0f s median survival: interval %d%%, speed %d%%, size %d%%\n", targetSeconds,
+           configs[best].intervalPct, configs[best].speedPct, configs[best].sizePct);
+    printf("wrote %s\n", csvPath);
+    return 0;
+}
+
+// ./game --autopilot-bench [--games 20] [--seconds 120] [--budget-us 500] [--seed N]
+// Lets the autopilot play headless games until it crashes or the time cap,
+// as fast as the machine allows.
+int RunAutopilotBench(int argc, char** argv) {
+    int games = 20;
+    float seconds = 120.0f;
+    float budgetUs = 500.0f;
+    int maxCandidates = 0;
+    uint64_t seed = 1234;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--games") == 0 && i + 1 < argc) games = atoi(argv[++i]);
+        if (strcmp(argv[i], "--seconds") == 0 && i + 1 < argc) seconds = (float)atof(argv[++i]);
+        if (strcmp(argv[i], "--budget-us") == 0 && i + 1 < argc) budgetUs = (float)atof(argv[++i]);
+        if (strcmp(argv[i], "--candidates") == 0 && i + 1 < argc) maxCandidates = atoi(argv[++i]);
+        if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) seed = strtoull(argv[++i], nullptr, 10);
+    }
+    if (games < 1) games = 1;
+    simClock.headless = true;
+    simClock.frameTime = 1.0f / 60.0f;
+    const int ticks = (int)(seconds * 60.0f);
+
+    vector<float> survival, planUs;
+    double scoreSum = 0.0;
+    double planUsSum = 0.0;
+    long candidates = 0, kept = 0, overBudget = 0, planned = 0;
+    int capped = 0;
+    auto start = chrono::steady_clock::now();
+    for (int g = 0; g < games; g++) {
+        World world(simClock.width, simClock.height, seed + g);
+        world.LoadAssets();
+        AutopilotInput autopilot(world, seed + g);
+        autopilot.pilot.params.budgetUs = budgetUs;
+        autopilot.pilot.params.maxCandidates = maxCandidates;
+        int t = 0;
+        for (; t < ticks && world.currentScreen == GAMEPLAY; t++) {
+            autopilot.handleInput();
+            world.Update();
+            planUs.push_back((float)autopilot.pilot.Metrics().lastPlanUs);
+        }
+        survival.push_back(t / 60.0f);
+        capped += world.currentScreen == GAMEPLAY;
+        scoreSum += world.score;
+        const PilotMetrics& m = autopilot.pilot.Metrics();
+        planUsSum += m.planUsSum;
+        candidates += m.candidates;
+        kept += m.kept;
+        overBudget += m.overBudget;
+        planned += m.ticks;
+    }
+    double wallSeconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    double played = 0.0;
+    for (float s : survival) played += s;
+
+    float overRatio = planned ? (float)overBudget / planned : 0.0f;
+    printf("%d games, cap %.0f s, budget %.0f us per tick\n", games, seconds, budgetUs);
+    printf("  survival     mean %.1f s  p10 %.1f  p50 %.1f  p90 %.1f  %d of %d reached the cap\n", played / games,
+           Percentile(survival, 0.1f), Percentile(survival, 0.5f), Percentile(survival, 0.9f), capped, games);
+    printf("  score        mean %.1f\n", scoreSum / games);
+    printf("  planning     mean %.1f us  p99 %.1f us  max %.1f us  %.2f%% of ticks over budget\n",
+           planned ? planUsSum / planned : 0.0, Percentile(planUs, 0.99f),
+           planUs.empty() ? 0.0f : *max_element(planUs.begin(), planUs.end()), 100.0f * overRatio);
+    printf("  search       %.0f candidates per tick, previous plan kept on %.1f%% of ticks\n",
+           planned ? (double)candidates / planned : 0.0, planned ? 100.0 * kept / planned : 0.0);
+    printf("  speed        %.0fx real time\n", played / wallSeconds);
+    // The planner checks the clock between candidates, so a preemption in the
+    // middle of one still shows up as the odd late tick.
+    bool held = overRatio <= 0.02f;
+    printf("budget %s: %.2f%% of ticks over %.0f us\n", held ? "HELD" : "MISSED", 100.0f * overRatio, budgetUs);
+    return held ? 0 : 1;
+}
+
+// ./game --boss-bench [--bullets 2000] [--repeat 20] [--seed N]
+// Builds bosses of 64 to 16384 plates and times bullet queries through the
+// tree against a scan of every plate, and a refit against a rebuild. The
+// queries are checked against the scan, whole and with half the plates shot
+// away.
+int RunBossBench(int argc, char** argv) {
+    int bulletCount = 2000;
+    int repeat = 20;
+    uint64_t seed = 1234;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--bullets") == 0 && i + 1 < argc) bulletCount = atoi(argv[++i]);
+        if (strcmp(argv[i], "--repeat") == 0 && i + 1 < argc) repeat = atoi(argv[++i]);
+        if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) seed = strtoull(argv[++i], nullptr, 10);
+    }
+    if (bulletCount < 1) bulletCount = 1;
+    if (repeat < 1) repeat = 1;
+    RandomStream rng(seed, 0);
+    const float radius = 5.0f;
+    long mismatches = 0;
+    volatile long sink = 0;
+
+    printf("%d bullets of radius %.0f, %d rounds\n", bulletCount, radius, repeat);
+    printf("  plates   nodes   refit us  rebuild us   tree ns/query  nodes/query   scan ns/query  half gone: nodes/query\n");
+    for (int plates = 64; plates <= 16384; plates *= 4) {
+        vector<BossPart> layout = BossDisc(plates, 8.0f);
+        Boss boss;
+        boss.x = 640.0f;
+        boss.y = 360.0f;
+        boss.angle = 0.3f;
+        boss.Build(layout);
+        const float reach = boss.Radius();
+        vector<Vector2> shots(bulletCount);
+        for (Vector2& shot : shots) {
+            shot = {boss.x + (rng.NextFloat() * 2.0f - 1.0f) * reach, boss.y + (rng.NextFloat() * 2.0f - 1.0f) * reach};
+        }
+
+        auto start = chrono::steady_clock::now();
+        for (int r = 0; r < repeat; r++) {
+            boss.angle += 0.01f;
+            boss.Refit();
+        }
+        double refitUs = chrono::duration<double, micro>(chrono::steady_clock::now() - start).count() / repeat;
+        start = chrono::steady_clock::now();
+        for (int r = 0; r < repeat; r++) boss.Build(layout);
+        double rebuildUs = chrono::duration<double, micro>(chrono::steady_clock::now() - start).count() / repeat;
+
+        auto query = [&](long& visitedSum) {
+            auto began = chrono::steady_clock::now();
+            long hits = 0;
+            for (int r = 0; r < repeat; r++) {
+                for (const Vector2& shot : shots) {
+                    int visited = 0;
+                    hits += boss.FirstCircleHit(shot.x, shot.y, radius, &visited);
+                    visitedSum += visited;
+                }
+            }
+            sink = sink + hits;
+            return chrono::duration<double, nano>(chrono::steady_clock::now() - began).count() / ((double)repeat * bulletCount);
+        };
+        auto check = [&]() {
+            for (const Vector2& shot : shots) {
+                mismatches += boss.FirstCircleHit(shot.x, shot.y, radius) != boss.ScanCircleHit(shot.x, shot.y, radius);
+            }
+        };
+
+        long visited = 0;
+        double treeNs = query(visited);
+        start = chrono::steady_clock::now();
+        long hits = 0;
+        for (int r = 0; r < repeat; r++) {
+            for (const Vector2& shot : shots) hits += boss.ScanCircleHit(shot.x, shot.y, radius);
+        }
+        sink = sink + hits;
+        double scanNs = chrono::duration<double, nano>(chrono::steady_clock::now() - start).count() / ((double)repeat * bulletCount);
+        check();
+
+        for (int p = 0; p < boss.PartCount(); p++) {
+            if (rng.NextFloat() < 0.5f) boss.Destroy(p);
+        }
+        boss.Refit();
+        long visitedHalf = 0;
+        query(visitedHalf);
+        check();
+
+        printf("  %6d  %6d  %9.2f  %10.2f  %14.1f  %11.1f  %14.1f  %22.1f\n", plates, boss.NodeCount(), refitUs, rebuildUs,
+               treeNs, (double)visited / ((double)repeat * bulletCount), scanNs,
+               (double)visitedHalf / ((double)repeat * bulletCount));
+    }
+    printf("tree and scan disagree on %ld queries\n", mismatches);
+    return mismatches == 0 ? 0 : 1;
+}
+
+// ./game --entity-bench [--entities 4096] [--ticks 600] [--churn 5] [--seed N]
+// Keeps a pool at a steady size while --churn percent of it dies and is
+// replaced every tick, and keeps every handle ever handed out. Each tick a
+// sample of those handles is looked up: live ones must reach their own
+// entity, dead ones must come back empty.
+struct BenchEntity {
+    uint32_t serial;
+    bool active;
+};
+
+int RunEntityBench(int argc, char** argv) {
+    int count = 4096;
+    int ticks = 600;
+    int churn = 5;
+    uint64_t seed = 1234;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--entities") == 0 && i + 1 < argc) count = atoi(argv[++i]);
+        if (strcmp(argv[i], "--ticks") == 0 && i + 1 < argc) ticks = atoi(argv[++i]);
+        if (strcmp(argv[i], "--churn") == 0 && i + 1 < argc) churn = atoi(argv[++i]);
+        if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) seed = strtoull(argv[++i], nullptr, 10);
+    }
+    if (count < 1) count = 1;
+    if (ticks < 1) ticks = 1;
+    RandomStream rng(seed, 0);
+    EntityRegistry registry;
+    EntityPool<BenchEntity> pool(registry);
+
+    vector<EntityHandle> issued;  // index is the serial
+    vector<uint8_t> alive;
+    auto spawn = [&]() {
+        issued.push_back(pool.Add({(uint32_t)issued.size(), true}));
+        alive.push_back(1);
+    };
+    for (int i = 0; i < count; i++) spawn();
+
+    const int samples = 1000;
+    long lookups = 0, liveLookups = 0, errors = 0;
+    double lookupNs = 0.0;
+    vector<uint32_t> picked(samples);
+    for (int tick = 0; tick < ticks; tick++) {
+        int deaths = 0;
+        for (BenchEntity& e : pool) {
+            if (rng.Range(0, 99) < churn) {
+                e.active = false;
+                alive[e.serial] = 0;
+                deaths++;
+            }
+        }
+        SweepInactive(pool);
+        for (int i = 0; i < deaths; i++) spawn();
+
+        for (uint32_t& serial : picked) serial = (uint32_t)rng.Range(0, (int)issued.size() - 1);
+        long found = 0;
+        auto start = chrono::steady_clock::now();
+        for (uint32_t serial : picked) {
+            const BenchEntity* e = pool.Get(issued[serial]);
+            found += e != nullptr;
+            if (e ? !alive[serial] || e->serial != serial : alive[serial] != 0) errors++;
+        }
+        lookupNs += chrono::duration<double, nano>(chrono::steady_clock::now() - start).count();
+        lookups += samples;
+        liveLookups += found;
+    }
+
+    printf("%d entities, %d%% replaced per tick, %d ticks\n", count, churn, ticks);
+    printf("  handles    %zu handed out, %d live in %d slots\n", issued.size(), registry.Live(), registry.Slots());
+    printf("  lookups    %ld, %ld live and %ld stale, %.1f ns each\n", lookups, liveLookups, lookups - liveLookups,
+           lookupNs / lookups);
+    printf("  wrong      %ld lookups reached the wrong entity or missed a live one\n", errors);
+    return errors == 0 ? 0 : 1;
+}
+
+// ./game --leaderboard-bench [--records 2000000] [--compact-after 65536] [--kills 5] [--path PATH] [--seed N]
+// Pushes that many runs through a fresh store, times the game-side submit
+// and the queries, checks the answers against a scan of every run and checks
+// that a reopened store reads the same board. Then it cuts a write short by
+// hand, and kills writers in child processes with SIGKILL part way through:
+// what comes back must be exactly the runs up to some point.
+RunRecord BenchRun(uint64_t seed, long i) {
+    RandomStream rng(seed, (uint64_t)i);
+    int32_t score = rng.Range(0, 20000) * rng.Range(0, 100) / 100;
+    uint32_t durationMs = (uint32_t)rng.Range(2000, 600000);
+    return {(uint64_t)i + 1, seed, 1760000000 + (int64_t)i * 20, score, durationMs};
+}
+
+// The board of the first n bench runs, added one by one without a store.
+LeaderboardIndex BenchBoard(uint64_t seed, long n) {
+    LeaderboardIndex index;
+    for (long i = 0; i < n; i++) index.Add(BenchRun(seed, i));
+    return index;
+}
+
+long FileBytes(const string& path) {
+    FILE* file = fopen(path.c_str(), "rb");
+    if (!file) return 0;
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fclose(file);
+    return size;
+}
+
+void RemoveBoard(const string& path) {
+    remove(path.c_str());
+    remove((path + ".snap").c_str());
+}
+
+int RunLeaderboardBench(int argc, char** argv) {
+    long records = 2000000;
+    long compactAfter = 65536;
+    int kills = 5;
+    string path = "/tmp/leaderboard-bench.log";
+    uint64_t seed = 1234;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--records") == 0 && i + 1 < argc) records = atol(argv[++i]);
+        if (strcmp(argv[i], "--compact-after") == 0 && i + 1 < argc) compactAfter = atol(argv[++i]);
+        if (strcmp(argv[i], "--kills") == 0 && i + 1 < argc) kills = atoi(argv[++i]);
+        if (strcmp(argv[i], "--path") == 0 && i + 1 < argc) path = argv[++i];
+        if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) seed = strtoull(argv[++i], nullptr, 10);
+    }
+    if (records < 1) records = 1;
+    if (compactAfter < 0) compactAfter = 0;
+    long mismatches = 0;
+    string error;
+
+    vector<RunRecord> runs(records);
+    for (long i = 0; i < records; i++) runs[i] = BenchRun(seed, i);
+
+    RemoveBoard(path);
+    LeaderboardStore store;
+    store.compactAfter = (size_t)compactAfter;
+    if (!store.Open(path, error)) {
+        cerr << "Cannot open " << path << ": " << error << endl;
+        return 1;
+    }
+    vector<float> submitUs(records);
+    auto start = chrono::steady_clock::now();
+    for (long i = 0; i < records; i++) {
+        auto before = chrono::steady_clock::now();
+        store.Submit(runs[i].score, runs[i].durationMs, runs[i].seed, runs[i].timestamp);
+        submitUs[i] = chrono::duration<float, micro>(chrono::steady_clock::now() - before).count();
+    }
+    store.Flush();
+    double writeSeconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    LeaderboardMetrics m = store.Metrics();
+    sort(submitUs.begin(), submitUs.end());
+    auto percentile = [&](double p) { return submitUs[min(records - 1, (long)(p * records))]; };
+    printf("leaderboard: %ld runs, compaction after %ld\n", records, compactAfter);
+    printf("  submit     %.2f us p50, %.2f p99, %.2f p99.9, %.1f max on the game thread\n", percentile(0.5),
+           percentile(0.99), percentile(0.999), submitUs[records - 1]);
+    printf("  writer     %.0f runs/s, %ld compactions (slowest %.1f ms), %ld failures\n", records / writeSeconds,
+           m.compactions, m.compactMsMax, m.failures);
+    printf("  on disk    log %ld bytes, snapshot %ld bytes\n", FileBytes(path), FileBytes(path + ".snap"));
+
+    const LeaderboardIndex& index = store.Index();
+    RandomStream rng(seed, 1);
+    const int queries = 100000;
+    vector<int32_t> probes(queries);
+    for (int32_t& probe : probes) probe = rng.Range(-10, 20010);
+    vector<RunRecord> top;
+    start = chrono::steady_clock::now();
+    for (int q = 0; q < queries; q++) index.Top(10, top);
+    double topNs = chrono::duration<double, nano>(chrono::steady_clock::now() - start).count() / queries;
+    long sink = 0;
+    start = chrono::steady_clock::now();
+    for (int32_t probe : probes) sink += index.Above(probe);
+    double rankNs = chrono::duration<double, nano>(chrono::steady_clock::now() - start).count() / queries;
+    int32_t firstDay = RunDay(runs.front().timestamp), lastDay = RunDay(runs.back().timestamp);
+    RunRecord best;
+    start = chrono::steady_clock::now();
+    for (int q = 0; q < queries; q++) sink += index.DayBest(rng.Range(firstDay, lastDay), best);
+    double dayNs = chrono::duration<double, nano>(chrono::steady_clock::now() - start).count() / queries;
+    // A rank asked right after a new run, as the game over screen does.
+    LeaderboardIndex fresh = index;
+    const int inserts = 1000;
+    double insertRankNs = 0.0;
+    for (int q = 0; q < inserts; q++) {
+        RunRecord run = BenchRun(seed, records + q);
+        start = chrono::steady_clock::now();
+        fresh.Add(run);
+        sink += fresh.Above(run.score);
+        insertRankNs += chrono::duration<double, nano>(chrono::steady_clock::now() - start).count();
+    }
+    printf("  queries    top-10 %.0f ns, rank %.0f ns, day best %.0f ns, add then rank %.1f us (%zu scores, %zu days)\n",
+           topNs, rankNs, dayNs, insertRankNs / inserts / 1000.0, index.DistinctScores(), index.Days().size());
+
+    // Against a scan of every run.
+    vector<int32_t> scores(records);
+    for (long i = 0; i < records; i++) scores[i] = runs[i].score;
+    sort(scores.begin(), scores.end());
+    for (int q = 0; q < 1000; q++) {
+        long above = (long)(scores.end() - upper_bound(scores.begin(), scores.end(), probes[q]));
+        if (index.Above(probes[q]) != above) mismatches++;
+    }
+    vector<RunRecord> sorted = runs;
+    partial_sort(sorted.begin(), sorted.begin() + min(records, 10L), sorted.end(), BetterRun);
+    index.Top(10, top);
+    for (size_t i = 0; i < top.size(); i++) {
+        if (top[i].sequence != sorted[i].sequence) mismatches++;
+    }
+    map<int32_t, RunRecord> days;
+    for (const RunRecord& run : runs) {
+        auto it = days.find(RunDay(run.timestamp));
+        if (it == days.end() || BetterRun(run, it->second)) days[RunDay(run.timestamp)] = run;
+    }
+    if (days.size() != index.Days().size()) mismatches++;
+    for (const auto& day : days) {
+        if (!index.DayBest(day.first, best) || best.sequence != day.second.sequence) mismatches++;
+    }
+    printf("  checked    %ld answers differ from a scan of every run\n", mismatches);
+
+    LeaderboardIndex before = index;
+    store.Close();
+    start = chrono::steady_clock::now();
+    if (!store.Open(path, error)) {
+        cerr << "Cannot reopen " << path << ": " << error << endl;
+        return 1;
+    }
+    double reopenMs = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+    bool same = store.Index().Matches(before);
+    mismatches += !same;
+    printf("  reopen     %.2f ms, %ld runs replayed from the log, %s\n", reopenMs, store.Metrics().recovered,
+           same ? "same board" : "BOARD DIFFERS");
+    store.Close();
+    RemoveBoard(path);
+
+    // Half a slot past the last run, as a write cut short leaves it.
+    const long tornRuns = 1000;
+    store.compactAfter = 0;
+    store.Open(path, error);
+    for (long i = 0; i < tornRuns; i++) store.Submit(runs[i].score, runs[i].durationMs, runs[i].seed, runs[i].timestamp);
+    store.Close();
+    if (FILE* file = fopen(path.c_str(), "r+b")) {
+        RunRecord next = runs[tornRuns];
+        fseek(file, (long)(sizeof(LogHeader) + tornRuns * sizeof(LogSlot)), SEEK_SET);
+        fwrite(&next, sizeof(next) / 2, 1, file);
+        fclose(file);
+    }
+    store.Open(path, error);
+    bool tornOk = store.Metrics().tornTail && store.Index().Matches(BenchBoard(seed, tornRuns));
+    store.Submit(runs[tornRuns].score, runs[tornRuns].durationMs, runs[tornRuns].seed, runs[tornRuns].timestamp);
+    store.Close();
+    store.Open(path, error);
+    tornOk = tornOk && !store.Metrics().tornTail && store.Index().Matches(BenchBoard(seed, tornRuns + 1));
+    store.Close();
+    RemoveBoard(path);
+    mismatches += !tornOk;
+    printf("  torn slot  %s\n", tornOk ? "dropped on open and overwritten by the next run" : "NOT HANDLED");
+
+#if !defined(_WIN32)
+    // Small compactions, so that some kills land in the middle of one.
+    const long killCompact = min(compactAfter > 0 ? compactAfter : 4096L, 4096L);
+    for (int k = 0; k < kills; k++) {
+        RemoveBoard(path);
+        fflush(stdout);
+        pid_t child = fork();
+        if (child == 0) {
+            LeaderboardStore writer;
+            writer.compactAfter = (size_t)killCompact;
+            if (!writer.Open(path, error)) _exit(1);
+            for (const RunRecord& run : runs) writer.Submit(run.score, run.durationMs, run.seed, run.timestamp);
+            writer.Flush();
+            for (;;) pause();
+        }
+        int delayMs = 30 * (k + 1);
+        this_thread::sleep_for(chrono::milliseconds(delayMs));
+        kill(child, SIGKILL);
+        waitpid(child, nullptr, 0);
+
+        LeaderboardStore after;
+        after.compactAfter = (size_t)killCompact;
+        bool opened = after.Open(path, error);
+        long recovered = after.Index().Runs();
+        LeaderboardMetrics am = after.Metrics();
+        bool prefix = opened && recovered <= records && after.Index().Matches(BenchBoard(seed, recovered));
+        mismatches += !prefix;
+        printf("  kill %d     after %3d ms: %ld runs back (%ld from the snapshot, %ld from the log%s), %s\n", k + 1, delayMs,
+               recovered, recovered - am.recovered, am.recovered, am.tornTail ? ", torn slot dropped" : "",
+               prefix ? "a prefix of what was sent" : "NOT A PREFIX");
+        after.Close();
+    }
+    RemoveBoard(path);
+#endif
+    if (sink == 42) printf(" ");
+    return mismatches == 0 ? 0 : 1;
+}
+
+// ./game --scores [--top 10] [--leaderboard leaderboard.log]
+// Prints the board without starting the game.
+int RunScores(int argc, char** argv) {
+    int count = 10;
+    string path = DEFAULT_LEADERBOARD;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--top") == 0 && i + 1 < argc) count = atoi(argv[++i]);
+        if (strcmp(argv[i], "--leaderboard") == 0 && i + 1 < argc) path = argv[++i];
+    }
+    LeaderboardStore board;
+    string error;
+    if (!board.Open(path, error)) {
+        cerr << "Cannot open " << path << ": " << error << endl;
+        return 1;
+    }
+    auto date = [](int64_t timestamp, char* out, size_t size) {
+        time_t t = (time_t)timestamp;
+        strftime(out, size, "%Y-%m-%d %H:%M", gmtime(&t));
+    };
+    char when[32];
+    vector<RunRecord> top;
+    board.Index().Top(count, top);
+    printf("%ld runs\n", board.Index().Runs());
+    for (size_t i = 0; i < top.size(); i++) {
+        date(top[i].timestamp, when, sizeof(when));
+        printf("%4zu  %6d  %7.1f s  %s UTC  seed %llu\n", i + 1, top[i].score, top[i].durationMs / 1000.0, when,
+               (unsigned long long)top[i].seed);
+    }
+    const auto& days = board.Index().Days();
+    if (!days.empty()) printf("best of the last days:\n");
+    int shown = 0;
+    for (auto it = days.rbegin(); it != days.rend() && shown < 7; ++it, shown++) {
+        date(it->second.timestamp, when, sizeof(when));
+        printf("  %.10s  %6d\n", when, it->second.score);
+    }
+    return 0;
+}
+
+// ./game --parallax-bench [--frames 600] [--width 1280] [--height 720] [--seed N]
+// Scrolls the game's background at its normal speed for --frames frames from
+// 0 and from ever further out, up to 10^12 px, and builds the draw list every
+// frame. The sprites drawn, the cost of a frame and the chunk slots must not
+// depend on the distance, and scrolling back to 0 must give the first frame's
+// draw list again.
+int RunParallaxBench(int argc, char** argv) {
+    int frames = 600;
+    int width = 1280;
+    int height = 720;
+    uint64_t seed = 1234;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc) frames = atoi(argv[++i]);
+        if (strcmp(argv[i], "--width") == 0 && i + 1 < argc) width = atoi(argv[++i]);
+        if (strcmp(argv[i], "--height") == 0 && i + 1 < argc) height = atoi(argv[++i]);
+        if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) seed = strtoull(argv[++i], nullptr, 10);
+    }
+    if (frames < 1) frames = 1;
+    ParallaxBackground background;
+    background.Configure(BACKGROUND_LAYERS, seed);
+    vector<BackgroundQuad> quads, firstQuads;
+    background.BuildDrawList(firstQuads, width, height);
+    const int slots = background.Metrics().slots;
+
+    const double starts[] = {0.0, 1.0e4, 1.0e6, 1.0e8, 1.0e10, 1.0e12};
+    printf("parallax: %zu layers, %d x %d, %d frames from each distance\n", BACKGROUND_LAYERS.size(), width, height, frames);
+    printf("  %14s  %9s  %8s  %8s  %10s  %12s  %6s\n", "from px", "quads min", "mean", "max", "ns/frame", "chunks/frame",
+           "slots");
+    double firstMean = 0.0;
+    int failures = 0;
+    for (double start : starts) {
+        background.SetDistance(start);
+        // Fills every slot for the new distance; not part of the steady cost.
+        background.BuildDrawList(quads, width, height);
+        long generated = background.Metrics().generated;
+        int minQuads = INT32_MAX, maxQuads = 0;
+        long sum = 0;
+        double ns = 0.0;
+        for (int f = 0; f < frames; f++) {
+            auto before = chrono::steady_clock::now();
+            background.Scroll(BACKGROUND_SPEED / 60.0);
+            background.BuildDrawList(quads, width, height);
+            ns += chrono::duration<double, nano>(chrono::steady_clock::now() - before).count();
+            int n = (int)quads.size();
+            minQuads = min(minQuads, n);
+            maxQuads = max(maxQuads, n);
+            sum += n;
+        }
+        double mean = (double)sum / frames;
+        if (start == 0.0) firstMean = mean;
+        // The jittered grid keeps the count within a sprite or two per layer.
+        bool steady = fabs(mean - firstMean) <= 0.02 * firstMean && background.Metrics().slots == slots;
+        failures += !steady;
+        printf("  %14.0f  %9d  %8.1f  %8d  %10.0f  %12.3f  %6d%s\n", start, minQuads, mean, maxQuads, ns / frames,
+               (double)(background.Metrics().generated - generated) / frames, background.Metrics().slots,
+               steady ? "" : "  DRIFTED");
+    }
+
+    background.SetDistance(0.0);
+    background.BuildDrawList(quads, width, height);
+    bool same = quads.size() == firstQuads.size() &&
+                memcmp(quads.data(), firstQuads.data(), quads.size() * sizeof(BackgroundQuad)) == 0;
+    failures += !same;
+    printf("back at 0: %s\n", same ? "same draw list as the first frame" : "DRAW LIST DIFFERS");
+    return failures == 0 ? 0 : 1;
+}
+
+// ./game --tuning-bench [--reloads 100] [--dir PATH]
+// Checks that tuning.txt in the working directory, if there is one, gives
+// the built-in values, and that broken files are rejected with their errors.
+// Then a writer thread rewrites a watched file --reloads times, in place and
+// by rename, every tenth time with a mistake in it. A 1 kHz tick loop adopts
+// what the watcher hands over and checks that every block it sees is whole
+// and no older than the last one. Reports write-to-adopt latency.
+string BenchTuningText(int generation, bool broken) {
+    char text[512];
+    snprintf(text, sizeof(text),
+             "# generation %d\n"
+             "ship.acceleration = %d\n"
+             "ship.deceleration = %d\n"
+             "bullet.speed = %d\n"
+             "star.points = %d\n"
+             "gibran.speed = %d %d\n"
+             "%s",
+             generation, 1000 + generation, 1000 + generation, 300 + generation, generation, 50 + generation,
+             60 + generation, broken ? "opm.scale = 0.5 0.2\n" : "");
+    return text;
+}
+
+// The generation a bench block was written as, or -1 if its fields disagree.
+int BenchTuningGeneration(const TuningParams& params) {
+    int g = params.kinds[KIND_STAR].points;
+    bool whole = params.shipAcceleration == 1000.0f + g && params.shipDeceleration == 1000.0f + g &&
+                 params.bulletSpeed == 300.0f + g && params.kinds[KIND_GIBRAN].vxMax == -(50 + g) * 10 &&
+                 params.kinds[KIND_GIBRAN].vxMin == -(60 + g) * 10;
+    return whole ? g : -1;
+}
+
+int RunTuningBench(int argc, char** argv) {
+    int reloads = 100;
+    string dir = "/tmp/tuning-bench";
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--reloads") == 0 && i + 1 < argc) reloads = atoi(argv[++i]);
+        if (strcmp(argv[i], "--dir") == 0 && i + 1 < argc) dir = argv[++i];
+    }
+    if (reloads < 1) reloads = 1;
+    int failures = 0;
+
+    vector<unsigned char> shipped;
+    if (ReadWholeFile(DEFAULT_TUNING, shipped)) {
+        TuningParams params;
+        vector<string> errors;
+        bool ok = ParseTuning(string(shipped.begin(), shipped.end()), DEFAULT_TUNING, params, errors);
+        TuningParams builtIn;
+        bool same = ok && memcmp(&params, &builtIn, sizeof(params)) == 0;
+        failures += !same;
+        printf("%s: %s\n", DEFAULT_TUNING, same ? "same as the built-in values" : "DIFFERS from the built-in values");
+        for (const string& e : errors) printf("  %s\n", e.c_str());
+    }
+
+    const char* broken[] = {
+        "ship.acceleration = fast\n",
+        "bullet.speed = 0\n",
+        "star.interval = -1\n",
+        "polri.speed = 200 100\n",
+        "ma.scale = 0.0001 0.1\n",
+        "gibran.points = 2.5\n",
+        "opm.colour = red\n",
+        "ship.acceleration 1500\n",
+        "star.weight = 0\npolri.weight = 0\nopm.weight = 0\ngibran.weight = 0\nma.weight = 0\n",
+    };
+    int caught = 0;
+    printf("rejected files:\n");
+    for (const char* text : broken) {
+        TuningParams params;
+        vector<string> errors;
+        bool ok = ParseTuning(text, "bad.txt", params, errors);
+        caught += !ok;
+        for (const string& e : errors) printf("  %s\n", e.c_str());
+    }
+    failures += caught != (int)(sizeof(broken) / sizeof(broken[0]));
+
+#if !defined(_WIN32)
+    mkdir(dir.c_str(), 0755);
+    string path = dir + "/tuning.txt";
+    string temporary = dir + "/tuning.txt.new";
+    remove(path.c_str());
+    TuningWatcher watcher;
+    watcher.log = false;
+    string error;
+    if (!watcher.Start(path, error)) {
+        cerr << "Cannot watch " << path << ": " << error << endl;
+        return 1;
+    }
+
+    vector<atomic<int64_t>> written(reloads + 1);
+    for (auto& w : written) w = 0;
+    atomic<bool> writing{true};
+    int brokenWrites = 0;
+    for (int g = 1; g <= reloads; g++) brokenWrites += g % 10 == 0;
+    thread writer([&]() {
+        for (int g = 1; g <= reloads; g++) {
+            bool bad = g % 10 == 0;
+            string text = BenchTuningText(g, bad);
+            // Alternates between rewriting the file and renaming a new one over it.
+            const string& target = g % 2 ? path : temporary;
+            FILE* file = fopen(target.c_str(), "wb");
+            if (file) {
+                fwrite(text.data(), 1, text.size(), file);
+                fclose(file);
+            }
+            if (target == temporary) rename(temporary.c_str(), path.c_str());
+            written[g] = TuningWatcher::Now();
+            this_thread::sleep_for(chrono::milliseconds(20));
+        }
+        writing = false;
+    });
+
+    TuningParams adopted;
+    vector<double> latencies;
+    int last = 0, torn = 0, backwards = 0, adoptedBad = 0;
+    long ticks = 0;
+    double adoptNs = 0.0;
+    auto deadline = chrono::steady_clock::now() + chrono::seconds(10 + reloads / 20);
+    while (chrono::steady_clock::now() < deadline) {
+        auto before = chrono::steady_clock::now();
+        bool took = watcher.Adopt(adopted);
+        adoptNs += chrono::duration<double, nano>(chrono::steady_clock::now() - before).count();
+        ticks++;
+        if (took) {
+            int g = BenchTuningGeneration(adopted);
+            int64_t at = TuningWatcher::Now();
+            if (g < 0) {
+                torn++;
+            } else {
+                if (g < last) backwards++;
+                if (g % 10 == 0) adoptedBad++;
+                if (g >= 1 && g <= reloads && written[g] > 0) latencies.push_back((at - written[g]) / 1.0e6);
+                last = g;
+            }
+        }
+        if (!writing && last >= reloads - (reloads % 10 == 0)) break;
+        this_thread::sleep_for(chrono::milliseconds(1));
+    }
+    writer.join();
+    TuningMetrics m = watcher.Metrics();
+    watcher.Stop();
+    remove(path.c_str());
+
+    sort(latencies.begin(), latencies.end());
+    auto at = [&](double p) { return latencies.empty() ? 0.0 : latencies[min(latencies.size() - 1, (size_t)(p * latencies.size()))]; };
+    bool ok = torn == 0 && backwards == 0 && adoptedBad == 0 && m.rejected >= brokenWrites &&
+              last == reloads - (reloads % 10 == 0);
+    failures += !ok;
+    printf("reloads: %d writes (%d broken), %ld loaded, %ld rejected, %ld adopted, last generation %d\n", reloads,
+           brokenWrites, m.loads, m.rejected, m.adopted, last);
+    printf("  write to adopt  %.2f ms p50, %.2f p99, %.2f max (1 ms ticks)\n", at(0.5), at(0.99),
+           latencies.empty() ? 0.0 : latencies.back());
+    printf("  parse           %.3f ms last file\n", m.parseMs);
+    printf("  adopt           %.0f ns per tick over %ld ticks\n", adoptNs / max(1L, ticks), ticks);
+    printf("  checks          %d torn blocks, %d went backwards, %d broken files adopted\n", torn, backwards, adoptedBad);
+#endif
+    return failures == 0 ? 0 : 1;
+}
+
+// ./game --spectate [--host 127.0.0.1] [--port 7777]
+// Draws what a running game streams, with flat shapes instead of textures.
+int RunSpectator(int argc, char** argv) {
+    const char* host = "127.0.0.1";
+    int port = SPECTATOR_PORT;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--host") == 0 && i + 1 < argc) host = argv[++i];
+        if (strcmp(argv[i], "--port") == 0 && i + 1 < argc) port = atoi(argv[++i]);
+    }
+    SpectatorClient client;
+    string error;
+    if (!client.Connect(host, port, error)) {
+        cerr << "Cannot reach " << host << ":" << port << ": " << error << endl;
+        return 1;
+    }
+
+    InitWindow(1280, 720, "GARUDA PANCASILA - spectator");
+    SetTargetFPS(60);
+    SpectatorModel model;
+    while (!WindowShouldClose()) {
+        client.Poll(model);
+
+        BeginDrawing();
+        ClearBackground(BLACK);
+        if (!model.synced) {
+            const char* text = client.Connected() ? "WAITING FOR STREAM..." : "NO STREAM";
+            DrawText(text, 640 - MeasureText(text, 30) / 2, 345, 30, WHITE);
+        } else {
+            for (const auto& entry : model.entities) {
+                const SpectatorEntity& e = entry.second;
+                if (e.kind == SPECTATE_BULLET) {
+                    DrawCircleV({e.x, e.y}, e.w / 2, WHITE);
+                } else {
+                    DrawRectangleLinesEx({e.x, e.y, e.w, e.h}, 2.0f, KIND_COLORS[e.kind % KIND_COUNT]);
+                }
+            }
+            DrawRectangleRec({model.shipX, model.shipY, model.shipW, model.shipH}, RAYWHITE);
+            DrawText(TextFormat("SCORE: %d", model.score), 10, 10, 20, WHITE);
+            DrawText(TextFormat("tick %u  %d entities%s", model.tick, (int)model.entities.size(),
+                                client.Connected() ? "" : "  (stream ended)"), 10, 34, 10, LIGHTGRAY);
+            if (model.screen == GAMEOVER) DrawText("GAME OVER", 640 - MeasureText("GAME OVER", 50) / 2, 340, 50, PINK);
+        }
+        EndDrawing();
+    }
+    CloseWindow();
+    return 0;
+}
+
+// Plays a headless game into a local server with many viewers, half of them
+// joining midway on a keyframe, then checks every viewer ended up with the
+// server's model.
+int RunSpectatorBench(int argc, char** argv) {
+    int clients = 16;
+    float seconds = 30.0f;
+    float speed = 4.0f;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--clients") == 0 && i + 1 < argc) clients = atoi(argv[++i]);
+        if (strcmp(argv[i], "--seconds") == 0 && i + 1 < argc) seconds = (float)atof(argv[++i]);
+        if (strcmp(argv[i], "--speed") == 0 && i + 1 < argc) speed = (float)atof(argv[++i]);
+    }
+    simClock.headless = true;
+    simClock.frameTime = 1.0f / 60.0f;
+    World world(simClock.width, simClock.height, 1234);
+    world.LoadAssets();
+    world.godMode = true;
+    world.spawnRateMultiplier = 3.0f;
+
+    SpectatorServer server;
+    string error;
+    if (!server.Start(0, error)) {
+        cerr << "Cannot start spectator server: " << error << endl;
+        return 1;
+    }
+
+    vector<SpectatorModel> models(clients);
+    atomic<bool> finished(false);
+    atomic<uint32_t> lastTick(0);
+    vector<thread> viewers;
+    for (int c = 0; c < clients; c++) {
+        viewers.emplace_back([&, c] {
+            if (c >= clients / 2) this_thread::sleep_for(chrono::duration<double>(seconds / speed / 2));
+            SpectatorClient client;
+            string err;
+            if (!client.Connect("127.0.0.1", server.Port(), err)) return;
+            auto deadline = chrono::steady_clock::now() + chrono::duration<double>(seconds / speed + 10.0);
+            while (chrono::steady_clock::now() < deadline && client.Poll(models[c]) >= 0) {
+                if (finished && models[c].synced && models[c].tick == lastTick) break;
+                this_thread::sleep_for(chrono::milliseconds(1));
+            }
+        });
+    }
+    auto waitStart = chrono::steady_clock::now();
+    while (server.Metrics().clients < clients / 2 && chrono::steady_clock::now() - waitStart < chrono::seconds(5)) {
+        this_thread::sleep_for(chrono::milliseconds(1));
+    }
+
+    SpectatorFeed feed;
+    int ticks = (int)(seconds * 60.0f);
+    auto began = chrono::steady_clock::now();
+    for (int t = 0; t < ticks; t++) {
+        if (sinf(t * 0.02f) > 0.0f) {
+            world.flyCommand.execute();
+        } else {
+            world.fallCommand.execute();
+        }
+        if (t % 8 == 0) world.shootCommand.execute();
+        world.Update();
+        feed.Publish(world, server, simClock.frameTime);
+        this_thread::sleep_until(began + chrono::duration<double>((t + 1) / 60.0 / speed));
+    }
+    lastTick = feed.encoder.model.tick;
+    finished = true;
+    for (thread& viewer : viewers) viewer.join();
+    SpectatorServerMetrics m = server.Metrics();
+    server.Stop();
+
+    int matched = 0;
+    uint64_t expected = feed.encoder.model.Hash();
+    for (const SpectatorModel& model : models) matched += model.synced && model.Hash() == expected;
+    printf("%d ticks at %.0fx real time, %d viewers, %zu entities at the end\n",
+           ticks, speed, clients, feed.encoder.model.entities.size());
+    printf("  frame        mean %.0f bytes  max %zu bytes  (sending every position: %.0f bytes)\n",
+           (double)feed.bytesSum / feed.frames, feed.bytesMax, (double)feed.snapshotBytesSum / feed.frames);
+    printf("  encode       mean %.2f us  max %.2f us per tick, %ld drift corrections\n",
+           feed.encodeMsSum * 1000.0 / feed.frames, feed.encodeMsMax * 1000.0, feed.moves);
+    printf("  fan-out      %ld frames, %.2f MB sent, %.1f KB/s per viewer of game time\n",
+           m.framesSent, m.bytesSent / 1e6, m.bytesSent / 1024.0 / clients / seconds);
+    printf("  viewers      %d of %d match the server model, %ld dropped, %ld frames dropped\n",
+           matched, clients, m.clientsDropped, m.framesDropped);
+    return matched == clients ? 0 : 1;
+}
+
+// ./game --coop --player 0|1 [--host 127.0.0.1] [--port 7070] [--seed N] [--autopilot]
+// Player p listens on port + p and sends to port + 1 - p. The game starts
+// once the two have heard each other, and both must use the same seed.
+static const int COOP_PORT = 7070;
+
+uint8_t CoopInput(const FixedSim& sim, int player, bool autopilot) {
+    if (autopilot) return AimingSimInput(sim, player);
+    uint8_t input = IsMouseButtonDown(MOUSE_BUTTON_LEFT) ? SIM_FLY : 0;
+    if (IsKeyPressed(KEY_E)) input |= SIM_SHOOT;
+    return input;
+}
+
+int RunCoop(int argc, char** argv) {
+    const char* host = "127.0.0.1";
+    int port = COOP_PORT;
+    int player = 0;
+    uint64_t seed = 1234;
+    bool autopilot = false;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--host") == 0 && i + 1 < argc) host = argv[++i];
+        if (strcmp(argv[i], "--port") == 0 && i + 1 < argc) port = atoi(argv[++i]);
+        if (strcmp(argv[i], "--player") == 0 && i + 1 < argc) player = atoi(argv[++i]) == 1;
+        if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) seed = strtoull(argv[++i], nullptr, 10);
+        if (strcmp(argv[i], "--autopilot") == 0) autopilot = true;
+    }
+    UdpLink link;
+    string error;
+    bool loopback = strncmp(host, "127.", 4) == 0;
+    if (!link.Open(port + player, loopback, error) || !link.SetPeer(host, port + 1 - player, error)) {
+        cerr << "Cannot open co-op link on port " << port + player << ": " << error << endl;
+        return 1;
+    }
+    RollbackSession session(SimParams(), seed, STREAM_SIM, player);
+    const FixedSim& sim = session.sim;
+    vector<uint8_t> packet;
+    uint8_t datagram[512];
+    uint8_t shot = 0;  // an E press waits for the next tick that is played
+    int heldFrames = 0;
+
+    InitWindow(1280, 720, TextFormat("GARUDA PANCASILA - player %d", player + 1));
+    SetTargetFPS(60);
+    while (!WindowShouldClose()) {
+        for (int n; (n = link.Receive(datagram, sizeof(datagram))) >= 0;) session.ReadPacket(datagram, n);
+        if (session.Heard()) {
+            uint8_t input = CoopInput(sim, player, autopilot);
+            shot |= input & SIM_SHOOT;
+            bool played = session.Advance(input | shot);
+            if (played) shot = 0;
+            heldFrames = played || sim.state.dead ? 0 : heldFrames + 1;
+        }
+        session.WritePacket(packet);
+        link.Send(packet);
+
+        BeginDrawing();
+        ClearBackground(BLACK);
+        const float shipX = (float)sim.params.shipX;
+        const float shipW = FixedMath::ToFloat(sim.ShipWidth());
+        const float shipH = FixedMath::ToFloat(sim.ShipHeight());
+        for (const SimObstacle<Fix>& o : sim.state.obstacles) {
+            Rectangle rec = {FixedMath::ToFloat(o.x), FixedMath::ToFloat(o.y), FixedMath::ToFloat(o.w), FixedMath::ToFloat(o.h)};
+            DrawRectangleLinesEx(rec, 2.0f, KIND_COLORS[o.kind]);
+        }
+        for (const SimBullet<Fix>& b : sim.state.bullets) {
+            DrawCircleV({FixedMath::ToFloat(b.x), FixedMath::ToFloat(b.y)}, (float)sim.params.bulletRadius, WHITE);
+        }
+        for (int p = 0; p < SIM_PLAYERS; p++) {
+            const SimShip<Fix>& ship = sim.state.ships[p];
+            Color color = ship.dead ? DARKGRAY : p == player ? RAYWHITE : SKYBLUE;
+            DrawRectangleRec({shipX, FixedMath::ToFloat(ship.y), shipW, shipH}, color);
+            DrawText(TextFormat("P%d", p + 1), (int)(shipX + shipW + 4), (int)FixedMath::ToFloat(ship.y), 10, color);
+        }
+        const RollbackMetrics& m = session.Metrics();
+        DrawText(TextFormat("SCORE: %d", sim.state.score), 10, 10, 20, WHITE);
+        DrawText(TextFormat("P1 %ld kills  P2 %ld kills", sim.state.ships[0].kills, sim.state.ships[1].kills), 10, 34, 10,
+                 LIGHTGRAY);
+        DrawText(TextFormat("tick %llu  confirmed %llu  rollback %d ticks in %.2f ms (max %d, %.2f ms)  held %ld  "
+                            "desyncs %ld of %ld",
+                            (unsigned long long)sim.state.tick, (unsigned long long)session.Confirmed(), m.lastDepth,
+                            m.lastResimMs, m.maxDepth, m.maxResimMs, m.held, m.desyncs, m.syncsChecked),
+                 10, 48, 10, LIGHTGRAY);
+        if (!session.Heard() || heldFrames > 60) {
+            const char* text = TextFormat("WAITING FOR PLAYER %d...", 2 - player);
+            DrawText(text, 640 - MeasureText(text, 30) / 2, 345, 30, WHITE);
+        } else if (sim.state.dead) {
+            DrawText("GAME OVER", 640 - MeasureText("GAME OVER", 50) / 2, 340, 50, PINK);
+        }
+        EndDrawing();
+    }
+    CloseWindow();
+    const RollbackMetrics& m = session.Metrics();
+    TraceLog(LOG_INFO, "COOP: %ld ticks, %ld rollbacks, max %d ticks in %.2f ms, %ld of %ld syncs differed",
+             m.ticks, m.rollbacks, m.maxDepth, m.maxResimMs, m.desyncs, m.syncsChecked);
+    return m.desyncs == 0 ? 0 : 1;
+}
+
+// ./game --rollback-bench [--ticks 3600] [--delay 6] [--jitter 4] [--loss 10] [--late 45] [--spawn-rate 1] [--seed N]
+// Two sessions in this process play co-op against each other over UDP on
+// loopback, each steered by the aiming bot on what it sees. Packets are held
+// --delay frames plus up to --jitter more, which also reorders them, and
+// --loss percent are dropped. Player 2 starts --late frames after player 1.
+// Once every input has arrived, both must hold the state a plain FixedSim
+// reaches by playing the two recorded input streams. --spawn-rate multiplies
+// every kind's spawns, for heavier states to save and replay.
+int RunRollbackBench(int argc, char** argv) {
+    int ticks = 3600;
+    int delay = 6;
+    int jitter = 4;
+    int loss = 10;
+    int late = 45;
+    int spawnRate = 1;
+    uint64_t seed = 1234;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--ticks") == 0 && i + 1 < argc) ticks = atoi(argv[++i]);
+        if (strcmp(argv[i], "--delay") == 0 && i + 1 < argc) delay = atoi(argv[++i]);
+        if (strcmp(argv[i], "--jitter") == 0 && i + 1 < argc) jitter = atoi(argv[++i]);
+        if (strcmp(argv[i], "--loss") == 0 && i + 1 < argc) loss = atoi(argv[++i]);
+        if (strcmp(argv[i], "--late") == 0 && i + 1 < argc) late = atoi(argv[++i]);
+        if (strcmp(argv[i], "--spawn-rate") == 0 && i + 1 < argc) spawnRate = max(1, atoi(argv[++i]));
+        if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) seed = strtoull(argv[++i], nullptr, 10);
+    }
+    SimParams params;
+    params.godMode = true;
+    for (SimKind& kind : params.kinds) kind.interval = max(1, kind.interval / spawnRate);
+
+    struct Delayed {
+        long deliverAt;
+        vector<uint8_t> bytes;
+    };
+    struct Peer {
+        RollbackSession session;
+        UdpLink link;
+        vector<Delayed> inbox;
+        vector<uint8_t> inputs;  // played, by tick
+        vector<double> replayMs; // frames that rolled back
+        Peer(const SimParams& params, uint64_t seed, int player) : session(params, seed, STREAM_SIM, player) {}
+    };
+    Peer a(params, seed, 0), b(params, seed, 1);
+    Peer* peers[2] = {&a, &b};
+    string error;
+    for (Peer* p : peers) {
+        if (!p->link.Open(0, true, error)) {
+            cerr << "Cannot open UDP socket: " << error << endl;
+            return 1;
+        }
+    }
+    a.link.SetPeer("127.0.0.1", b.link.Port(), error);
+    b.link.SetPeer("127.0.0.1", a.link.Port(), error);
+
+    RandomStream network(seed, 0);
+    vector<uint8_t> packet;
+    uint8_t datagram[512];
+    long frame = 0;
+    const long lastFrame = late + ticks * 4L + 1000;
+    auto done = [&](Peer& p) { return p.session.Tick() == (uint64_t)ticks && p.session.Confirmed() == (uint64_t)ticks; };
+    for (; frame < lastFrame && !(done(a) && done(b)); frame++) {
+        for (int i = 0; i < 2; i++) {
+            Peer& p = *peers[i];
+            if (i == 1 && frame < late) {
+                // Not started yet: whatever arrives is lost.
+                while (p.link.Receive(datagram, sizeof(datagram)) >= 0) {}
+                continue;
+            }
+            for (int n; (n = p.link.Receive(datagram, sizeof(datagram))) >= 0;) {
+                if (network.Range(0, 100) < loss) continue;
+                p.inbox.push_back({frame + delay + network.Range(0, jitter + 1), vector<uint8_t>(datagram, datagram + n)});
+            }
+            for (size_t k = 0; k < p.inbox.size();) {
+                if (p.inbox[k].deliverAt > frame) {
+                    k++;
+                    continue;
+                }
+                p.session.ReadPacket(p.inbox[k].bytes.data(), p.inbox[k].bytes.size());
+                p.inbox[k] = move(p.inbox.back());
+                p.inbox.pop_back();
+            }
+            if (p.session.Tick() < (uint64_t)ticks && (i == 0 || p.session.Heard())) {
+                uint8_t input = AimingSimInput(p.session.sim, i);
+                if (p.session.Advance(input)) p.inputs.push_back(input);
+            } else {
+                p.session.Settle();
+            }
+            if (p.session.Metrics().lastDepth > 0) p.replayMs.push_back(p.session.Metrics().lastResimMs);
+            p.session.WritePacket(packet);
+            p.link.Send(packet);
+        }
+    }
+
+    FixedSim reference(params, seed, STREAM_SIM);
+    reference.params.players = SIM_PLAYERS;
+    reference.Reset(seed);
+    bool complete = (int)a.inputs.size() == ticks && (int)b.inputs.size() == ticks;
+    for (int t = 0; complete && t < ticks; t++) {
+        uint8_t inputs[SIM_PLAYERS] = {a.inputs[t], b.inputs[t]};
+        reference.Step(inputs);
+    }
+
+    // A state copy is what each saved tick costs.
+    SimState<FixedMath> copy = a.session.sim.state;
+    const int copies = 20000;
+    auto start = chrono::steady_clock::now();
+    for (int i = 0; i < copies; i++) {
+        copy = a.session.sim.state;
+        copy.tick += i;
+    }
+    double copyUs = chrono::duration<double, micro>(chrono::steady_clock::now() - start).count() / copies;
+
+    printf("%d ticks, packets held %d+%d frames, %d%% lost, player 2 joins %d frames late, %ld frames\n", ticks, delay,
+           jitter, loss, late, frame);
+    bool ok = complete;
+    for (int i = 0; i < 2; i++) {
+        Peer& p = *peers[i];
+        const RollbackMetrics& m = p.session.Metrics();
+        int depth[3] = {0, 0, m.maxDepth};
+        long seen = 0;
+        for (int d = 0; d <= ROLLBACK_WINDOW; d++) {
+            seen += m.depthCounts[d];
+            if (depth[0] == 0 && seen * 2 >= m.rollbacks) depth[0] = d;
+            if (depth[1] == 0 && seen * 100 >= m.rollbacks * 99) depth[1] = d;
+        }
+        sort(p.replayMs.begin(), p.replayMs.end());
+        auto at = [&](double q) { return p.replayMs.empty() ? 0.0 : p.replayMs[min(p.replayMs.size() - 1, (size_t)(q * p.replayMs.size()))]; };
+        printf("  player %d     %ld rollbacks, depth p50 %d  p99 %d  max %d ticks\n", i + 1, m.rollbacks, depth[0], depth[1],
+               depth[2]);
+        printf("               replay p50 %.3f ms  p99 %.3f  max %.3f per frame, %.2f us per tick replayed\n", at(0.5),
+               at(0.99), m.maxResimMs, m.resimTicks ? m.resimMsSum * 1000.0 / m.resimTicks : 0.0);
+        printf("               %ld frames held, %ld packets in (%ld bad), %ld syncs checked, %ld differed\n", m.held,
+               m.packetsIn, m.badPackets, m.syncsChecked, m.desyncs);
+        ok = ok && m.desyncs == 0 && m.syncsChecked > 0 && m.badPackets == 0;
+    }
+    printf("  save         %.2f us per state (%zu obstacles, %zu bullets)\n", copyUs, copy.obstacles.size(),
+           copy.bullets.size());
+    uint64_t expected = reference.Hash();
+    for (int i = 0; i < 2; i++) {
+        uint64_t got = peers[i]->session.sim.Hash();
+        ok = ok && got == expected;
+        printf("  player %d     %016llx  %s\n", i + 1, (unsigned long long)got,
+               !complete ? "INCOMPLETE" : got == expected ? "matches the replay" : "DIFFERS from the replay");
+    }
+    return ok ? 0 : 1;
+}
+
+// Brute-force versions of the index queries, for checking and timing.
+int NearestByScan(const SpatialIndex& index, float px, float py) {
+    float best = INFINITY;
+    int bestItem = -1;
+    for (int i = 0; i < index.Count(); i++) {
+        const SpatialItem& item = index.Item(i);
+        float dx = fmaxf(fmaxf(item.minX - px, px - item.maxX), 0.0f);
+        float dy = fmaxf(fmaxf(item.minY - py, py - item.maxY), 0.0f);
+        float d = dx * dx + dy * dy;
+        if (d < best) {
+            best = d;
+            bestItem = i;
+        }
+    }
+    return bestItem;
+}
+
+void RayCastByScan(const SpatialIndex& index, float x0, float y0, float y1, vector<SpatialHit>& out) {
+    out.clear();
+    for (int i = 0; i < index.Count(); i++) {
+        const SpatialItem& item = index.Item(i);
+        if (item.maxX <= x0 || item.maxY <= y0 || item.minY >= y1) continue;
+        out.push_back({i, fmaxf(0.0f, item.minX - x0)});
+    }
+    sort(out.begin(), out.end(), [](const SpatialHit& a, const SpatialHit& b) {
+        return a.distance < b.distance || (a.distance == b.distance && a.item < b.item);
+    });
+}
+
+// Random obstacle-sized boxes over (and just off) the field; times nearest
+// and ray queries against a linear scan of every box and checks they agree.
+int RunSpatialBench(int argc, char** argv) {
+    int obstacles = 2000;
+    int missiles = 500;
+    int repeat = 20;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--obstacles") == 0 && i + 1 < argc) obstacles = atoi(argv[++i]);
+        if (strcmp(argv[i], "--missiles") == 0 && i + 1 < argc) missiles = atoi(argv[++i]);
+        if (strcmp(argv[i], "--repeat") == 0 && i + 1 < argc) repeat = atoi(argv[++i]);
+    }
+    const float width = 1280.0f;
+    const float height = 720.0f;
+    RandomStream rng(11, 0);
+
+    SpatialIndex index;
+    auto start = chrono::steady_clock::now();
+    for (int r = 0; r < repeat; r++) {
+        RandomStream boxes(11, 1);
+        index.Clear();
+        for (int i = 0; i < obstacles; i++) {
+            float size = (float)boxes.Range(20, 120);
+            index.Add((float)boxes.Range(-100, (int)width + 100), (float)boxes.Range(-60, (int)height + 20), size, size, i % KIND_COUNT, i);
+        }
+        index.Build(height);
+    }
+    double buildMs = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count() / repeat;
+
+    vector<Vector2> points(missiles);
+    for (Vector2& p : points) p = {(float)rng.Range(0, (int)width), (float)rng.Range(0, (int)height)};
+
+    vector<int> scanned(missiles), indexed(missiles);
+    start = chrono::steady_clock::now();
+    for (int r = 0; r < repeat; r++) {
+        for (int i = 0; i < missiles; i++) scanned[i] = NearestByScan(index, points[i].x, points[i].y);
+    }
+    double scanMs = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+    start = chrono::steady_clock::now();
+    for (int r = 0; r < repeat; r++) {
+        for (int i = 0; i < missiles; i++) indexed[i] = index.Nearest(points[i].x, points[i].y);
+    }
+    double indexMs = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+    bool match = scanned == indexed;
+
+    long queries = (long)missiles * repeat;
+    printf("%d obstacles, %d missiles, %d repeats; index build %.3f ms\n", obstacles, missiles, repeat, buildMs);
+    printf("  nearest  scan %8.2f ms  index %8.2f ms  %9.0f queries/ms  %5.1fx\n",
+           scanMs, indexMs, queries / indexMs, scanMs / indexMs);
+
+    vector<SpatialHit> expected, actual;
+    const int rays = 200;
+    scanMs = indexMs = 0.0;
+    for (int r = 0; r < rays; r++) {
+        float y = (float)rng.Range(0, (int)height);
+        float x = (float)rng.Range(0, (int)width / 2);
+        start = chrono::steady_clock::now();
+        RayCastByScan(index, x, y - 3.0f, y + 3.0f, expected);
+        auto mid = chrono::steady_clock::now();
+        index.RayCastRight(x, y - 3.0f, y + 3.0f, actual);
+        auto end = chrono::steady_clock::now();
+        scanMs += chrono::duration<double, milli>(mid - start).count();
+        indexMs += chrono::duration<double, milli>(end - mid).count();
+        if (expected.size() != actual.size()) {
+            match = false;
+            continue;
+        }
+        for (size_t i = 0; i < expected.size(); i++) {
+            if (expected[i].item != actual[i].item) match = false;
+        }
+    }
+    printf("  raycast  scan %8.2f ms  index %8.2f ms  %9.0f queries/ms  %5.1fx\n",
+           scanMs, indexMs, rays / indexMs, scanMs / indexMs);
+    printf("results %s\n", match ? "match" : "DIFFER");
+    return match ? 0 : 1;
+}
+
+// Scripted sequence of cues used for the golden check: a burst of fire, hits
+// panned across the field, a miss and the game over sting.
+void PlayAudioScript(AudioMixer& mixer, int block, int16_t* out) {
+    if (block % 10 == 0) mixer.Play(SOUND_SHOT, 0.6f, -0.8f);
+    if (block % 25 == 3) mixer.Play(SOUND_HIT, 1.0f, (block % 50) / 25.0f - 1.0f);
+    if (block == 200) mixer.Play(SOUND_MISS, 0.8f, -1.0f);
+    if (block == 400) mixer.Play(SOUND_GAMEOVER, 1.0f, 0.0f);
+    mixer.Mix(out, AUDIO_BLOCK);
+}
+
+static const uint64_t AUDIO_GOLDEN_HASH = 0x1c4c6c5e08f7bac9ull;
+static const int AUDIO_GOLDEN_BLOCKS = 700;
+
+// Mixes the script once per kernel and once through the ring with a consumer
+// thread, checks all of them against the golden hash, then times the mixer
+// with a constant number of live voices.
+int RunAudioBench(int argc, char** argv) {
+    int voices = 256;
+    float seconds = 10.0f;
+    const char* writePath = nullptr;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--voices") == 0 && i + 1 < argc) voices = atoi(argv[++i]);
+        if (strcmp(argv[i], "--seconds") == 0 && i + 1 < argc) seconds = (float)atof(argv[++i]);
+        if (strcmp(argv[i], "--write") == 0 && i + 1 < argc) writePath = argv[++i];
+    }
+
+    bool ok = true;
+    vector<int16_t> golden;
+    for (int simd = 0; simd < 2; simd++) {
+        AudioMixer mixer;
+        mixer.simd = simd != 0;
+        vector<int16_t> out(AUDIO_GOLDEN_BLOCKS * AUDIO_BLOCK * 2);
+        for (int block = 0; block < AUDIO_GOLDEN_BLOCKS; block++) {
+            PlayAudioScript(mixer, block, out.data() + block * AUDIO_BLOCK * 2);
+        }
+        uint64_t hash = PackHash(out.data(), out.size() * sizeof(int16_t));
+        bool match = hash == AUDIO_GOLDEN_HASH;
+        if (!match) ok = false;
+        printf("golden %-7s %016llx (%s)\n", simd ? "simd" : "scalar", (unsigned long long)hash, match ? "match" : "MISMATCH");
+        if (simd) golden = out;
+    }
+
+    // Same script through the lock-free ring, drained by another thread in
+    // uneven chunks the way a device callback would.
+    {
+        AudioMixer mixer;
+        SpscRing<int16_t> ring(4096);
+        vector<int16_t> received;
+        received.reserve(golden.size());
+        std::atomic<bool> done(false);
+        thread consumer([&]() {
+            int16_t chunk[733 * 2];
+            while (true) {
+                bool finished = done.load(std::memory_order_acquire);
+                size_t got = ring.Pop(chunk, 733 * 2);
+                received.insert(received.end(), chunk, chunk + got);
+                if (finished && got == 0) break;
+                if (got == 0) this_thread::yield();
+            }
+        });
+        int16_t block[AUDIO_BLOCK * 2];
+        for (int b = 0; b < AUDIO_GOLDEN_BLOCKS; b++) {
+            PlayAudioScript(mixer, b, block);
+            size_t pushed = 0;
+            while (pushed < AUDIO_BLOCK * 2) {
+                pushed += ring.Push(block + pushed, AUDIO_BLOCK * 2 - pushed);
+                if (pushed < AUDIO_BLOCK * 2) this_thread::yield();
+            }
+        }
+        done.store(true, std::memory_order_release);
+        consumer.join();
+        bool match = received == golden;
+        if (!match) ok = false;
+        printf("ring handoff   %zu samples (%s)\n", received.size(), match ? "match" : "MISMATCH");
+    }
+
+    if (writePath) {
+        FILE* file = fopen(writePath, "wb");
+        if (file) {
+            fwrite(golden.data(), sizeof(int16_t), golden.size(), file);
+            fclose(file);
+            printf("wrote %s (raw s16le stereo, %d Hz)\n", writePath, AUDIO_SAMPLE_RATE);
+        }
+    }
+
+    int blocks = (int)(seconds * AUDIO_SAMPLE_RATE / AUDIO_BLOCK);
+    printf("%d live voices, %.1f s of audio\n", voices, blocks * AUDIO_BLOCK / (float)AUDIO_SAMPLE_RATE);
+    for (int simd = 0; simd < 2; simd++) {
+        AudioMixer mixer(voices);
+        mixer.simd = simd != 0;
+        RandomStream rng(9, 0);
+        vector<int16_t> out(AUDIO_BLOCK * 2);
+        double mixMs = 0.0;
+        long voiceFrames = 0;
+        for (int b = 0; b < blocks; b++) {
+            while (mixer.ActiveVoices() < voices) {
+                mixer.Play((SoundId)rng.Range(0, SOUND_COUNT - 1), 0.05f, rng.NextFloat() * 2.0f - 1.0f);
+            }
+            auto start = chrono::steady_clock::now();
+            mixer.Mix(out.data(), AUDIO_BLOCK);
+            mixMs += chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+            voiceFrames += (long)voices * AUDIO_BLOCK;
+        }
+        double audioMs = blocks * AUDIO_BLOCK * 1000.0 / AUDIO_SAMPLE_RATE;
+        printf("  %-7s %8.2f ms  %8.0f voice-frames/ms  %6.2f voice-blocks/us  %.0fx realtime\n",
+               simd ? "simd" : "scalar", mixMs, voiceFrames / mixMs, voiceFrames / (double)AUDIO_BLOCK / (mixMs * 1000.0),
+               audioMs / mixMs);
+    }
+    return ok ? 0 : 1;
+}
+
+// Keeps a particle system topped up at a fixed live count and times the update
+// (scalar, SIMD, SIMD split across threads) and the draw list per frame.
+int RunParticleBench(int argc, char** argv) {
+    int live = 100000;
+    int frames = 300;
+    int threads = 0;
+    float budgetMs = 2.0f;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--particles") == 0 && i + 1 < argc) live = atoi(argv[++i]);
+        if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc) frames = atoi(argv[++i]);
+        if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) threads = atoi(argv[++i]);
+        if (strcmp(argv[i], "--budget") == 0 && i + 1 < argc) budgetMs = (float)atof(argv[++i]);
+    }
+    const int width = 1280;
+    const int height = 720;
+    const float dt = 1.0f / 60.0f;
+    ThreadPool pool(threads);
+
+    struct Variant {
+        const char* name;
+        bool simd;
+        ThreadPool* pool;
+    };
+    const Variant variants[] = {
+        {"scalar", false, nullptr},
+        {"simd", true, nullptr},
+        {"simd + threads", true, &pool},
+    };
+
+    printf("%d live particles, %d frames, %d pool threads\n", live, frames, pool.Size());
+    bool withinBudget = false;
+    for (const Variant& variant : variants) {
+        ParticleSystem particles(live + 4096);
+        particles.simd = variant.simd;
+        RandomStream rng(7, STREAM_EFFECTS);
+        vector<ParticleQuad> quads;
+        double updateMs = 0.0;
+        double drawMs = 0.0;
+        long updated = 0;
+        long drawn = 0;
+        for (int frame = 0; frame < frames; frame++) {
+            // Refill with bursts spread over the field, as a heavy fight would.
+            while (particles.Count() < live) {
+                ParticleBurst burst = {(float)rng.Range(0, width), (float)rng.Range(0, height), 64,
+                                       60.0f, 260.0f, 0.4f, 1.1f, 2.0f, 5.0f, GOLD};
+                particles.Emit(burst, rng);
+            }
+            updated += particles.Count();
+            auto start = chrono::steady_clock::now();
+            particles.Update(dt, variant.pool);
+            auto mid = chrono::steady_clock::now();
+            particles.BuildDrawList(quads, width, height);
+            auto end = chrono::steady_clock::now();
+            updateMs += chrono::duration<double, milli>(mid - start).count();
+            drawMs += chrono::duration<double, milli>(end - mid).count();
+            drawn += particles.Count();
+        }
+        double frameMs = (updateMs + drawMs) / frames;
+        if (frameMs <= budgetMs) withinBudget = true;
+        printf("  %-16s update %7.3f ms/frame %9.0f particles/ms   draw list %7.3f ms/frame %9.0f particles/ms   %s\n",
+               variant.name, updateMs / frames, updated / updateMs, drawMs / frames, drawn / drawMs,
+               frameMs <= budgetMs ? "within budget" : "over budget");
+    }
+    printf("budget %.2f ms: %s\n", budgetMs, withinBudget ? "HELD" : "MISSED");
+    return withinBudget ? 0 : 1;
+}
+
+// Decodes every asset once on the main thread, once through the loader and,
+// if a pack exists, once more through the loader reading the pack.
+int RunAssetBench(int argc, char** argv) {
+    int threads = 0;
+    int rounds = 5;
+    const char* packPath = DEFAULT_ASSET_PACK;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) threads = atoi(argv[++i]);
+        if (strcmp(argv[i], "--rounds") == 0 && i + 1 < argc) rounds = atoi(argv[++i]);
+        if (strcmp(argv[i], "--pack") == 0 && i + 1 < argc) packPath = argv[++i];
+    }
+    const char* const* paths = ASSET_PATHS;
+    const int count = ASSET_COUNT;
+
+    double sequentialMs = 0.0;
+    double parallelMs = 0.0;
+    double firstMs = 0.0;
+    int poolSize = 0;
+    for (int round = 0; round < rounds; round++) {
+        auto start = chrono::steady_clock::now();
+        for (int i = 0; i < count; i++) {
+            Image image = LoadImage(paths[i]);
+            if (image.data == nullptr) {
+                cerr << "Failed to load " << paths[i] << "!" << endl;
+                return 1;
+            }
+            UnloadImage(image);
+        }
+        sequentialMs += chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+
+        start = chrono::steady_clock::now();
+        AssetLoader loader(threads);
+        poolSize = loader.Threads();
+        for (int i = 0; i < count; i++) loader.Request(paths[i]);
+        DecodedAsset asset;
+        bool first = true;
+        while (loader.Wait(asset)) {
+            if (first) {
+                firstMs += chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+                first = false;
+            }
+            UnloadImage(asset.image);
+        }
+        parallelMs += chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+    }
+
+    printf("%d assets, %d rounds, %d decode threads\n", count, rounds, poolSize);
+    printf("  sequential decode   %8.2f ms\n", sequentialMs / rounds);
+    printf("  parallel decode     %8.2f ms  (%.1fx)\n", parallelMs / rounds, sequentialMs / parallelMs);
+    printf("  first asset ready   %8.2f ms\n", firstMs / rounds);
+
+    double packMs = 0.0;
+    int mapped = 0;
+    string error;
+    for (int round = 0; round < rounds; round++) {
+        auto start = chrono::steady_clock::now();
+        AssetPack pack;
+        if (!pack.Open(packPath, error)) break;
+        AssetLoader loader(threads);
+        loader.UsePack(&pack);
+        for (int i = 0; i < count; i++) loader.Request(paths[i]);
+        DecodedAsset asset;
+        mapped = 0;
+        while (loader.Wait(asset)) {
+            if (asset.mapped) {
+                mapped++;
+            } else {
+                UnloadImage(asset.image);
+            }
+        }
+        packMs += chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+    }
+    if (!error.empty()) {
+        printf("  pack                not used: %s (build one with --pack-assets)\n", error.c_str());
+        return 0;
+    }
+    printf("  pack open + map     %8.2f ms  (%.1fx)  %d of %d assets mapped\n",
+           packMs / rounds, sequentialMs / packMs, mapped, count);
+
+    AssetPack pack;
+    pack.Open(packPath, error);
+    bool intact = true;
+    for (int i = 0; i < pack.Count(); i++) {
+        if (!pack.VerifyPixels(pack.Entry(i))) {
+            printf("  pixel checksum mismatch in %s\n", pack.Entry(i).path);
+            intact = false;
+        }
+    }
+    return intact ? 0 : 1;
+}
+
+// Offline packer: decodes the PNGs once and stores the pixels ready to map.
+int RunPackAssets(int argc, char** argv) {
+    const char* outPath = DEFAULT_ASSET_PACK;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--out") == 0 && i + 1 < argc) outPath = argv[++i];
+    }
+    vector<string> paths(ASSET_PATHS, ASSET_PATHS + ASSET_COUNT);
+    string error;
+    if (!AssetPack::Write(outPath, paths, error)) {
+        cerr << "Packing failed: " << error << endl;
+        return 1;
+    }
+
+    AssetPack pack;
+    if (!pack.Open(outPath, error)) {
+        cerr << "Written pack does not read back: " << error << endl;
+        return 1;
+    }
+    for (int i = 0; i < pack.Count(); i++) {
+        const PackEntry& entry = pack.Entry(i);
+        printf("%-18s %5u x %-5u %9llu bytes at %llu\n", entry.path, entry.width, entry.height,
+               (unsigned long long)entry.size, (unsigned long long)entry.offset);
+    }
+    printf("wrote %s\n", outPath);
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    auto launched = chrono::steady_clock::now();
+    PaceMode paceMode = PACE_FIXED;
+    int targetFps = 60;
+    bool paceReport = false;
+    uint64_t seed = (uint64_t)chrono::steady_clock::now().time_since_epoch().count();
+    const char* packPath = DEFAULT_ASSET_PACK;
+    bool randomSpawns = false;
+    int spectatorPort = -1;
+    bool autopilotOn = false;
+    bool idleSkip = true;
+    string leaderboardPath = DEFAULT_LEADERBOARD;
+    string tuningPath = DEFAULT_TUNING;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--stress") == 0) return RunGovernorStress(argc, argv);
+        if (strcmp(argv[i], "--pacing-bench") == 0) return RunPacingBench(argc, argv);
+        if (strcmp(argv[i], "--rng-bench") == 0) return RunRngBench(argc, argv);
+        if (strcmp(argv[i], "--narrowphase-bench") == 0) return RunNarrowphaseBench(argc, argv);
+        if (strcmp(argv[i], "--asset-bench") == 0) return RunAssetBench(argc, argv);
+        if (strcmp(argv[i], "--pack-assets") == 0) return RunPackAssets(argc, argv);
+        if (strcmp(argv[i], "--particle-bench") == 0) return RunParticleBench(argc, argv);
+        if (strcmp(argv[i], "--audio-bench") == 0) return RunAudioBench(argc, argv);
+        if (strcmp(argv[i], "--spatial-bench") == 0) return RunSpatialBench(argc, argv);
+        if (strcmp(argv[i], "--wave-bench") == 0) return RunWaveBench(argc, argv);
+        if (strcmp(argv[i], "--chunk-bench") == 0) return RunChunkBench(argc, argv);
+        if (strcmp(argv[i], "--sim-bench") == 0) return RunSimBench(argc, argv);
+        if (strcmp(argv[i], "--tune") == 0) return RunTuner(argc, argv);
+        if (strcmp(argv[i], "--autopilot-bench") == 0) return RunAutopilotBench(argc, argv);
+        if (strcmp(argv[i], "--boss-bench") == 0) return RunBossBench(argc, argv);
+        if (strcmp(argv[i], "--entity-bench") == 0) return RunEntityBench(argc, argv);
+        if (strcmp(argv[i], "--leaderboard-bench") == 0) return RunLeaderboardBench(argc, argv);
+        if (strcmp(argv[i], "--scores") == 0) return RunScores(argc, argv);
+        if (strcmp(argv[i], "--parallax-bench") == 0) return RunParallaxBench(argc, argv);
+        if (strcmp(argv[i], "--tuning-bench") == 0) return RunTuningBench(argc, argv);
+        if (strcmp(argv[i], "--spectate") == 0) return RunSpectator(argc, argv);
+        if (strcmp(argv[i], "--coop") == 0) return RunCoop(argc, argv);
+        if (strcmp(argv[i], "--rollback-bench") == 0) return RunRollbackBench(argc, argv);
+        if (strcmp(argv[i], "--spectator-bench") == 0) return RunSpectatorBench(argc, argv);
+        if (strcmp(argv[i], "--pace") == 0 && i + 1 < argc && !ParsePaceMode(argv[++i], paceMode)) {
+            cerr << "Unknown pacing mode: " << argv[i] << endl;
+            return 1;
+        }
+        if (strcmp(argv[i], "--fps") == 0 && i + 1 < argc) targetFps = atoi(argv[++i]);
+        if (strcmp(argv[i], "--pace-report") == 0) paceReport = true;
+        if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) seed = strtoull(argv[++i], nullptr, 10);
+        if (strcmp(argv[i], "--pack") == 0 && i + 1 < argc) packPath = argv[++i];
+        if (strcmp(argv[i], "--random-spawns") == 0) randomSpawns = true;
+        if (strcmp(argv[i], "--spectator-port") == 0 && i + 1 < argc) spectatorPort = atoi(argv[++i]);
+        if (strcmp(argv[i], "--autopilot") == 0) autopilotOn = true;
+        if (strcmp(argv[i], "--no-idle") == 0) idleSkip = false;
+        if (strcmp(argv[i], "--leaderboard") == 0 && i + 1 < argc) leaderboardPath = argv[++i];
+        if (strcmp(argv[i], "--no-leaderboard") == 0) leaderboardPath.clear();
+        if (strcmp(argv[i], "--tuning") == 0 && i + 1 < argc) tuningPath = argv[++i];
+        if (strcmp(argv[i], "--no-tuning") == 0) tuningPath.clear();
+    }
+
+    int screenWidth = 1280;
+    int screenHeight = 720;
+
+    InitWindow(screenWidth, screenHeight, "GARUDA PANCASILA");
+
+    // The pacer waits for the frame cap itself, so raylib must not.
+    SetTargetFPS(0);
+    FramePacer pacer(paceMode, targetFps);
+    pacer.Calibrate();
+    IdleGate idle;
+    idle.enabled = idleSkip;
+
+    // Optional: without a usable pack the PNGs are decoded as before.
+    AssetPack pack;
+    string packError;
+    if (!pack.Open(packPath, packError)) {
+        TraceLog(LOG_INFO, "ASSETS: no asset pack (%s), decoding PNGs", packError.c_str());
+    }
+
+    {
+        World world(screenWidth, screenHeight, seed);
+        world.levelChunks = !randomSpawns;
+        InputHandler inputHandler(&world.flyCommand, &world.fallCommand, &world.shootCommand,
+                                  &world.missileCommand, &world.laserCommand);
+        AutopilotInput autopilot(world, seed);
+        autopilot.enabled = autopilotOn;
+        float attractRestart = 0.0f;
+        bool showStats = false;
+
+        // Declared after the world so it stops before the mixer goes away.
+        AudioOutput audioOutput;
+        if (!audioOutput.Start(&world.audio)) {
+            TraceLog(LOG_WARNING, "AUDIO: no audio device, playing silently");
+        }
+
+        SpectatorServer spectators;
+        SpectatorFeed spectatorFeed;
+        string spectatorError;
+        if (spectatorPort >= 0) {
+            if (spectators.Start(spectatorPort, spectatorError)) {
+                TraceLog(LOG_INFO, "SPECTATE: streaming on 127.0.0.1:%d", spectators.Port());
+            } else {
+                TraceLog(LOG_WARNING, "SPECTATE: cannot listen on port %d: %s", spectatorPort, spectatorError.c_str());
+            }
+        }
+
+        LeaderboardStore leaderboard;
+        string leaderboardError;
+        if (!leaderboardPath.empty()) {
+            if (leaderboard.Open(leaderboardPath, leaderboardError)) {
+                LeaderboardMetrics m = leaderboard.Metrics();
+                TraceLog(LOG_INFO, "LEADERBOARD: %ld runs, %ld replayed from the log%s", leaderboard.Index().Runs(),
+                         m.recovered, m.tornTail ? ", dropped a torn last record" : "");
+            } else {
+                TraceLog(LOG_WARNING, "LEADERBOARD: %s, runs are not recorded", leaderboardError.c_str());
+            }
+        }
+
+        TuningWatcher tuning;
+        string tuningError;
+        if (!tuningPath.empty() && !tuning.Start(tuningPath, tuningError)) {
+            TraceLog(LOG_WARNING, "TUNING: %s, playing with the built-in values", tuningError.c_str());
+        }
+
+        // Decoding starts now and finishes while the first frames are shown.
+        AssetLoader loader;
+        if (pack.IsOpen()) loader.UsePack(&pack);
+        world.RequestAssets(loader);
+        double decodeMs = 0.0;
+        bool firstFrame = true;
+        bool loading = true;
+
+        while (!WindowShouldClose()) {
+            // The last frame drawn is still what the screen should show, so
+            // wait for input instead of drawing it again.
+            bool woke = false;
+            if (idle.Settled()) {
+                woke = idle.Wait(WaitInputEvents, [&]() {
+                    bool wanted = AnyKeyPressed() || IsMouseButtonPressed(MOUSE_BUTTON_LEFT) ||
+                                  IsMouseButtonPressed(MOUSE_BUTTON_RIGHT) || GetMouseWheelMove() != 0.0f ||
+                                  IsWindowResized() || spectators.WantsKeyframe();
+                    // Nothing to draw for: roll the input state over, so the
+                    // next wait compares against what is held now.
+                    if (!wanted) PollInputEvents();
+                    return wanted;
+                });
+                // Paused after the first wait, once the ring has played out.
+                if (!woke) {
+                    audioOutput.Pause();
+                    continue;
+                }
+                audioOutput.Resume();
+                pacer.Resume();
+                // raylib measures a frame from the previous EndDrawing, so the
+                // frame after this one would count the whole idle stretch.
+                simClock.frameTime = 1.0f / max(1, targetFps);
+                simClock.nominalFrames = 2;
+            }
+
+            pacer.BeginFrame();
+
+            // EndDrawing already polled input before the low-latency wait. Poll
+            // again so the simulation sees the freshest state, unless a key press
+            // is still pending: a second poll would swallow its edge. Waking from
+            // idle has just taken the events in.
+            if (pacer.mode == PACE_LOW_LATENCY && !woke && !AnyKeyPressed()) {
+                PollInputEvents();
+            }
+
+            if (IsKeyPressed(KEY_F1)) showStats = !showStats;
+            if (IsKeyPressed(KEY_F2)) {
+                pacer.SetMode((PaceMode)((pacer.mode + 1) % PACE_MODE_COUNT));
+                pacer.ResetStats();
+            }
+            if (IsKeyPressed(KEY_F3)) autopilot.enabled = !autopilot.enabled;
+
+            DecodedAsset asset;
+            while (loader.Poll(asset)) {
+                decodeMs += asset.decodeMs;
+                world.AcceptAsset(asset);
+                if (asset.id == world.shipAsset) {
+                    TraceLog(LOG_INFO, "STARTUP: playable after %.2f ms",
+                             chrono::duration<double, milli>(chrono::steady_clock::now() - launched).count());
+                }
+            }
+            if (loading && loader.Outstanding() == 0) {
+                loading = false;
+                TraceLog(LOG_INFO, "STARTUP: all assets ready after %.2f ms (%.2f ms of decoding on %d threads)",
+                         chrono::duration<double, milli>(chrono::steady_clock::now() - launched).count(),
+                         decodeMs, loader.Threads());
+            }
+
+            // Between ticks, so a tick never sees two sets of numbers.
+            if (tuning.Adopt(world.tuning)) world.ApplyTuning();
+
+            bool simulated = false;
+            switch (world.currentScreen) {
+                case GAMEPLAY: {
+                    if (!world.ship.Ready()) break;
+                    if (autopilot.enabled) {
+                        autopilot.handleInput();
+                    } else {
+                        inputHandler.handleInput();
+                    }
+                    world.Update();
+                    simulated = true;
+                    // Attract mode games stay off the leaderboard.
+                    if (world.currentScreen == GAMEOVER && autopilot.enabled) {
+                        autopilot.EndLife();
+                        attractRestart = 2.0f;
+                    } else if (world.currentScreen == GAMEOVER) {
+                        RecordRun(leaderboard, world);
+                    }
+                } break;
+                case GAMEOVER: {
+                    world.UpdateEffects();
+                    // Attract mode starts the next game by itself.
+                    if (autopilot.enabled) attractRestart -= FrameTime();
+                    if (IsKeyPressed(KEY_R) || (autopilot.enabled && attractRestart <= 0.0f)) {
+                        world.Reset();
+                    }
+                } break;
+                default:
+                    break;
+            }
+
+            spectatorFeed.Publish(world, spectators, simulated ? FrameTime() : 0.0f);
+
+            BeginDrawing();
+            ClearBackground(BLACK);
+
+            if (world.ship.Ready()) {
+                world.Draw();
+            } else {
+                DrawText("LOADING...", screenWidth / 2 - MeasureText("LOADING...", 40) / 2, screenHeight / 2 - 20, 40, WHITE);
+            }
+            if (showStats) {
+                DrawGovernorOverlay(world.governor);
+                DrawPacingOverlay(pacer);
+                if (world.levelChunks) DrawChunkOverlay(world.chunks);
+                if (spectators.Running()) DrawSpectatorOverlay(spectators, spectatorFeed);
+                DrawEventOverlay(world.eventStats);
+                if (autopilot.enabled) DrawAutopilotOverlay(autopilot);
+                DrawIdleOverlay(idle, world.TextLayouts());
+                if (leaderboard.IsOpen()) DrawLeaderboardOverlay(leaderboard);
+                DrawTuningOverlay(tuning);
+            }
+
+            if (audioOutput.Running()) audioOutput.Pump();
+
+            world.governor.Observe(pacer.WorkSoFarMs());
+
+            EndDrawing();
+            pacer.EndFrame();
+            if (simClock.nominalFrames > 0) simClock.nominalFrames--;
+
+            // Only the game over screen settles: its debris has landed, its
+            // sounds have finished and nothing restarts the game by itself.
+            idle.Drawn(world.currentScreen == GAMEOVER && !loading && !autopilot.enabled &&
+                       world.particles.Count() == 0 && world.audio.ActiveVoices() == 0);
+
+            if (firstFrame) {
+                firstFrame = false;
+                TraceLog(LOG_INFO, "STARTUP: first frame after %.2f ms",
+                         chrono::duration<double, milli>(chrono::steady_clock::now() - launched).count());
+            }
+        }
     }
 
-    for(MA* ma : mas){
-        delete ma;
+    if (paceReport) {
+        pacer.Report(stdout);
+        printf("idle: %ld frames skipped, %.1f s asleep, %ld polls, %ld wakes\n", idle.Skipped(),
+               idle.IdleMs() / 1000.0, idle.Polls(), idle.Wakes());
     }
 
     CloseWindow();
@@ -0,0 +1,220 @@
+#ifndef NARROWPHASE_H
+#define NARROWPHASE_H
+
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define NARROWPHASE_X86 1
+#include <immintrin.h>
+#endif
+
+//#####################
+//Narrowphase
+//#####################
+// Boxes are packed as four float arrays (min/max corners) so one obstacle can
+// be tested against 16 of them per call. The overlap test is the same strict
+// comparison CheckCollisionRecs does, on the same float sums, so results match
+// it bit for bit. Removed boxes get an inverted extent and never overlap.
+
+static const int NARROWPHASE_BLOCK = 16;
+
+typedef uint32_t (*OverlapKernel)(const float* minX, const float* minY, const float* maxX, const float* maxY,
+                                  float ox0, float oy0, float ox1, float oy1);
+
+inline uint32_t OverlapMaskScalar(const float* minX, const float* minY, const float* maxX, const float* maxY,
+                                  float ox0, float oy0, float ox1, float oy1) {
+    uint32_t mask = 0;
+    for (int i = 0; i < NARROWPHASE_BLOCK; i++) {
+        bool hit = (ox0 < maxX[i] && ox1 > minX[i]) && (oy0 < maxY[i] && oy1 > minY[i]);
+        mask |= (uint32_t)hit << i;
+    }
+    return mask;
+}
+
+#if defined(NARROWPHASE_X86)
+__attribute__((target("sse2")))
+inline uint32_t OverlapMaskSSE(const float* minX, const float* minY, const float* maxX, const float* maxY,
+                               float ox0, float oy0, float ox1, float oy1) {
+    const __m128 x0 = _mm_set1_ps(ox0), y0 = _mm_set1_ps(oy0);
+    const __m128 x1 = _mm_set1_ps(ox1), y1 = _mm_set1_ps(oy1);
+    uint32_t mask = 0;
+    for (int i = 0; i < NARROWPHASE_BLOCK; i += 4) {
+        __m128 hit = _mm_and_ps(
+            _mm_and_ps(_mm_cmplt_ps(x0, _mm_loadu_ps(maxX + i)), _mm_cmpgt_ps(x1, _mm_loadu_ps(minX + i))),
+            _mm_and_ps(_mm_cmplt_ps(y0, _mm_loadu_ps(maxY + i)), _mm_cmpgt_ps(y1, _mm_loadu_ps(minY + i))));
+        mask |= (uint32_t)_mm_movemask_ps(hit) << i;
+    }
+    return mask;
+}
+
+__attribute__((target("avx2")))
+inline uint32_t OverlapMaskAVX2(const float* minX, const float* minY, const float* maxX, const float* maxY,
+                                float ox0, float oy0, float ox1, float oy1) {
+    const __m256 x0 = _mm256_set1_ps(ox0), y0 = _mm256_set1_ps(oy0);
+    const __m256 x1 = _mm256_set1_ps(ox1), y1 = _mm256_set1_ps(oy1);
+    uint32_t mask = 0;
+    for (int i = 0; i < NARROWPHASE_BLOCK; i += 8) {
+        __m256 hit = _mm256_and_ps(
+            _mm256_and_ps(_mm256_cmp_ps(x0, _mm256_loadu_ps(maxX + i), _CMP_LT_OQ),
+                          _mm256_cmp_ps(x1, _mm256_loadu_ps(minX + i), _CMP_GT_OQ)),
+            _mm256_and_ps(_mm256_cmp_ps(y0, _mm256_loadu_ps(maxY + i), _CMP_LT_OQ),
+                          _mm256_cmp_ps(y1, _mm256_loadu_ps(minY + i), _CMP_GT_OQ)));
+        mask |= (uint32_t)_mm256_movemask_ps(hit) << i;
+    }
+    // The callers are SSE code; leaving the upper halves dirty costs far more
+    // than the kernel saves.
+    _mm256_zeroupper();
+    return mask;
+}
+
+__attribute__((target("avx512f")))
+inline uint32_t OverlapMaskAVX512(const float* minX, const float* minY, const float* maxX, const float* maxY,
+                                  float ox0, float oy0, float ox1, float oy1) {
+    __mmask16 hit = _mm512_cmp_ps_mask(_mm512_set1_ps(ox0), _mm512_loadu_ps(maxX), _CMP_LT_OQ);
+    hit = _mm512_mask_cmp_ps_mask(hit, _mm512_set1_ps(ox1), _mm512_loadu_ps(minX), _CMP_GT_OQ);
+    hit = _mm512_mask_cmp_ps_mask(hit, _mm512_set1_ps(oy0), _mm512_loadu_ps(maxY), _CMP_LT_OQ);
+    hit = _mm512_mask_cmp_ps_mask(hit, _mm512_set1_ps(oy1), _mm512_loadu_ps(minY), _CMP_GT_OQ);
+    _mm256_zeroupper();
+    return (uint32_t)hit;
+}
+#endif
+
+enum NarrowphaseIsa { ISA_SCALAR = 0, ISA_SSE, ISA_AVX2, ISA_AVX512, ISA_COUNT };
+
+inline const char* NarrowphaseIsaName(NarrowphaseIsa isa) {
+    switch (isa) {
+        case ISA_SCALAR: return "scalar";
+        case ISA_SSE: return "sse2";
+        case ISA_AVX2: return "avx2";
+        case ISA_AVX512: return "avx512";
+        default: return "?";
+    }
+}
+
+inline bool NarrowphaseIsaSupported(NarrowphaseIsa isa) {
+#if defined(NARROWPHASE_X86)
+    switch (isa) {
+        case ISA_SCALAR: return true;
+        case ISA_SSE: return __builtin_cpu_supports("sse2");
+        case ISA_AVX2: return __builtin_cpu_supports("avx2");
+        case ISA_AVX512: return __builtin_cpu_supports("avx512f");
+        default: return false;
+    }
+#else
+    return isa == ISA_SCALAR;
+#endif
+}
+
+inline OverlapKernel NarrowphaseKernel(NarrowphaseIsa isa) {
+#if defined(NARROWPHASE_X86)
+    switch (isa) {
+        case ISA_SSE: return OverlapMaskSSE;
+        case ISA_AVX2: return OverlapMaskAVX2;
+        case ISA_AVX512: return OverlapMaskAVX512;
+        default: break;
+    }
+#endif
+    return OverlapMaskScalar;
+}
+
+inline NarrowphaseIsa BestNarrowphaseIsa() {
+    for (int isa = ISA_COUNT - 1; isa > ISA_SCALAR; isa--) {
+        if (NarrowphaseIsaSupported((NarrowphaseIsa)isa)) return (NarrowphaseIsa)isa;
+    }
+    return ISA_SCALAR;
+}
+
+inline int LowestBit(uint32_t mask) {
+#if defined(__GNUC__)
+    return __builtin_ctz(mask);
+#else
+    int i = 0;
+    while (!(mask & 1u)) {
+        mask >>= 1;
+        i++;
+    }
+    return i;
+#endif
+}
+
+class BoxBatch {
+public:
+    BoxBatch() : count(0), kernel(NarrowphaseKernel(BestNarrowphaseIsa())) {}
+
+    void UseIsa(NarrowphaseIsa isa) {
+        kernel = NarrowphaseKernel(isa);
+    }
+
+    void Clear() {
+        count = 0;
+        minX.clear();
+        minY.clear();
+        maxX.clear();
+        maxY.clear();
+    }
+
+    int Count() const { return count; }
+
+    // Index matches the caller's own array; pass live = false for a slot that
+    // must keep its index but never overlap.
+    void Push(float x, float y, float width, float height, bool live = true) {
+        if (count % NARROWPHASE_BLOCK == 0) Grow();
+        if (live) {
+            minX[count] = x;
+            minY[count] = y;
+            maxX[count] = x + width;
+            maxY[count] = y + height;
+        } else {
+            SetDead(count);
+        }
+        count++;
+    }
+
+    void Remove(int index) {
+        SetDead(index);
+    }
+
+    // Lowest index overlapping the box, or -1. Lower index wins, like the
+    // break in a front-to-back loop.
+    int FirstOverlap(float x, float y, float width, float height) const {
+        float x1 = x + width;
+        float y1 = y + height;
+        for (int base = 0; base < count; base += NARROWPHASE_BLOCK) {
+            uint32_t mask = kernel(&minX[base], &minY[base], &maxX[base], &maxY[base], x, y, x1, y1);
+            if (mask) return base + LowestBit(mask);
+        }
+        return -1;
+    }
+
+    // Hit mask of one 16-box block starting at `base` (a multiple of 16).
+    uint32_t BlockMask(int base, float x, float y, float width, float height) const {
+        return kernel(&minX[base], &minY[base], &maxX[base], &maxY[base], x, y, x + width, y + height);
+    }
+
+private:
+    std::vector<float> minX, minY, maxX, maxY;
+    int count;
+    OverlapKernel kernel;
+
+    // Padding slots are dead, so kernels can always read whole blocks.
+    void Grow() {
+        size_t size = minX.size() + NARROWPHASE_BLOCK;
+        const float inf = std::numeric_limits<float>::infinity();
+        minX.resize(size, inf);
+        minY.resize(size, inf);
+        maxX.resize(size, -inf);
+        maxY.resize(size, -inf);
+    }
+
+    void SetDead(int index) {
+        const float inf = std::numeric_limits<float>::infinity();
+        minX[index] = inf;
+        minY[index] = inf;
+        maxX[index] = -inf;
+        maxY[index] = -inf;
+    }
+};
+
+#endif
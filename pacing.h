@@ -0,0 +1,399 @@
+#ifndef PACING_H
+#define PACING_H
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+
+//#####################
+//Frame pacing
+//#####################
+// SetTargetFPS leaves pacing to a single coarse sleep measured from the last
+// frame, which overshoots by a scheduler tick and drifts. The pacer keeps its
+// own deadline grid instead: it sleeps until a calibrated margin before the
+// deadline and spins the rest of the way.
+
+enum PaceMode {
+    PACE_UNCAPPED = 0,  // never wait
+    PACE_SLEEP,         // one coarse sleep for the rest of the frame, like SetTargetFPS
+    PACE_FIXED,         // coarse sleep + calibrated spin up to a fixed deadline grid
+    PACE_LOW_LATENCY,   // wait first, then simulate as late as possible before present
+    PACE_MODE_COUNT
+};
+
+inline const char* PaceModeName(PaceMode mode) {
+    switch (mode) {
+        case PACE_UNCAPPED: return "uncapped";
+        case PACE_SLEEP: return "sleep";
+        case PACE_FIXED: return "fixed";
+        case PACE_LOW_LATENCY: return "lowlatency";
+        default: return "?";
+    }
+}
+
+inline bool ParsePaceMode(const char* name, PaceMode& mode) {
+    for (int i = 0; i < PACE_MODE_COUNT; i++) {
+        if (std::string(name) == PaceModeName((PaceMode)i)) {
+            mode = (PaceMode)i;
+            return true;
+        }
+    }
+    return false;
+}
+
+// Fixed-bucket histogram in milliseconds. Samples outside the range land in
+// the edge buckets; mean and variance are tracked exactly alongside.
+class Histogram {
+public:
+    Histogram(float lowMs, float highMs, int buckets)
+        : lowMs(lowMs), highMs(highMs), counts(buckets, 0) {
+        Reset();
+    }
+
+    void Reset() {
+        std::fill(counts.begin(), counts.end(), 0);
+        count = 0;
+        mean = 0.0;
+        m2 = 0.0;
+        minMs = 0.0f;
+        maxMs = 0.0f;
+    }
+
+    void Add(float ms) {
+        int bucket = (int)((ms - lowMs) / (highMs - lowMs) * counts.size());
+        bucket = std::max(0, std::min((int)counts.size() - 1, bucket));
+        counts[bucket]++;
+
+        if (count == 0 || ms < minMs) minMs = ms;
+        if (count == 0 || ms > maxMs) maxMs = ms;
+        count++;
+        double delta = ms - mean;
+        mean += delta / count;
+        m2 += delta * (ms - mean);
+    }
+
+    long Count() const { return count; }
+    double Mean() const { return mean; }
+    double Variance() const { return count > 1 ? m2 / (count - 1) : 0.0; }
+    double StdDev() const { return std::sqrt(Variance()); }
+    float Min() const { return minMs; }
+    float Max() const { return maxMs; }
+
+    float Percentile(float p) const {
+        if (count == 0) return 0.0f;
+        long target = (long)std::ceil(p * count);
+        long seen = 0;
+        float width = (highMs - lowMs) / counts.size();
+        for (size_t i = 0; i < counts.size(); i++) {
+            seen += counts[i];
+            if (seen >= target) return lowMs + (i + 1) * width;
+        }
+        return highMs;
+    }
+
+    void Report(FILE* out, const char* name) const {
+        fprintf(out, "%-9s n=%-6ld mean %7.3f  sd %6.3f  min %7.3f  p50 %7.3f  p99 %7.3f  p99.9 %7.3f  max %7.3f ms\n",
+                name, count, mean, StdDev(), minMs, Percentile(0.5f), Percentile(0.99f), Percentile(0.999f), maxMs);
+    }
+
+    // Coarse bar chart, one row per non-empty group of buckets.
+    void Plot(FILE* out, const char* name, int rows = 20) const {
+        fprintf(out, "%s\n", name);
+        int perRow = std::max(1, (int)counts.size() / rows);
+        long peak = 1;
+        for (size_t i = 0; i < counts.size(); i += perRow) {
+            long sum = 0;
+            for (size_t j = i; j < std::min(counts.size(), i + perRow); j++) sum += counts[j];
+            peak = std::max(peak, sum);
+        }
+        float width = (highMs - lowMs) / counts.size();
+        for (size_t i = 0; i < counts.size(); i += perRow) {
+            long sum = 0;
+            for (size_t j = i; j < std::min(counts.size(), i + perRow); j++) sum += counts[j];
+            if (sum == 0) continue;
+            int bar = (int)(50 * sum / peak);
+            fprintf(out, "  %7.2f ms %7ld |%s\n", lowMs + i * width, sum, std::string(std::max(bar, 1), '#').c_str());
+        }
+    }
+
+private:
+    float lowMs;
+    float highMs;
+    std::vector<long> counts;
+    long count;
+    double mean;
+    double m2;
+    float minMs;
+    float maxMs;
+};
+
+class FramePacer {
+public:
+    typedef std::chrono::steady_clock Clock;
+
+    PaceMode mode;
+    double periodMs;
+
+    Histogram work;      // frame start (or sim start) to present
+    Histogram wait;      // time spent sleeping/spinning per frame
+    Histogram error;     // actual wake/present time minus the deadline
+    Histogram interval;  // time between successive frame boundaries
+
+    FramePacer(PaceMode mode = PACE_FIXED, int targetFps = 60)
+        : mode(mode), periodMs(1000.0 / targetFps),
+          work(0.0f, 50.0f, 500), wait(0.0f, 50.0f, 500),
+          error(-10.0f, 10.0f, 400), interval(0.0f, 50.0f, 500),
+          spinMarginMs(1.0), oversleepEwmaMs(0.0), oversleepPeakMs(0.0),
+          started(false), sleepCalls(0), spinIterations(0) {}
+
+    void SetTargetFps(int fps) {
+        periodMs = fps > 0 ? 1000.0 / fps : 0.0;
+        started = false;
+    }
+
+    void SetMode(PaceMode newMode) {
+        mode = newMode;
+        started = false;
+    }
+
+    // After the loop has stopped drawing for a while: start a new grid
+    // instead of counting the pause as one long frame.
+    void Resume() {
+        started = false;
+    }
+
+    void ResetStats() {
+        work.Reset();
+        wait.Reset();
+        error.Reset();
+        interval.Reset();
+    }
+
+    // Measures how far past the requested time a short sleep wakes up, so the
+    // spin margin starts out right for this machine.
+    void Calibrate(int samples = 20) {
+        for (int i = 0; i < samples; i++) {
+            Clock::time_point before = Clock::now();
+            std::this_thread::sleep_for(std::chrono::microseconds(1000));
+            NoteOversleep(Ms(Clock::now() - before) - 1.0);
+        }
+    }
+
+    double SpinMarginMs() const { return spinMarginMs; }
+    double PredictedWorkMs() const { return predictedWorkMs; }
+
+    // Call at the top of the loop. Low-latency mode waits here so that the
+    // simulation starts as late as the predicted work time allows.
+    void BeginFrame() {
+        Clock::time_point now = Clock::now();
+        if (!started) {
+            started = true;
+            deadline = now;
+            lastBoundary = now;
+            workCount = 0;
+            workNext = 0;
+            predictedWorkMs = periodMs * 0.5;
+        }
+
+        double waitedMs = 0.0;
+        if (mode == PACE_LOW_LATENCY && periodMs > 0.0) {
+            // deadline is the next present; leave room for the predicted work.
+            Clock::time_point simStart = deadline - Dur(predictedWorkMs + safetyMs);
+            if (simStart > now) {
+                waitedMs = WaitUntil(simStart);
+                now = Clock::now();
+            }
+        }
+        frameStart = now;
+        pendingWaitMs = waitedMs;
+    }
+
+    // Milliseconds of work since BeginFrame returned.
+    float WorkSoFarMs() const {
+        return (float)Ms(Clock::now() - frameStart);
+    }
+
+    // Call right after the frame is presented.
+    void EndFrame() {
+        Clock::time_point presented = Clock::now();
+        double workMs = Ms(presented - frameStart);
+        work.Add((float)workMs);
+        NoteWork(workMs);
+
+        double waitedMs = pendingWaitMs;
+        Clock::time_point boundary = presented;
+
+        if (periodMs > 0.0) {
+            switch (mode) {
+                case PACE_UNCAPPED:
+                    break;
+                case PACE_SLEEP: {
+                    // Same shape as raylib's wait: sleep off what is left of this frame.
+                    double remaining = periodMs - Ms(presented - lastBoundary);
+                    if (remaining > 0.0) {
+                        std::this_thread::sleep_for(Dur(remaining));
+                        sleepCalls++;
+                    }
+                    boundary = Clock::now();
+                    waitedMs += Ms(boundary - presented);
+                    error.Add((float)(Ms(boundary - lastBoundary) - periodMs));
+                } break;
+                case PACE_FIXED: {
+                    deadline += Dur(periodMs);
+                    Resync(presented);
+                    waitedMs += WaitUntil(deadline);
+                    boundary = Clock::now();
+                    error.Add((float)Ms(boundary - deadline));
+                    Resync(boundary);
+                } break;
+                case PACE_LOW_LATENCY: {
+                    error.Add((float)Ms(presented - deadline));
+                    deadline += Dur(periodMs);
+                    Resync(presented);
+                } break;
+                default:
+                    break;
+            }
+        }
+
+        wait.Add((float)waitedMs);
+        interval.Add((float)Ms(boundary - lastBoundary));
+        lastBoundary = boundary;
+    }
+
+    void Report(FILE* out) const {
+        fprintf(out, "pacing: mode %s, target %.3f ms, spin margin %.3f ms, sleeps %ld, spin iterations %ld\n",
+                PaceModeName(mode), periodMs, spinMarginMs, sleepCalls, spinIterations);
+        work.Report(out, "work");
+        wait.Report(out, "wait");
+        error.Report(out, "error");
+        interval.Report(out, "interval");
+    }
+
+private:
+    static constexpr double safetyMs = 0.5;
+    static constexpr double resyncMs = 1.0;
+    static const int WORK_WINDOW = 60;
+
+    double spinMarginMs;
+    double oversleepEwmaMs;
+    double oversleepPeakMs;
+    bool started;
+    long sleepCalls;
+    long spinIterations;
+    double pendingWaitMs = 0.0;
+    double predictedWorkMs = 0.0;
+    double recentWork[WORK_WINDOW];  // ring, oldest at workNext once full
+    double sortedWork[WORK_WINDOW];  // scratch for the p90
+    int workCount = 0;
+    int workNext = 0;
+    Clock::time_point deadline;
+    Clock::time_point lastBoundary;
+    Clock::time_point frameStart;
+
+    static double Ms(Clock::duration d) {
+        return std::chrono::duration<double, std::milli>(d).count();
+    }
+
+    static Clock::duration Dur(double ms) {
+        return std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double, std::milli>(ms));
+    }
+
+    // Holding the grid after a late frame would make the next one short to
+    // catch up, which is exactly the jitter we are trying to remove. Anything
+    // later than the resync threshold moves the grid instead.
+    void Resync(Clock::time_point now) {
+        if (now - deadline > Dur(resyncMs)) deadline = now;
+    }
+
+    void NoteOversleep(double overMs) {
+        if (overMs < 0.0) overMs = 0.0;
+        oversleepEwmaMs += (overMs - oversleepEwmaMs) * 0.1;
+        oversleepPeakMs = std::max(overMs, oversleepPeakMs * 0.95);
+        spinMarginMs = std::min(4.0, std::max(0.2, std::max(oversleepEwmaMs * 2.0, oversleepPeakMs)));
+    }
+
+    // p90 of the recent work window, used by low-latency mode.
+    void NoteWork(double ms) {
+        recentWork[workNext] = ms;
+        workNext = (workNext + 1) % WORK_WINDOW;
+        if (workCount < WORK_WINDOW) workCount++;
+        std::copy(recentWork, recentWork + workCount, sortedWork);
+        int k = std::min((workCount * 9) / 10, workCount - 1);
+        std::nth_element(sortedWork, sortedWork + k, sortedWork + workCount);
+        predictedWorkMs = sortedWork[k];
+    }
+
+    // Coarse sleep to within the spin margin, then spin. Returns ms waited.
+    double WaitUntil(Clock::time_point target) {
+        Clock::time_point start = Clock::now();
+        double sleepMs = Ms(target - start) - spinMarginMs;
+        if (sleepMs > 0.0) {
+            Clock::time_point wake = start + Dur(sleepMs);
+            std::this_thread::sleep_for(Dur(sleepMs));
+            sleepCalls++;
+            NoteOversleep(Ms(Clock::now() - wake));
+        }
+        while (Clock::now() < target) {
+            spinIterations++;
+        }
+        return Ms(Clock::now() - start);
+    }
+};
+
+//#####################
+//Idle frames
+//#####################
+// A frame that would look exactly like the one before is not worth drawing.
+// The loop reports after each frame whether anything on screen can still
+// change by itself. Once such a still frame is on screen the loop calls Wait
+// instead of drawing: it blocks until an input event arrives or the timeout
+// passes, then asks whether that input (or anything else that wants a frame,
+// which is what the timeout is for) calls for a frame.
+class IdleGate {
+public:
+    typedef std::chrono::steady_clock Clock;
+
+    bool enabled = true;
+    double timeoutMs = 250.0;
+
+    void Drawn(bool still) { settled = enabled && still; }
+    bool Settled() const { return settled; }
+
+    // block(ms) waits for input events for at most ms; wake() returns true
+    // when a frame is wanted. Returns false if nothing wanted one.
+    template <typename Block, typename Wake>
+    bool Wait(Block block, Wake wake) {
+        Clock::time_point start = Clock::now();
+        block(timeoutMs);
+        bool woke = wake();
+        idleMs += std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+        polls++;
+        if (woke) {
+            settled = false;
+            wakes++;
+        } else {
+            skipped++;
+        }
+        return woke;
+    }
+
+    // Passes through the loop that drew nothing.
+    long Skipped() const { return skipped; }
+    double IdleMs() const { return idleMs; }
+    long Polls() const { return polls; }
+    long Wakes() const { return wakes; }
+
+private:
+    bool settled = false;
+    double idleMs = 0.0;
+    long polls = 0;
+    long wakes = 0;
+    long skipped = 0;
+};
+
+#endif
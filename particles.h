@@ -0,0 +1,199 @@
+#ifndef PARTICLES_H
+#define PARTICLES_H
+
+#include <raylib.h>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+#include "rng.h"
+#include "threadpool.h"
+
+//#####################
+//Particles
+//#####################
+// Debris is kept as parallel float arrays with a fixed capacity, padded to a
+// whole number of 8-wide blocks so the integration kernel never needs a scalar
+// tail. Dead particles are swap-removed, so the live ones stay packed at the
+// front and the order of particles carries no meaning.
+
+static const int PARTICLE_LANES = 8;
+static const int PARTICLE_SPLIT_MIN = 32768;  // below this, one thread is faster
+
+struct ParticleBurst {
+    float x, y;
+    int count;
+    float speedMin, speedMax;  // px/s
+    float lifeMin, lifeMax;    // s
+    float sizeMin, sizeMax;    // px
+    Color color;
+};
+
+struct ParticleQuad {
+    float x, y;
+    float size;
+    Color color;
+};
+
+// Moves particles [begin, end) by dt. begin must be a multiple of the lane count.
+inline void IntegrateParticlesScalar(float* px, float* py, float* vx, float* vy, float* life,
+                                     int begin, int end, float dt, float gravity, float damping) {
+    for (int i = begin; i < end; i++) {
+        px[i] += vx[i] * dt;
+        py[i] += vy[i] * dt;
+        vx[i] *= damping;
+        vy[i] = vy[i] * damping + gravity * dt;
+        life[i] -= dt;
+    }
+}
+
+#if defined(__GNUC__)
+typedef float ParticleVec __attribute__((vector_size(32)));
+
+inline void IntegrateParticles(float* px, float* py, float* vx, float* vy, float* life,
+                               int begin, int end, float dt, float gravity, float damping) {
+    const ParticleVec step = {dt, dt, dt, dt, dt, dt, dt, dt};
+    const ParticleVec damp = {damping, damping, damping, damping, damping, damping, damping, damping};
+    const float g = gravity * dt;
+    const ParticleVec fall = {g, g, g, g, g, g, g, g};
+    for (int i = begin; i < end; i += PARTICLE_LANES) {
+        ParticleVec x, y, u, v, l;
+        memcpy(&x, px + i, sizeof(x));
+        memcpy(&y, py + i, sizeof(y));
+        memcpy(&u, vx + i, sizeof(u));
+        memcpy(&v, vy + i, sizeof(v));
+        memcpy(&l, life + i, sizeof(l));
+        x += u * step;
+        y += v * step;
+        u *= damp;
+        v = v * damp + fall;
+        l -= step;
+        memcpy(px + i, &x, sizeof(x));
+        memcpy(py + i, &y, sizeof(y));
+        memcpy(vx + i, &u, sizeof(u));
+        memcpy(vy + i, &v, sizeof(v));
+        memcpy(life + i, &l, sizeof(l));
+    }
+}
+#else
+inline void IntegrateParticles(float* px, float* py, float* vx, float* vy, float* life,
+                               int begin, int end, float dt, float gravity, float damping) {
+    IntegrateParticlesScalar(px, py, vx, vy, life, begin, end, dt, gravity, damping);
+}
+#endif
+
+class ParticleSystem {
+public:
+    float gravity;   // px/s^2, positive is down
+    float drag;      // fraction of velocity lost per second
+    bool simd;       // false runs the scalar kernel, for comparison
+
+    explicit ParticleSystem(int capacity = 131072)
+        : gravity(240.0f), drag(1.5f), simd(true), capacity(capacity), count(0) {
+        int padded = (capacity + PARTICLE_LANES - 1) / PARTICLE_LANES * PARTICLE_LANES;
+        px.assign(padded, 0.0f);
+        py.assign(padded, 0.0f);
+        vx.assign(padded, 0.0f);
+        vy.assign(padded, 0.0f);
+        life.assign(padded, 0.0f);
+        invLife.assign(padded, 0.0f);
+        size.assign(padded, 0.0f);
+        color.assign(padded, BLANK);
+    }
+
+    int Count() const { return count; }
+    int Capacity() const { return capacity; }
+
+    void Clear() { count = 0; }
+
+    // Emits as many of the burst's particles as fit; returns how many.
+    int Emit(const ParticleBurst& burst, RandomStream& rng) {
+        int n = burst.count;
+        if (n > capacity - count) n = capacity - count;
+        for (int k = 0; k < n; k++) {
+            int i = count++;
+            float angle = rng.NextFloat() * 6.2831853f;
+            float speed = burst.speedMin + (burst.speedMax - burst.speedMin) * rng.NextFloat();
+            float lifetime = burst.lifeMin + (burst.lifeMax - burst.lifeMin) * rng.NextFloat();
+            px[i] = burst.x;
+            py[i] = burst.y;
+            vx[i] = cosf(angle) * speed;
+            vy[i] = sinf(angle) * speed;
+            life[i] = lifetime;
+            invLife[i] = 1.0f / lifetime;
+            size[i] = burst.sizeMin + (burst.sizeMax - burst.sizeMin) * rng.NextFloat();
+            color[i] = burst.color;
+        }
+        return n;
+    }
+
+    // Integration is split across the pool when there is enough of it;
+    // removing the dead is one serial pass afterwards.
+    void Update(float dt, ThreadPool* pool = nullptr) {
+        if (count == 0) return;
+        float damping = 1.0f - drag * dt;
+        if (damping < 0.0f) damping = 0.0f;
+        int blocks = (count + PARTICLE_LANES - 1) / PARTICLE_LANES;
+        auto integrate = [&](int firstBlock, int lastBlock) {
+            int begin = firstBlock * PARTICLE_LANES;
+            int end = lastBlock * PARTICLE_LANES;
+            if (simd) {
+                IntegrateParticles(px.data(), py.data(), vx.data(), vy.data(), life.data(), begin, end, dt, gravity, damping);
+            } else {
+                IntegrateParticlesScalar(px.data(), py.data(), vx.data(), vy.data(), life.data(), begin, end, dt, gravity, damping);
+            }
+        };
+        if (pool && pool->Size() > 1 && count >= PARTICLE_SPLIT_MIN) {
+            pool->ParallelFor(blocks, pool->Size() + 1, integrate);
+        } else {
+            integrate(0, blocks);
+        }
+        RemoveDead();
+    }
+
+    // Replaces out with what is visible in [0, width) x [0, height), faded by
+    // remaining life.
+    void BuildDrawList(std::vector<ParticleQuad>& out, int width, int height) const {
+        if ((int)out.size() < count) out.resize(count);
+        ParticleQuad* quad = out.data();
+        const float w = (float)width;
+        const float h = (float)height;
+        for (int i = 0; i < count; i++) {
+            float x = px[i], y = py[i], s = size[i];
+            // Written unconditionally and kept only if visible, so the loop has no branch.
+            float fade = std::fmin(life[i] * invLife[i], 1.0f);
+            Color c = color[i];
+            c.a = (unsigned char)(c.a * fade);
+            *quad = {x, y, s, c};
+            quad += (x + s >= 0.0f) & (y + s >= 0.0f) & (x < w) & (y < h);
+        }
+        out.resize(quad - out.data());
+    }
+
+private:
+    int capacity;
+    int count;
+    std::vector<float> px, py, vx, vy, life, invLife, size;
+    std::vector<Color> color;
+
+    void RemoveDead() {
+        int i = 0;
+        while (i < count) {
+            if (life[i] > 0.0f) {
+                i++;
+                continue;
+            }
+            int last = --count;
+            px[i] = px[last];
+            py[i] = py[last];
+            vx[i] = vx[last];
+            vy[i] = vy[last];
+            life[i] = life[last];
+            invLife[i] = invLife[last];
+            size[i] = size[last];
+            color[i] = color[last];
+        }
+    }
+};
+
+#endif
@@ -0,0 +1,205 @@
+#ifndef RNG_H
+#define RNG_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+//#####################
+//Random streams
+//#####################
+// Each stream is eight interleaved xoshiro128** generators stepped together,
+// so one step yields eight outputs and the step vectorizes. Draw i of a stream
+// always comes from lane i % 8, which makes a batch fill return exactly what
+// the same number of single draws would have. Streams are seeded from a world
+// seed and a stream id, so no two spawners share state and nothing depends on
+// which thread does the drawing.
+
+static const int RNG_LANES = 8;
+
+inline uint64_t SplitMix64(uint64_t& state) {
+    uint64_t z = (state += 0x9E3779B97F4A7C15ull);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+#if defined(__GNUC__)
+typedef uint32_t RngVec __attribute__((vector_size(32)));
+
+// One step of all eight lanes. Multiplies by 5 and 9 are spelled as shifts so
+// SSE2 (which has no 32-bit vector multiply) does not fall back to scalar code.
+inline void RngStepLanes(uint32_t state[4][RNG_LANES], uint32_t out[RNG_LANES]) {
+    RngVec s0, s1, s2, s3;
+    memcpy(&s0, state[0], sizeof(s0));
+    memcpy(&s1, state[1], sizeof(s1));
+    memcpy(&s2, state[2], sizeof(s2));
+    memcpy(&s3, state[3], sizeof(s3));
+
+    RngVec x = (s1 << 2) + s1;
+    x = (x << 7) | (x >> 25);
+    RngVec result = (x << 3) + x;
+
+    RngVec t = s1 << 9;
+    s2 ^= s0;
+    s3 ^= s1;
+    s1 ^= s2;
+    s0 ^= s3;
+    s2 ^= t;
+    s3 = (s3 << 11) | (s3 >> 21);
+
+    memcpy(state[0], &s0, sizeof(s0));
+    memcpy(state[1], &s1, sizeof(s1));
+    memcpy(state[2], &s2, sizeof(s2));
+    memcpy(state[3], &s3, sizeof(s3));
+    memcpy(out, &result, sizeof(result));
+}
+#else
+inline void RngStepLanes(uint32_t state[4][RNG_LANES], uint32_t out[RNG_LANES]) {
+    for (int lane = 0; lane < RNG_LANES; lane++) {
+        uint32_t s0 = state[0][lane], s1 = state[1][lane], s2 = state[2][lane], s3 = state[3][lane];
+        uint32_t x = s1 * 5;
+        out[lane] = ((x << 7) | (x >> 25)) * 9;
+        uint32_t t = s1 << 9;
+        s2 ^= s0;
+        s3 ^= s1;
+        s1 ^= s2;
+        s0 ^= s3;
+        s2 ^= t;
+        s3 = (s3 << 11) | (s3 >> 21);
+        state[0][lane] = s0;
+        state[1][lane] = s1;
+        state[2][lane] = s2;
+        state[3][lane] = s3;
+    }
+}
+#endif
+
+// Maps a uniform 32-bit value onto [min, max] inclusive, the same contract as
+// raylib's GetRandomValue, with a multiply instead of a modulo.
+inline int MapRange(uint32_t x, int min, int max) {
+    if (min > max) {
+        int t = min;
+        min = max;
+        max = t;
+    }
+    uint64_t span = (uint64_t)((int64_t)max - min) + 1;
+    return (int)(min + (int64_t)(((uint64_t)x * span) >> 32));
+}
+
+class RandomStream {
+public:
+    RandomStream(uint64_t seed = 0, uint64_t stream = 0) {
+        Seed(seed, stream);
+    }
+
+    void Seed(uint64_t seed, uint64_t stream) {
+        uint64_t mix = seed ^ (stream * 0xD1B54A32D192ED03ull);
+        for (int lane = 0; lane < RNG_LANES; lane++) {
+            uint64_t a = SplitMix64(mix);
+            uint64_t b = SplitMix64(mix);
+            state[0][lane] = (uint32_t)a;
+            state[1][lane] = (uint32_t)(a >> 32);
+            state[2][lane] = (uint32_t)b;
+            state[3][lane] = (uint32_t)(b >> 32);
+            if ((state[0][lane] | state[1][lane] | state[2][lane] | state[3][lane]) == 0) {
+                state[0][lane] = 1;
+            }
+        }
+        used = RNG_LANES;
+    }
+
+    uint32_t NextU32() {
+        if (used == RNG_LANES) {
+            RngStepLanes(state, block);
+            used = 0;
+        }
+        return block[used++];
+    }
+
+    // [0, 1) with 24 bits of precision.
+    float NextFloat() {
+        return (NextU32() >> 8) * (1.0f / 16777216.0f);
+    }
+
+    int Range(int min, int max) {
+        return MapRange(NextU32(), min, max);
+    }
+
+    // Same values, in the same order, as n calls to NextU32.
+    void FillU32(uint32_t* out, size_t n) {
+        size_t i = 0;
+        while (i < n && used < RNG_LANES) out[i++] = block[used++];
+        while (n - i >= (size_t)RNG_LANES) {
+            RngStepLanes(state, out + i);
+            i += RNG_LANES;
+        }
+        if (i < n) {
+            RngStepLanes(state, block);
+            used = 0;
+            while (i < n) out[i++] = block[used++];
+        }
+    }
+
+private:
+    uint32_t state[4][RNG_LANES];
+    uint32_t block[RNG_LANES];
+    int used;
+};
+
+// Spawn commands draw y, vx and scale in that order; a batch interleaves them
+// the same way so a burst matches the same number of single spawns.
+struct SpawnParams {
+    float y;
+    float vx;
+    float scale;
+};
+
+struct SpawnRanges {
+    int yMin, yMax;
+    int vxMin, vxMax;
+    float vxDivisor;
+    int scaleMin, scaleMax;
+    float scaleDivisor;
+};
+
+// Range setup hoisted out of the loop; bit-identical to MapRange.
+struct RangeMap {
+    int64_t min;
+    uint64_t span;
+
+    RangeMap(int lo, int hi) {
+        if (lo > hi) {
+            int t = lo;
+            lo = hi;
+            hi = t;
+        }
+        min = lo;
+        span = (uint64_t)((int64_t)hi - lo) + 1;
+    }
+
+    int operator()(uint32_t x) const {
+        return (int)(min + (int64_t)(((uint64_t)x * span) >> 32));
+    }
+};
+
+inline void FillSpawnBatch(RandomStream& rng, const SpawnRanges& ranges, SpawnParams* out, size_t count) {
+    const size_t CHUNK = 256;
+    uint32_t raw[CHUNK * 3];
+    const RangeMap y(ranges.yMin, ranges.yMax);
+    const RangeMap vx(ranges.vxMin, ranges.vxMax);
+    const RangeMap scale(ranges.scaleMin, ranges.scaleMax);
+    for (size_t done = 0; done < count; done += CHUNK) {
+        size_t n = count - done < CHUNK ? count - done : CHUNK;
+        rng.FillU32(raw, n * 3);
+        const uint32_t* r = raw;
+        SpawnParams* o = out + done;
+        for (size_t i = 0; i < n; i++, r += 3, o++) {
+            o->y = (float)y(r[0]);
+            o->vx = vx(r[1]) / ranges.vxDivisor;
+            o->scale = scale(r[2]) / ranges.scaleDivisor;
+        }
+    }
+}
+
+#endif
@@ -0,0 +1,338 @@
+#ifndef ROLLBACK_H
+#define ROLLBACK_H
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "simcore.h"
+#include "spectate.h"
+
+#if !defined(_WIN32)
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+//#####################
+//Rollback
+//#####################
+// Two-player co-op on the fixed-point core. Each player runs the whole game
+// in their own process and sends only their inputs. A tick never waits for
+// the other player: their input is guessed to be the same as their last one
+// and the tick is played at once. The state before each of the last
+// ROLLBACK_WINDOW ticks is kept. When a guess turns out wrong, the state from
+// before that tick is put back and the ticks since are played again with the
+// real input, within the same frame. SimState is plain data, so saving one is
+// a copy into storage that stays allocated after the first pass.
+//
+// Every packet carries all the inputs the peer has not acknowledged, so a
+// lost packet costs nothing but a later correction. Every ROLLBACK_SYNC_TICKS
+// the hash of a state that both inputs are known for is sent along too, and
+// the peer checks it against its own.
+
+static const int ROLLBACK_WINDOW = 32;    // saved states; a peer further behind holds the game
+static const int ROLLBACK_INPUTS = 256;   // input history per player, a power of two
+static const int ROLLBACK_SEND_MAX = 64;  // inputs per packet
+static const int ROLLBACK_SYNC_TICKS = 30;
+static const int ROLLBACK_SYNCS = 8;      // own hashes kept for the peer's to be checked against
+static const uint32_t ROLLBACK_MAGIC = 0x42524750;
+
+struct RollbackMetrics {
+    long frames = 0;      // calls to Advance
+    long ticks = 0;       // played forward; replays are counted in resimTicks
+    long held = 0;        // frames the tick was held, for a peer behind or us ahead
+    long rollbacks = 0;
+    long resimTicks = 0;
+    int lastDepth = 0;    // ticks replayed this frame
+    int maxDepth = 0;
+    double lastResimMs = 0.0;  // this frame
+    double maxResimMs = 0.0;
+    double resimMsSum = 0.0;
+    long packetsIn = 0, packetsOut = 0, badPackets = 0;
+    long syncsChecked = 0, desyncs = 0;
+    long depthCounts[ROLLBACK_WINDOW + 1] = {};
+};
+
+class RollbackSession {
+public:
+    FixedSim sim;  // the present, with guesses for the peer's latest inputs
+
+    // Both players must pass the same params and seed.
+    RollbackSession(const SimParams& params, uint64_t seed, uint64_t streamBase, int localPlayer)
+        : sim(params, seed, streamBase),
+          local(localPlayer),
+          remote(1 - localPlayer),
+          session((uint32_t)(seed ^ seed >> 32)) {
+        sim.params.players = SIM_PLAYERS;
+        sim.Reset(seed);
+        saved.resize(ROLLBACK_WINDOW);
+    }
+
+    int LocalPlayer() const { return local; }
+    uint64_t Tick() const { return sim.state.tick; }
+    // Ticks both players' inputs are known for.
+    uint64_t Confirmed() const { return std::min(remoteKnown, Tick()); }
+    bool Heard() const { return metrics.packetsIn > metrics.badPackets; }
+    const RollbackMetrics& Metrics() const { return metrics; }
+
+    // How many ticks this side is ahead of the peer, from each side's view of
+    // the other: the latency in both views cancels out.
+    int Lead() const { return Heard() ? ((int)(Tick() - peerTick) - peerAdvantage) / 2 : 0; }
+
+    // Replays whatever the peer's inputs showed was guessed wrong, then plays
+    // one tick with this player's input. False if the tick was held.
+    bool Advance(uint8_t input) {
+        metrics.frames++;
+        Settle();
+        uint64_t t = Tick();
+        bool behind = remoteKnown + ROLLBACK_WINDOW <= t || peerAcked + ROLLBACK_INPUTS <= t;
+        // Ahead by two ticks or more: hold every other frame until level.
+        bool ahead = Lead() >= 2 && !heldLast;
+        if (behind || ahead || sim.state.dead) {
+            metrics.held += !sim.state.dead;
+            heldLast = true;
+            return false;
+        }
+        heldLast = false;
+        localInputs[t % ROLLBACK_INPUTS] = input;
+        Play(t);
+        metrics.ticks++;
+        return true;
+    }
+
+    // Replays from the first tick whose guess was wrong, then records the
+    // hashes of states that are now final.
+    void Settle() {
+        metrics.lastDepth = 0;
+        metrics.lastResimMs = 0.0;
+        if (firstWrong < Tick()) {
+            auto start = std::chrono::steady_clock::now();
+            uint64_t end = Tick();
+            sim.state = saved[firstWrong % ROLLBACK_WINDOW];
+            for (uint64_t t = firstWrong; t < end && !sim.state.dead; t++) Play(t);
+            double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            int depth = (int)(end - firstWrong);
+            metrics.rollbacks++;
+            metrics.resimTicks += depth;
+            metrics.lastDepth = depth;
+            metrics.maxDepth = std::max(metrics.maxDepth, depth);
+            metrics.depthCounts[std::min(depth, ROLLBACK_WINDOW)]++;
+            metrics.lastResimMs = ms;
+            metrics.maxResimMs = std::max(metrics.maxResimMs, ms);
+            metrics.resimMsSum += ms;
+        }
+        firstWrong = UINT64_MAX;
+        RecordSyncs();
+    }
+
+    // magic, session, tick, advantage, inputs held from the peer, first input
+    // tick, count, inputs, then the latest sync: tick (0 for none) and hash.
+    void WritePacket(std::vector<uint8_t>& out) {
+        out.clear();
+        ByteWriter w(out);
+        w.U32(ROLLBACK_MAGIC);
+        w.U32(session);
+        w.U32((uint32_t)Tick());
+        w.U32((uint32_t)(Heard() ? (int32_t)(Tick() - peerTick) : 0));
+        w.U32((uint32_t)remoteKnown);
+        uint64_t from = std::min(peerAcked, Tick());
+        int count = (int)std::min<uint64_t>(Tick() - from, ROLLBACK_SEND_MAX);
+        w.U32((uint32_t)from);
+        w.U8((uint8_t)count);
+        for (int i = 0; i < count; i++) w.U8(localInputs[(from + i) % ROLLBACK_INPUTS]);
+        w.U32((uint32_t)lastSync.tick);
+        w.U32((uint32_t)lastSync.hash);
+        w.U32((uint32_t)(lastSync.hash >> 32));
+        metrics.packetsOut++;
+    }
+
+    bool ReadPacket(const uint8_t* data, size_t size) {
+        metrics.packetsIn++;
+        ByteReader r(data, size);
+        uint32_t magic = r.U32();
+        uint32_t id = r.U32();
+        uint64_t tick = r.U32();
+        int32_t advantage = (int32_t)r.U32();
+        uint64_t acked = r.U32();
+        uint64_t first = r.U32();
+        int count = r.U8();
+        uint8_t inputs[ROLLBACK_SEND_MAX];
+        for (int i = 0; i < count && i < ROLLBACK_SEND_MAX; i++) inputs[i] = r.U8();
+        Sync sync;
+        sync.tick = r.U32();
+        sync.hash = r.U32();
+        sync.hash |= (uint64_t)r.U32() << 32;
+        if (!r.Ok() || !r.Done() || magic != ROLLBACK_MAGIC || id != session || count > ROLLBACK_SEND_MAX) {
+            metrics.badPackets++;
+            return false;
+        }
+        // Packets may arrive out of order; only the newest tells the peer's tick.
+        if (tick >= peerTick) {
+            peerTick = tick;
+            peerAdvantage = advantage;
+        }
+        peerAcked = std::max(peerAcked, acked);
+        for (int i = 0; i < count; i++) ReceiveInput(first + i, inputs[i]);
+        if (sync.tick > peerSync.tick) peerSync = sync;
+        CheckPeerSync();
+        return true;
+    }
+
+private:
+    struct Sync {
+        uint64_t tick = 0;
+        uint64_t hash = 0;
+    };
+
+    int local, remote;
+    uint32_t session;
+    std::vector<SimState<FixedMath>> saved;  // before tick t, at t % ROLLBACK_WINDOW
+    uint8_t localInputs[ROLLBACK_INPUTS] = {};
+    uint8_t remoteInputs[ROLLBACK_INPUTS] = {};
+    uint8_t guessed[ROLLBACK_INPUTS] = {};   // what tick t was last played with for the peer
+    uint64_t remoteKnown = 0;  // the peer's inputs are known below this tick
+    uint64_t firstWrong = UINT64_MAX;
+    uint64_t peerTick = 0;
+    int peerAdvantage = 0;
+    uint64_t peerAcked = 0;    // the peer holds our inputs below this tick
+    bool heldLast = false;
+    Sync syncs[ROLLBACK_SYNCS];
+    Sync lastSync, peerSync;
+    uint64_t nextSync = ROLLBACK_SYNC_TICKS;
+    uint64_t lastChecked = 0;
+    RollbackMetrics metrics;
+
+    uint8_t Guess() const { return remoteKnown > 0 ? remoteInputs[(remoteKnown - 1) % ROLLBACK_INPUTS] : 0; }
+
+    void Play(uint64_t t) {
+        saved[t % ROLLBACK_WINDOW] = sim.state;
+        uint8_t inputs[SIM_PLAYERS];
+        inputs[local] = localInputs[t % ROLLBACK_INPUTS];
+        inputs[remote] = t < remoteKnown ? remoteInputs[t % ROLLBACK_INPUTS] : Guess();
+        guessed[t % ROLLBACK_INPUTS] = inputs[remote];
+        sim.Step(inputs);
+    }
+
+    // Inputs are taken in order; the peer resends anything past a gap.
+    void ReceiveInput(uint64_t t, uint8_t input) {
+        if (t != remoteKnown) return;
+        remoteInputs[t % ROLLBACK_INPUTS] = input;
+        if (t < Tick() && guessed[t % ROLLBACK_INPUTS] != input) firstWrong = std::min(firstWrong, t);
+        remoteKnown++;
+    }
+
+    void RecordSyncs() {
+        uint64_t final = Confirmed();
+        while (nextSync <= final) {
+            const SimState<FixedMath>& state = nextSync == Tick() ? sim.state : saved[nextSync % ROLLBACK_WINDOW];
+            lastSync = {nextSync, sim.Hash(state)};
+            syncs[nextSync / ROLLBACK_SYNC_TICKS % ROLLBACK_SYNCS] = lastSync;
+            nextSync += ROLLBACK_SYNC_TICKS;
+        }
+        CheckPeerSync();
+    }
+
+    void CheckPeerSync() {
+        if (peerSync.tick <= lastChecked) return;
+        const Sync& own = syncs[peerSync.tick / ROLLBACK_SYNC_TICKS % ROLLBACK_SYNCS];
+        if (own.tick != peerSync.tick) return;
+        metrics.syncsChecked++;
+        metrics.desyncs += own.hash != peerSync.hash;
+        lastChecked = peerSync.tick;
+    }
+};
+
+// Unreliable datagrams to one peer; losses and reordering are left to the
+// session.
+class UdpLink {
+public:
+    UdpLink() : fd(-1) {}
+    ~UdpLink() { Close(); }
+
+#if defined(_WIN32)
+    bool Open(int, bool, std::string& error) {
+        error = "co-op is not supported on Windows";
+        return false;
+    }
+    bool SetPeer(const char*, int, std::string& error) {
+        error = "co-op is not supported on Windows";
+        return false;
+    }
+    void Close() {}
+    int Port() const { return 0; }
+    void Send(const std::vector<uint8_t>&) {}
+    int Receive(uint8_t*, size_t) { return -1; }
+#else
+    // Port 0 takes any free port. A loopback link is not reachable from
+    // other hosts at all.
+    bool Open(int port, bool loopback, std::string& error) {
+        fd = socket(AF_INET, SOCK_DGRAM, 0);
+        sockaddr_in addr = {};
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(loopback ? INADDR_LOOPBACK : INADDR_ANY);
+        addr.sin_port = htons((uint16_t)port);
+        if (fd < 0 || bind(fd, (sockaddr*)&addr, sizeof(addr)) < 0) {
+            error = strerror(errno);
+            Close();
+            return false;
+        }
+        fcntl(fd, F_SETFL, O_NONBLOCK);
+        return true;
+    }
+
+    // Connects the socket, so the kernel drops datagrams from anyone but the
+    // peer and nobody else can feed inputs into the session.
+    bool SetPeer(const char* host, int port, std::string& error) {
+        sockaddr_in peer = {};
+        peer.sin_family = AF_INET;
+        peer.sin_port = htons((uint16_t)port);
+        if (inet_pton(AF_INET, host, &peer.sin_addr) != 1) {
+            error = std::string("not an IPv4 address: ") + host;
+            return false;
+        }
+        if (fd < 0 || connect(fd, (sockaddr*)&peer, sizeof(peer)) < 0) {
+            error = fd < 0 ? "socket is not open" : strerror(errno);
+            return false;
+        }
+        return true;
+    }
+
+    void Close() {
+        if (fd >= 0) close(fd);
+        fd = -1;
+    }
+
+    int Port() const {
+        sockaddr_in addr = {};
+        socklen_t length = sizeof(addr);
+        if (fd < 0 || getsockname(fd, (sockaddr*)&addr, &length) < 0) return 0;
+        return ntohs(addr.sin_port);
+    }
+
+    // Errors, such as nobody listening yet, are dropped like a lost packet.
+    void Send(const std::vector<uint8_t>& bytes) {
+        if (fd >= 0) send(fd, bytes.data(), bytes.size(), 0);
+    }
+
+    // The size of the next datagram, or -1 if none is waiting.
+    int Receive(uint8_t* buffer, size_t size) {
+        if (fd < 0) return -1;
+        for (;;) {
+            ssize_t n = recv(fd, buffer, size, 0);
+            if (n >= 0) return (int)n;
+            if (errno != ECONNREFUSED) return -1;
+        }
+    }
+#endif
+
+private:
+    int fd;
+};
+
+#endif
@@ -0,0 +1,307 @@
+#ifndef SIMCORE_H
+#define SIMCORE_H
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+#include "rng.h"
+
+//#####################
+//Simulation core
+//#####################
+// The gameplay rules (ship flight, obstacle and bullet motion, hits, misses
+// and scoring) on a fixed 60 Hz tick with no raylib and no textures. The
+// number type is a template parameter: FixedSim runs on Q16.16 integers and
+// gives bit-identical states on any compiler, flag set or thread, FloatSim
+// runs the same code on floats for comparison. Rates are applied per tick as
+// v / SIM_HZ, so nothing depends on the measured frame time. Up to
+// SIM_PLAYERS ships can share the field, each with its own input.
+
+static const int SIM_HZ = 60;
+static const int SIM_KINDS = 5;
+static const int SIM_PLAYERS = 2;
+
+enum SimInput : uint8_t { SIM_FLY = 1, SIM_SHOOT = 2 };
+
+typedef int32_t Fix;
+static const int FIX_SHIFT = 16;
+static const Fix FIX_ONE = 1 << FIX_SHIFT;
+
+struct FixedMath {
+    typedef Fix Num;
+    static Num Int(int v) { return (Num)((int64_t)v << FIX_SHIFT); }
+    static Num Ratio(int num, int den) { return (Num)(((int64_t)num << FIX_SHIFT) / den); }
+    static Num Mul(Num a, Num b) { return (Num)(((int64_t)a * b) >> FIX_SHIFT); }
+    static Num PerTick(Num v) { return v / SIM_HZ; }
+    static float ToFloat(Num v) { return v * (1.0f / FIX_ONE); }
+    static uint32_t Bits(Num v) { return (uint32_t)v; }
+};
+
+struct FloatMath {
+    typedef float Num;
+    static Num Int(int v) { return (float)v; }
+    static Num Ratio(int num, int den) { return (float)num / den; }
+    static Num Mul(Num a, Num b) { return a * b; }
+    static Num PerTick(Num v) { return v * (1.0f / SIM_HZ); }
+    static float ToFloat(Num v) { return v; }
+    static uint32_t Bits(Num v) {
+        uint32_t bits;
+        memcpy(&bits, &v, sizeof(bits));
+        return bits;
+    }
+};
+
+// Draws match the spawn commands: y, then vx / vxDivisor, then scale / scaleDivisor.
+struct SimKind {
+    int interval;          // ticks between spawns
+    int vxMin, vxMax, vxDivisor;
+    int scaleMin, scaleMax, scaleDivisor;
+    int width, height;     // texture size at scale 1
+    int score;             // gained for a kill, lost for a miss
+};
+
+struct SimParams {
+    int fieldWidth = 1280;
+    int fieldHeight = 720;
+    int shipX = 200;
+    int shipTextureWidth = 450;   // drawn at a third of the texture size
+    int shipTextureHeight = 239;
+    int shipAccel = 1500;
+    int shipDecel = 1500;
+    int bulletSpeed = 500;
+    int bulletRadius = 5;
+    int maxBullets = 256;
+    bool godMode = false;         // keep playing through ship hits
+    int players = 1;              // ships, stacked evenly down the field
+    SimKind kinds[SIM_KINDS] = {
+        {60, -2000, -1000, 10, 20, 50, 100, 208, 239, 1},    // star
+        {120, -2000, -1000, 10, 20, 50, 500, 1200, 1175, 2}, // polri
+        {180, -2000, -1000, 10, 20, 50, 100, 275, 183, 3},   // opm
+        {240, -2000, -1000, 10, 20, 30, 100, 605, 604, 4},   // gibran
+        {300, -2000, -1000, 10, 20, 50, 500, 691, 880, 5},   // MA
+    };
+};
+
+template <typename Num>
+struct SimObstacle {
+    Num x, y, w, h, vx;
+    int kind;
+    bool active;
+};
+
+template <typename Num>
+struct SimBullet {
+    Num x, y, vx;
+    bool active;
+    int owner;  // player who fired it
+};
+
+template <typename Num>
+struct SimShip {
+    Num y, vy;
+    bool dead;
+    long kills;
+};
+
+// Plain data, so assigning one state to another is a snapshot.
+template <typename M>
+struct SimState {
+    typedef typename M::Num Num;
+    uint64_t tick = 0;
+    int score = 0;
+    bool dead = false;  // every ship is down
+    SimShip<Num> ships[SIM_PLAYERS] = {};
+    int spawnTimer[SIM_KINDS] = {};
+    RandomStream rng[SIM_KINDS];
+    std::vector<SimObstacle<Num>> obstacles;  // in spawn order
+    std::vector<SimBullet<Num>> bullets;      // in firing order
+    long kills = 0, misses = 0, shots = 0;
+};
+
+template <typename M>
+class SimCore {
+public:
+    typedef typename M::Num Num;
+
+    SimParams params;
+    SimState<M> state;
+
+    // Kind k draws from stream streamBase + k of the seed.
+    SimCore(const SimParams& params, uint64_t seed, uint64_t streamBase) : params(params), streamBase(streamBase) {
+        Reset(seed);
+    }
+
+    void Reset(uint64_t seed) {
+        state.tick = 0;
+        state.score = 0;
+        state.dead = false;
+        for (int p = 0; p < SIM_PLAYERS; p++) {
+            state.ships[p] = {M::Int(params.fieldHeight * (p + 1) / (params.players + 1)), 0, p >= params.players, 0};
+        }
+        for (int k = 0; k < SIM_KINDS; k++) {
+            state.spawnTimer[k] = 0;
+            state.rng[k].Seed(seed, streamBase + k);
+        }
+        state.obstacles.clear();
+        state.bullets.clear();
+        state.kills = state.misses = state.shots = 0;
+    }
+
+    Num ShipWidth() const { return M::Ratio(params.shipTextureWidth, 3); }
+    Num ShipHeight() const { return M::Ratio(params.shipTextureHeight, 3); }
+
+    // One-player games only; the others would read past the input.
+    void Step(uint8_t input) {
+        assert(params.players == 1);
+        Step(&input);
+    }
+
+    // One input per player.
+    void Step(const uint8_t* inputs) {
+        SimState<M>& s = state;
+        if (s.dead) return;
+        const Num shipX = M::Int(params.shipX);
+        const Num shipW = ShipWidth();
+        const Num shipH = ShipHeight();
+
+        for (int p = 0; p < params.players; p++) {
+            SimShip<Num>& ship = s.ships[p];
+            if (ship.dead) continue;
+            // Ship::Fly
+            if (inputs[p] & SIM_FLY) {
+                ship.vy -= M::PerTick(M::Int(params.shipAccel));
+            } else {
+                ship.vy += M::PerTick(M::Int(params.shipDecel));
+            }
+            ship.y += M::PerTick(ship.vy);
+            if (ship.y < 0) {
+                ship.y = 0;
+                ship.vy = 0;
+            } else if (ship.y + shipH > M::Int(params.fieldHeight)) {
+                ship.y = M::Int(params.fieldHeight) - shipH;
+                ship.vy = 0;
+            }
+
+            if ((inputs[p] & SIM_SHOOT) && (int)s.bullets.size() < params.maxBullets) {
+                s.bullets.push_back({shipX + shipW, ship.y + shipH / 2, M::Int(params.bulletSpeed), true, p});
+                s.shots++;
+            }
+        }
+
+        for (int k = 0; k < SIM_KINDS; k++) {
+            const SimKind& kind = params.kinds[k];
+            if (++s.spawnTimer[k] < kind.interval) continue;
+            s.spawnTimer[k] = 0;
+            RandomStream& rng = s.rng[k];
+            Num y = M::Int(rng.Range(0, params.fieldHeight));
+            Num vx = M::Ratio(rng.Range(kind.vxMin, kind.vxMax), kind.vxDivisor);
+            Num scale = M::Ratio(rng.Range(kind.scaleMin, kind.scaleMax), kind.scaleDivisor);
+            s.obstacles.push_back({M::Int(params.fieldWidth + 50), y, M::Mul(M::Int(kind.width), scale),
+                                   M::Mul(M::Int(kind.height), scale), vx, k, true});
+        }
+
+        for (SimObstacle<Num>& o : s.obstacles) {
+            o.x += M::PerTick(o.vx);
+            if (o.x + o.w < 0) {
+                o.active = false;
+                s.score -= params.kinds[o.kind].score;
+                s.misses++;
+            }
+        }
+
+        const Num fieldW = M::Int(params.fieldWidth);
+        for (SimBullet<Num>& b : s.bullets) {
+            b.x += M::PerTick(b.vx);
+            if (b.x > fieldW) b.active = false;
+        }
+
+        // First bullet in firing order takes the hit, as in the game.
+        const Num r = M::Int(params.bulletRadius);
+        for (SimObstacle<Num>& o : s.obstacles) {
+            if (!o.active) continue;
+            for (SimBullet<Num>& b : s.bullets) {
+                if (!b.active) continue;
+                if (b.x - r < o.x + o.w && b.x + r > o.x && b.y - r < o.y + o.h && b.y + r > o.y) {
+                    b.active = false;
+                    o.active = false;
+                    s.score += params.kinds[o.kind].score;
+                    s.kills++;
+                    s.ships[b.owner].kills++;
+                    break;
+                }
+            }
+            if (!o.active) continue;
+            for (int p = 0; p < params.players; p++) {
+                SimShip<Num>& ship = s.ships[p];
+                if (ship.dead) continue;
+                if (shipX < o.x + o.w && shipX + shipW > o.x && ship.y < o.y + o.h && ship.y + shipH > o.y) {
+                    o.active = false;
+                    if (!params.godMode) ship.dead = true;
+                    break;
+                }
+            }
+        }
+        s.dead = true;
+        for (int p = 0; p < params.players; p++) s.dead = s.dead && s.ships[p].dead;
+
+        s.obstacles.erase(std::remove_if(s.obstacles.begin(), s.obstacles.end(),
+                                         [](const SimObstacle<Num>& o) { return !o.active; }),
+                          s.obstacles.end());
+        s.bullets.erase(std::remove_if(s.bullets.begin(), s.bullets.end(),
+                                       [](const SimBullet<Num>& b) { return !b.active; }),
+                        s.bullets.end());
+        s.tick++;
+    }
+
+    // Over everything that affects later ticks except the random streams,
+    // which follow from the seed and the spawn count.
+    uint64_t Hash() const { return Hash(state); }
+
+    uint64_t Hash(const SimState<M>& s) const {
+        uint64_t h = 0xcbf29ce484222325ull;
+        auto mix = [&h](uint32_t w) { h = (h ^ w) * 0x100000001b3ull; };
+        mix((uint32_t)s.tick);
+        mix((uint32_t)s.score);
+        mix(s.dead);
+        mix(M::Bits(s.ships[0].y));
+        mix(M::Bits(s.ships[0].vy));
+        for (int k = 0; k < SIM_KINDS; k++) mix((uint32_t)s.spawnTimer[k]);
+        for (const SimObstacle<Num>& o : s.obstacles) {
+            mix(M::Bits(o.x));
+            mix(M::Bits(o.y));
+            mix(M::Bits(o.w));
+            mix(M::Bits(o.h));
+            mix(M::Bits(o.vx));
+            mix((uint32_t)o.kind);
+        }
+        for (const SimBullet<Num>& b : s.bullets) {
+            mix(M::Bits(b.x));
+            mix(M::Bits(b.y));
+        }
+        // Per-player words go last and only with more than one player, so a
+        // one-player hash is what it always was. There they would only repeat
+        // s.dead, s.kills and an owner of 0.
+        if (params.players > 1) {
+            for (int p = 1; p < params.players; p++) {
+                mix(M::Bits(s.ships[p].y));
+                mix(M::Bits(s.ships[p].vy));
+            }
+            for (int p = 0; p < params.players; p++) {
+                mix(s.ships[p].dead);
+                mix((uint32_t)s.ships[p].kills);
+            }
+            for (const SimBullet<Num>& b : s.bullets) mix((uint32_t)b.owner);
+        }
+        return h;
+    }
+
+private:
+    uint64_t streamBase;
+};
+
+typedef SimCore<FixedMath> FixedSim;
+typedef SimCore<FloatMath> FloatSim;
+
+#endif
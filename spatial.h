@@ -0,0 +1,205 @@
+#ifndef SPATIAL_H
+#define SPATIAL_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+//#####################
+//Spatial index
+//#####################
+// Obstacles of every kind go into one index, rebuilt each tick. The field is
+// cut into horizontal lanes; a box is listed in every lane it touches, and
+// each lane is sorted by left edge. Queries only visit the lanes they can
+// reach and stop scanning a lane once its sort order rules out anything
+// closer. The top and bottom lanes also hold whatever is above or below the
+// field. Items are numbered in insertion order and ties go to the lower
+// number, so results do not depend on lane layout.
+
+struct SpatialItem {
+    float minX, minY, maxX, maxY;
+    int kind;
+    int index;
+};
+
+struct SpatialHit {
+    int item;
+    float distance;
+};
+
+class SpatialIndex {
+public:
+    explicit SpatialIndex(float laneHeight = 32.0f) : laneHeight(laneHeight), laneCount(1), stamp(0) {}
+
+    void Clear() {
+        items.clear();
+    }
+
+    int Add(float x, float y, float width, float height, int kind, int index) {
+        items.push_back({x, y, x + width, y + height, kind, index});
+        return (int)items.size() - 1;
+    }
+
+    int Count() const { return (int)items.size(); }
+    const SpatialItem& Item(int i) const { return items[i]; }
+
+    // Call after the last Add and before any query.
+    void Build(float fieldHeight) {
+        laneCount = std::max(1, (int)(fieldHeight / laneHeight + 0.999f));
+        laneStart.assign(laneCount + 1, 0);
+        laneMaxWidth.assign(laneCount, 0.0f);
+        for (const SpatialItem& item : items) {
+            for (int lane = LaneOf(item.minY); lane <= LaneOf(item.maxY); lane++) laneStart[lane + 1]++;
+        }
+        for (int lane = 0; lane < laneCount; lane++) laneStart[lane + 1] += laneStart[lane];
+
+        entries.resize(laneStart[laneCount]);
+        std::vector<int> fill(laneStart.begin(), laneStart.end() - 1);
+        for (int i = 0; i < (int)items.size(); i++) {
+            const SpatialItem& item = items[i];
+            for (int lane = LaneOf(item.minY); lane <= LaneOf(item.maxY); lane++) {
+                entries[fill[lane]++] = {item.minX, i};
+                laneMaxWidth[lane] = std::max(laneMaxWidth[lane], item.maxX - item.minX);
+            }
+        }
+        for (int lane = 0; lane < laneCount; lane++) {
+            std::sort(entries.begin() + laneStart[lane], entries.begin() + laneStart[lane + 1],
+                      [](const Entry& a, const Entry& b) { return a.minX < b.minX || (a.minX == b.minX && a.item < b.item); });
+        }
+        seen.assign(items.size(), 0);
+    }
+
+    // Closest item to the point (distance to its box, 0 inside), or -1.
+    int Nearest(float px, float py, float* distance = nullptr) const {
+        const float inf = std::numeric_limits<float>::infinity();
+        float best = inf;  // squared
+        int bestItem = -1;
+        int home = LaneOf(py);
+        for (int ring = 0; ring < laneCount; ring++) {
+            float ringGap = ring == 0 ? 0.0f : std::min(LaneGap(home - ring, py), LaneGap(home + ring, py));
+            if (ringGap * ringGap > best) break;
+            for (int side = 0; side < (ring == 0 ? 1 : 2); side++) {
+                int lane = side == 0 ? home - ring : home + ring;
+                if (lane < 0 || lane >= laneCount) continue;
+                float gap = LaneGap(lane, py);
+                if (gap * gap > best) continue;
+                ScanLane(lane, px, py, best, bestItem);
+            }
+        }
+        if (distance) *distance = bestItem < 0 ? inf : std::sqrt(best);
+        return bestItem;
+    }
+
+    // Everything a beam running right from x0 between y0 and y1 passes
+    // through, nearest first.
+    void RayCastRight(float x0, float y0, float y1, std::vector<SpatialHit>& out) const {
+        out.clear();
+        NextStamp();
+        for (int lane = LaneOf(y0); lane <= LaneOf(y1); lane++) {
+            for (int e = laneStart[lane]; e < laneStart[lane + 1]; e++) {
+                int i = entries[e].item;
+                const SpatialItem& item = items[i];
+                if (item.maxX <= x0 || item.maxY <= y0 || item.minY >= y1 || seen[i] == stamp) continue;
+                seen[i] = stamp;
+                out.push_back({i, std::max(0.0f, item.minX - x0)});
+            }
+        }
+        std::sort(out.begin(), out.end(), [](const SpatialHit& a, const SpatialHit& b) {
+            return a.distance < b.distance || (a.distance == b.distance && a.item < b.item);
+        });
+    }
+
+    // Items whose box overlaps the given one, in item order.
+    void Overlapping(float x, float y, float width, float height, std::vector<int>& out) const {
+        out.clear();
+        NextStamp();
+        float x1 = x + width;
+        float y1 = y + height;
+        for (int lane = LaneOf(y); lane <= LaneOf(y1); lane++) {
+            int begin = LowerBound(lane, x - laneMaxWidth[lane]);
+            for (int e = begin; e < laneStart[lane + 1] && entries[e].minX < x1; e++) {
+                int i = entries[e].item;
+                const SpatialItem& item = items[i];
+                if (item.maxX <= x || item.maxY <= y || item.minY >= y1 || seen[i] == stamp) continue;
+                seen[i] = stamp;
+                out.push_back(i);
+            }
+        }
+        std::sort(out.begin(), out.end());
+    }
+
+private:
+    struct Entry {
+        float minX;
+        int item;
+    };
+
+    float laneHeight;
+    int laneCount;
+    std::vector<SpatialItem> items;
+    std::vector<Entry> entries;        // per lane, sorted by minX
+    std::vector<int> laneStart;        // laneCount + 1 offsets into entries
+    std::vector<float> laneMaxWidth;   // widest box in each lane
+    mutable std::vector<unsigned> seen;
+    mutable unsigned stamp;
+
+    int LaneOf(float y) const {
+        int lane = (int)std::floor(y / laneHeight);
+        return std::max(0, std::min(laneCount - 1, lane));
+    }
+
+    // Vertical distance from y to the lane's band; edge lanes are open-ended.
+    float LaneGap(int lane, float y) const {
+        if (lane < 0 || lane >= laneCount) return std::numeric_limits<float>::infinity();
+        float top = lane == 0 ? -std::numeric_limits<float>::infinity() : lane * laneHeight;
+        float bottom = lane == laneCount - 1 ? std::numeric_limits<float>::infinity() : (lane + 1) * laneHeight;
+        if (y < top) return top - y;
+        if (y > bottom) return y - bottom;
+        return 0.0f;
+    }
+
+    int LowerBound(int lane, float x) const {
+        auto first = entries.begin() + laneStart[lane];
+        auto last = entries.begin() + laneStart[lane + 1];
+        return (int)(std::lower_bound(first, last, x, [](const Entry& e, float v) { return e.minX < v; }) - entries.begin());
+    }
+
+    void Consider(int i, float px, float py, float& best, int& bestItem) const {
+        const SpatialItem& item = items[i];
+        float dx = std::max(std::max(item.minX - px, px - item.maxX), 0.0f);
+        float dy = std::max(std::max(item.minY - py, py - item.maxY), 0.0f);
+        float d = dx * dx + dy * dy;
+        if (d < best || (d == best && i < bestItem)) {
+            best = d;
+            bestItem = i;
+        }
+    }
+
+    // Walks right from px until left edges are too far, then left until even
+    // the lane's widest box could not reach back to px.
+    void ScanLane(int lane, float px, float py, float& best, int& bestItem) const {
+        int split = LowerBound(lane, px);
+        for (int e = split; e < laneStart[lane + 1]; e++) {
+            float dx = entries[e].minX - px;
+            if (dx * dx > best) break;
+            Consider(entries[e].item, px, py, best, bestItem);
+        }
+        float reach = laneMaxWidth[lane];
+        for (int e = split - 1; e >= laneStart[lane]; e--) {
+            float dx = px - (entries[e].minX + reach);
+            if (dx > 0.0f && dx * dx > best) break;
+            Consider(entries[e].item, px, py, best, bestItem);
+        }
+    }
+
+    void NextStamp() const {
+        if (++stamp == 0) {
+            std::fill(seen.begin(), seen.end(), 0);
+            stamp = 1;
+        }
+    }
+};
+
+#endif
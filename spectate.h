@@ -0,0 +1,644 @@
+#ifndef SPECTATE_H
+#define SPECTATE_H
+
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "spsc.h"
+
+#if !defined(_WIN32)
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+//#####################
+//Spectator stream
+//#####################
+// Other processes can watch a game over TCP on localhost. Obstacles and
+// bullets move in straight lines, so the stream carries events instead of
+// positions: spawns, removals, the ship, the score, and each tick's frame time.
+// The viewer moves everything itself with the same float arithmetic as the
+// game. The server keeps a model of what viewers have and only sends a
+// correction when the game and the model disagree. Each tick is encoded once
+// on the game thread. A network thread then queues that same buffer for every
+// client, so adding clients adds no encoding or copying. Sent frames go back
+// to the game thread through a second ring and are encoded into again. A
+// client that connects gets a keyframe with the full model first.
+
+//---------------------
+// Protocol
+//---------------------
+// Frame: u32 payload length, then u8 type, u32 tick, f32 dt, then records.
+// Integers are little-endian, ids are varints.
+
+enum SpectatorFrameType : uint8_t { SPECTATE_DELTA = 1, SPECTATE_KEY = 2 };
+
+enum SpectatorRecord : uint8_t {
+    SPECTATE_SPAWN = 1,   // id, u8 kind, f32 x y w h vx
+    SPECTATE_REMOVE,      // id
+    SPECTATE_MOVE,        // id, f32 x y
+    SPECTATE_SHIP,        // f32 x y w h
+    SPECTATE_SCORE,       // zigzag varint
+    SPECTATE_SCREEN,      // u8
+};
+
+static const uint8_t SPECTATE_BULLET = 255;  // entity kind for bullets
+
+class ByteWriter {
+public:
+    std::vector<uint8_t>& out;
+    explicit ByteWriter(std::vector<uint8_t>& out) : out(out) {}
+
+    void U8(uint8_t v) { out.push_back(v); }
+    void U32(uint32_t v) {
+        for (int i = 0; i < 4; i++) out.push_back((uint8_t)(v >> (8 * i)));
+    }
+    void F32(float v) {
+        uint32_t bits;
+        memcpy(&bits, &v, 4);
+        U32(bits);
+    }
+    void Var(uint32_t v) {
+        while (v >= 0x80) {
+            out.push_back((uint8_t)(v | 0x80));
+            v >>= 7;
+        }
+        out.push_back((uint8_t)v);
+    }
+};
+
+class ByteReader {
+public:
+    ByteReader(const uint8_t* data, size_t size) : p(data), end(data + size), ok(true) {}
+
+    bool Ok() const { return ok; }
+    bool Done() const { return p >= end; }
+
+    uint8_t U8() { return Need(1) ? *p++ : 0; }
+    uint32_t U32() {
+        if (!Need(4)) return 0;
+        uint32_t v = p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+        p += 4;
+        return v;
+    }
+    float F32() {
+        uint32_t bits = U32();
+        float v;
+        memcpy(&v, &bits, 4);
+        return v;
+    }
+    uint32_t Var() {
+        uint32_t v = 0;
+        for (int shift = 0; shift < 35; shift += 7) {
+            uint8_t b = U8();
+            v |= (uint32_t)(b & 0x7f) << shift;
+            if (!(b & 0x80)) return v;
+        }
+        ok = false;
+        return 0;
+    }
+
+private:
+    const uint8_t* p;
+    const uint8_t* end;
+    bool ok;
+
+    bool Need(size_t n) {
+        if ((size_t)(end - p) < n) ok = false;
+        return ok;
+    }
+};
+
+struct SpectatorEntity {
+    uint8_t kind;
+    float x, y, w, h, vx;
+};
+
+// What a viewer knows. The server keeps one too, to decide what to send.
+class SpectatorModel {
+public:
+    std::unordered_map<uint32_t, SpectatorEntity> entities;
+    float shipX = 0, shipY = 0, shipW = 0, shipH = 0;
+    int score = 0;
+    uint8_t screen = 0;
+    uint32_t tick = 0;
+    bool synced = false;  // a keyframe has been applied
+
+    // Every entity moves by dt, then the records apply.
+    void Advance(float dt) {
+        for (auto& entry : entities) entry.second.x += entry.second.vx * dt;
+    }
+
+    // Applies one frame payload. False if it is malformed.
+    bool Apply(const uint8_t* data, size_t size) {
+        ByteReader in(data, size);
+        uint8_t type = in.U8();
+        uint32_t frameTick = in.U32();
+        float dt = in.F32();
+        if (!in.Ok()) return false;
+        if (type == SPECTATE_KEY) {
+            entities.clear();
+            synced = true;
+        } else if (type == SPECTATE_DELTA) {
+            if (!synced) return true;
+            Advance(dt);
+        } else {
+            return false;
+        }
+        tick = frameTick;
+        while (!in.Done() && in.Ok()) {
+            switch (in.U8()) {
+                case SPECTATE_SPAWN: {
+                    uint32_t id = in.Var();
+                    SpectatorEntity& e = entities[id];
+                    e.kind = in.U8();
+                    e.x = in.F32();
+                    e.y = in.F32();
+                    e.w = in.F32();
+                    e.h = in.F32();
+                    e.vx = in.F32();
+                } break;
+                case SPECTATE_REMOVE:
+                    entities.erase(in.Var());
+                    break;
+                case SPECTATE_MOVE: {
+                    uint32_t id = in.Var();
+                    float x = in.F32(), y = in.F32();
+                    auto it = entities.find(id);
+                    if (it != entities.end()) {
+                        it->second.x = x;
+                        it->second.y = y;
+                    }
+                } break;
+                case SPECTATE_SHIP:
+                    shipX = in.F32();
+                    shipY = in.F32();
+                    shipW = in.F32();
+                    shipH = in.F32();
+                    break;
+                case SPECTATE_SCORE: {
+                    uint32_t z = in.Var();
+                    score = (int)(z >> 1) ^ -(int)(z & 1);
+                } break;
+                case SPECTATE_SCREEN:
+                    screen = in.U8();
+                    break;
+                default:
+                    return false;
+            }
+        }
+        return in.Ok();
+    }
+
+    // Independent of map order, so server and viewer hashes compare.
+    uint64_t Hash() const {
+        uint64_t sum = 0;
+        for (const auto& entry : entities) {
+            const SpectatorEntity& e = entry.second;
+            uint64_t h = 0xcbf29ce484222325ull ^ entry.first;
+            float fields[5] = {e.x, e.y, e.w, e.h, e.vx};
+            for (float f : fields) {
+                uint32_t bits;
+                memcpy(&bits, &f, 4);
+                h = (h ^ bits) * 0x100000001b3ull;
+            }
+            sum += (h ^ e.kind) * 0x9E3779B97F4A7C15ull;
+        }
+        float ship[4] = {shipX, shipY, shipW, shipH};
+        for (float f : ship) {
+            uint32_t bits;
+            memcpy(&bits, &f, 4);
+            sum = (sum ^ bits) * 0x100000001b3ull;
+        }
+        return (sum ^ (uint32_t)score ^ ((uint64_t)screen << 32)) * 0x100000001b3ull;
+    }
+};
+
+//---------------------
+// Encoding
+//---------------------
+
+struct SpectatorFrame {
+    std::vector<uint8_t> bytes;  // length prefix included
+    bool key = false;
+    int refs = 0;  // client queues holding it, network thread only
+};
+
+// Builds one frame. Each record is applied to the model as it is written, so
+// the model always matches what viewers will have.
+class SpectatorEncoder {
+public:
+    SpectatorModel model;
+
+    void Begin(SpectatorFrame& frame, SpectatorFrameType type, uint32_t tick, float dt) {
+        out = &frame.bytes;
+        out->clear();
+        frame.key = type == SPECTATE_KEY;
+        ByteWriter w(*out);
+        w.U32(0);
+        w.U8(type);
+        w.U32(tick);
+        w.F32(dt);
+        model.tick = tick;
+    }
+
+    void Spawn(uint32_t id, const SpectatorEntity& e) {
+        ByteWriter w(*out);
+        w.U8(SPECTATE_SPAWN);
+        w.Var(id);
+        w.U8(e.kind);
+        w.F32(e.x);
+        w.F32(e.y);
+        w.F32(e.w);
+        w.F32(e.h);
+        w.F32(e.vx);
+        model.entities[id] = e;
+    }
+
+    void Remove(uint32_t id) {
+        ByteWriter w(*out);
+        w.U8(SPECTATE_REMOVE);
+        w.Var(id);
+        model.entities.erase(id);
+    }
+
+    void Move(uint32_t id, float x, float y) {
+        ByteWriter w(*out);
+        w.U8(SPECTATE_MOVE);
+        w.Var(id);
+        w.F32(x);
+        w.F32(y);
+        SpectatorEntity& e = model.entities[id];
+        e.x = x;
+        e.y = y;
+    }
+
+    void Ship(float x, float y, float width, float height) {
+        ByteWriter w(*out);
+        w.U8(SPECTATE_SHIP);
+        w.F32(x);
+        w.F32(y);
+        w.F32(width);
+        w.F32(height);
+        model.shipX = x;
+        model.shipY = y;
+        model.shipW = width;
+        model.shipH = height;
+    }
+
+    void Score(int score) {
+        ByteWriter w(*out);
+        w.U8(SPECTATE_SCORE);
+        w.Var(((uint32_t)score << 1) ^ (uint32_t)(score >> 31));
+        model.score = score;
+    }
+
+    void Screen(uint8_t screen) {
+        ByteWriter w(*out);
+        w.U8(SPECTATE_SCREEN);
+        w.U8(screen);
+        model.screen = screen;
+    }
+
+    void End() {
+        uint32_t payload = (uint32_t)(out->size() - 4);
+        for (int i = 0; i < 4; i++) (*out)[i] = (uint8_t)(payload >> (8 * i));
+        out = nullptr;
+    }
+
+    // Everything the model holds, for a client that just joined.
+    void Keyframe(SpectatorFrame& frame) {
+        Begin(frame, SPECTATE_KEY, model.tick, 0.0f);
+        SpectatorModel copy = model;
+        for (const auto& entry : copy.entities) Spawn(entry.first, entry.second);
+        Ship(copy.shipX, copy.shipY, copy.shipW, copy.shipH);
+        Score(copy.score);
+        Screen(copy.screen);
+        End();
+    }
+
+private:
+    std::vector<uint8_t>* out = nullptr;
+};
+
+//---------------------
+// Transport
+//---------------------
+
+struct SpectatorServerMetrics {
+    int clients = 0;
+    long framesSent = 0;       // frame deliveries, counted per client
+    long bytesSent = 0;
+    long clientsDropped = 0;   // fell too far behind
+    long framesDropped = 0;    // network thread fell behind; everyone resyncs
+};
+
+class SpectatorServer {
+public:
+    int maxQueuedFrames;  // per client before it is dropped
+
+    SpectatorServer()
+        : maxQueuedFrames(600), ring(256), spare(1024), unsent(nullptr), running(false), resync(false), keyWanted(0) {}
+    ~SpectatorServer() { Stop(); }
+
+    bool Running() const { return running; }
+    int Port() const { return port; }
+
+    SpectatorServerMetrics Metrics() const {
+        SpectatorServerMetrics m;
+        m.clients = clients.load(std::memory_order_relaxed);
+        m.framesSent = framesSent.load(std::memory_order_relaxed);
+        m.bytesSent = bytesSent.load(std::memory_order_relaxed);
+        m.clientsDropped = clientsDropped.load(std::memory_order_relaxed);
+        m.framesDropped = framesDropped.load(std::memory_order_relaxed);
+        return m;
+    }
+
+    // Game thread: true when some client is waiting for a keyframe.
+    bool WantsKeyframe() const { return keyWanted.load(std::memory_order_acquire) > 0; }
+
+#if defined(_WIN32)
+    bool Start(int, std::string& error) {
+        error = "spectating is not supported on Windows";
+        return false;
+    }
+    void Stop() {}
+    SpectatorFrame* Frame() { return new SpectatorFrame; }
+    void Publish(SpectatorFrame* frame) { delete frame; }
+#else
+    // Listens on 127.0.0.1; port 0 picks a free one, see Port().
+    bool Start(int listenPort, std::string& error) {
+        listener = socket(AF_INET, SOCK_STREAM, 0);
+        if (listener < 0) {
+            error = strerror(errno);
+            return false;
+        }
+        int yes = 1;
+        setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes));
+        sockaddr_in addr = {};
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        addr.sin_port = htons((uint16_t)listenPort);
+        socklen_t len = sizeof(addr);
+        if (bind(listener, (sockaddr*)&addr, sizeof(addr)) < 0 || listen(listener, 64) < 0 ||
+            getsockname(listener, (sockaddr*)&addr, &len) < 0 || pipe(wakePipe) < 0) {
+            error = strerror(errno);
+            close(listener);
+            return false;
+        }
+        port = ntohs(addr.sin_port);
+        fcntl(listener, F_SETFL, O_NONBLOCK);
+        fcntl(wakePipe[0], F_SETFL, O_NONBLOCK);
+        fcntl(wakePipe[1], F_SETFL, O_NONBLOCK);
+        running = true;
+        worker = std::thread([this] { Serve(); });
+        return true;
+    }
+
+    void Stop() {
+        if (!running) return;
+        running = false;
+        Wake();
+        worker.join();
+        SpectatorFrame* frame = nullptr;
+        while (ring.Pop(&frame, 1)) delete frame;
+        while (spare.Pop(&frame, 1)) delete frame;
+        delete unsent;
+        unsent = nullptr;
+        close(listener);
+        close(wakePipe[0]);
+        close(wakePipe[1]);
+    }
+
+    // Game thread. A frame to encode into, recycled once every client has
+    // sent it; only allocates until enough frames are in circulation.
+    SpectatorFrame* Frame() {
+        SpectatorFrame* frame = unsent;
+        unsent = nullptr;
+        if (frame || spare.Pop(&frame, 1)) return frame;
+        return new SpectatorFrame;
+    }
+
+    // Game thread. Takes ownership of a frame from Frame().
+    void Publish(SpectatorFrame* frame) {
+        if (!running) {
+            delete frame;
+            return;
+        }
+        if (ring.Push(&frame, 1) == 0) {
+            // Kept for the next Frame() instead of freed here.
+            unsent = frame;
+            framesDropped.fetch_add(1, std::memory_order_relaxed);
+            resync.store(true, std::memory_order_release);
+            return;
+        }
+        Wake();
+    }
+#endif
+
+private:
+    struct Client {
+        int fd;
+        bool live;  // has had its keyframe
+        std::deque<SpectatorFrame*> queue;
+        size_t offset;  // into the front frame
+    };
+
+    SpscRing<SpectatorFrame*> ring;   // game thread to network thread
+    SpscRing<SpectatorFrame*> spare;  // network thread back to game thread
+    SpectatorFrame* unsent;           // game thread, did not fit in the ring
+    std::atomic<bool> running;
+    std::atomic<bool> resync;
+    std::atomic<int> keyWanted;
+    std::atomic<int> clients{0};
+    std::atomic<long> framesSent{0}, bytesSent{0}, clientsDropped{0}, framesDropped{0};
+    std::thread worker;
+    int listener = -1;
+    int wakePipe[2] = {-1, -1};
+    int port = 0;
+
+#if !defined(_WIN32)
+    void Wake() {
+        char b = 1;
+        ssize_t ignored = write(wakePipe[1], &b, 1);
+        (void)ignored;
+    }
+
+    void Serve() {
+        std::vector<Client> list;
+        std::vector<pollfd> fds;
+        while (running) {
+            fds.clear();
+            fds.push_back({listener, POLLIN, 0});
+            fds.push_back({wakePipe[0], POLLIN, 0});
+            for (const Client& c : list) fds.push_back({c.fd, (short)(c.queue.empty() ? 0 : POLLOUT), 0});
+            poll(fds.data(), fds.size(), 100);
+
+            char drain[64];
+            while (read(wakePipe[0], drain, sizeof(drain)) > 0) {}
+
+            for (;;) {
+                int fd = accept(listener, nullptr, nullptr);
+                if (fd < 0) break;
+                fcntl(fd, F_SETFL, O_NONBLOCK);
+                int yes = 1;
+                setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &yes, sizeof(yes));
+                list.push_back({fd, false, {}, 0});
+                keyWanted.fetch_add(1, std::memory_order_release);
+            }
+
+            // A dropped frame leaves every viewer behind; start them all over.
+            if (resync.exchange(false, std::memory_order_acq_rel)) {
+                for (Client& c : list) {
+                    if (!c.live) continue;
+                    c.live = false;
+                    keyWanted.fetch_add(1, std::memory_order_release);
+                }
+            }
+
+            SpectatorFrame* frame;
+            while (ring.Pop(&frame, 1)) {
+                frame->refs = 1;  // held until every client has it queued
+                for (Client& c : list) {
+                    if (frame->key == c.live) continue;
+                    if (frame->key) {
+                        c.live = true;
+                        keyWanted.fetch_sub(1, std::memory_order_release);
+                    }
+                    frame->refs++;
+                    c.queue.push_back(frame);
+                }
+                Release(frame);
+            }
+
+            for (size_t i = 0; i < list.size();) {
+                if (Flush(list[i]) && (int)list[i].queue.size() <= maxQueuedFrames) {
+                    i++;
+                    continue;
+                }
+                if ((int)list[i].queue.size() > maxQueuedFrames) clientsDropped.fetch_add(1, std::memory_order_relaxed);
+                if (!list[i].live) keyWanted.fetch_sub(1, std::memory_order_release);
+                for (SpectatorFrame* queued : list[i].queue) Release(queued);
+                close(list[i].fd);
+                list[i] = std::move(list.back());
+                list.pop_back();
+            }
+            clients.store((int)list.size(), std::memory_order_relaxed);
+        }
+        for (Client& c : list) {
+            for (SpectatorFrame* queued : c.queue) Release(queued);
+            close(c.fd);
+        }
+        keyWanted.store(0);
+        clients.store(0);
+    }
+
+    // Hands a frame back to the game thread once no client holds it.
+    void Release(SpectatorFrame* frame) {
+        if (--frame->refs > 0) return;
+        if (spare.Push(&frame, 1) == 0) delete frame;
+    }
+
+    // Sends straight out of the shared buffers. False if the client is gone.
+    bool Flush(Client& c) {
+        while (!c.queue.empty()) {
+            const std::vector<uint8_t>& bytes = c.queue.front()->bytes;
+            ssize_t n = send(c.fd, bytes.data() + c.offset, bytes.size() - c.offset, MSG_NOSIGNAL);
+            if (n < 0) return errno == EAGAIN || errno == EWOULDBLOCK;
+            bytesSent.fetch_add(n, std::memory_order_relaxed);
+            c.offset += n;
+            if (c.offset < bytes.size()) return true;
+            c.offset = 0;
+            Release(c.queue.front());
+            c.queue.pop_front();
+            framesSent.fetch_add(1, std::memory_order_relaxed);
+        }
+        return true;
+    }
+#endif
+};
+
+class SpectatorClient {
+public:
+    SpectatorClient() : fd(-1) {}
+    ~SpectatorClient() { Close(); }
+
+    bool Connected() const { return fd >= 0; }
+
+#if defined(_WIN32)
+    bool Connect(const char*, int, std::string& error) {
+        error = "spectating is not supported on Windows";
+        return false;
+    }
+    void Close() {}
+    int Poll(SpectatorModel&) { return -1; }
+#else
+    bool Connect(const char* host, int port, std::string& error) {
+        fd = socket(AF_INET, SOCK_STREAM, 0);
+        sockaddr_in addr = {};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons((uint16_t)port);
+        if (fd < 0 || inet_pton(AF_INET, host, &addr.sin_addr) != 1 || connect(fd, (sockaddr*)&addr, sizeof(addr)) < 0) {
+            error = strerror(errno);
+            Close();
+            return false;
+        }
+        fcntl(fd, F_SETFL, O_NONBLOCK);
+        return true;
+    }
+
+    void Close() {
+        if (fd >= 0) close(fd);
+        fd = -1;
+    }
+
+    // Reads whatever has arrived and applies every complete frame. Returns
+    // the number applied, or -1 once the stream is closed or malformed.
+    int Poll(SpectatorModel& model) {
+        if (fd < 0) return -1;
+        uint8_t chunk[16384];
+        for (;;) {
+            ssize_t n = recv(fd, chunk, sizeof(chunk), 0);
+            if (n > 0) {
+                pending.insert(pending.end(), chunk, chunk + n);
+                continue;
+            }
+            if (n == 0 || (errno != EAGAIN && errno != EWOULDBLOCK)) {
+                Close();
+            }
+            break;
+        }
+        int applied = 0;
+        size_t at = 0;
+        while (pending.size() - at >= 4) {
+            uint32_t length = pending[at] | (pending[at + 1] << 8) | (pending[at + 2] << 16) | ((uint32_t)pending[at + 3] << 24);
+            if (pending.size() - at - 4 < length) break;
+            if (!model.Apply(pending.data() + at + 4, length)) {
+                Close();
+                return -1;
+            }
+            at += 4 + length;
+            applied++;
+        }
+        pending.erase(pending.begin(), pending.begin() + at);
+        return applied == 0 && fd < 0 ? -1 : applied;
+    }
+#endif
+
+private:
+    int fd;
+    std::vector<uint8_t> pending;
+};
+
+#endif
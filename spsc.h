@@ -0,0 +1,48 @@
+#ifndef SPSC_H
+#define SPSC_H
+
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+//#####################
+//Lock-free ring
+//#####################
+
+// Single producer, single consumer. Capacity must be a power of two.
+template <typename T>
+class SpscRing {
+public:
+    explicit SpscRing(size_t capacity) : buffer(capacity), mask(capacity - 1), head(0), tail(0) {}
+
+    size_t Capacity() const { return buffer.size(); }
+    size_t Available() const { return head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire); }
+
+    // Producer side. Returns how many items were taken.
+    size_t Push(const T* items, size_t n) {
+        size_t h = head.load(std::memory_order_relaxed);
+        size_t free = buffer.size() - (h - tail.load(std::memory_order_acquire));
+        if (n > free) n = free;
+        for (size_t i = 0; i < n; i++) buffer[(h + i) & mask] = items[i];
+        head.store(h + n, std::memory_order_release);
+        return n;
+    }
+
+    // Consumer side. Returns how many items were copied out.
+    size_t Pop(T* out, size_t n) {
+        size_t t = tail.load(std::memory_order_relaxed);
+        size_t ready = head.load(std::memory_order_acquire) - t;
+        if (n > ready) n = ready;
+        for (size_t i = 0; i < n; i++) out[i] = buffer[(t + i) & mask];
+        tail.store(t + n, std::memory_order_release);
+        return n;
+    }
+
+private:
+    std::vector<T> buffer;
+    size_t mask;
+    alignas(64) std::atomic<size_t> head;
+    alignas(64) std::atomic<size_t> tail;
+};
+
+#endif
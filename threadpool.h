@@ -0,0 +1,111 @@
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+//#####################
+//Thread pool
+//#####################
+// Fixed set of workers pulling jobs off one queue. The destructor finishes
+// whatever is queued before joining.
+
+class ThreadPool {
+public:
+    explicit ThreadPool(int threads = 0) : busy(0), stopping(false) {
+        if (threads <= 0) threads = (int)std::thread::hardware_concurrency();
+        if (threads <= 0) threads = 1;
+        for (int i = 0; i < threads; i++) {
+            workers.emplace_back([this, i]() { Run(i); });
+        }
+    }
+
+    ~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (std::thread& worker : workers) worker.join();
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    int Size() const { return (int)workers.size(); }
+
+    // Job receives the index of the worker running it.
+    void Submit(std::function<void(int)> job) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            jobs.push_back(std::move(job));
+        }
+        wake.notify_one();
+    }
+
+    void WaitIdle() {
+        std::unique_lock<std::mutex> lock(mutex);
+        idle.wait(lock, [this]() { return jobs.empty() && busy == 0; });
+    }
+
+    // Splits [0, count) into `pieces` contiguous ranges and returns once all
+    // have run. The calling thread takes the last range itself. Only waits
+    // for its own ranges, so other jobs may share the pool.
+    void ParallelFor(int count, int pieces, const std::function<void(int, int)>& body) {
+        if (pieces > count) pieces = count;
+        if (pieces <= 1) {
+            if (count > 0) body(0, count);
+            return;
+        }
+        std::mutex doneMutex;
+        std::condition_variable doneSignal;
+        int remaining = pieces - 1;
+        for (int piece = 0; piece < pieces - 1; piece++) {
+            int begin = (int)((long long)count * piece / pieces);
+            int end = (int)((long long)count * (piece + 1) / pieces);
+            Submit([&, begin, end](int) {
+                body(begin, end);
+                std::lock_guard<std::mutex> lock(doneMutex);
+                if (--remaining == 0) doneSignal.notify_one();
+            });
+        }
+        body((int)((long long)count * (pieces - 1) / pieces), count);
+        std::unique_lock<std::mutex> lock(doneMutex);
+        doneSignal.wait(lock, [&]() { return remaining == 0; });
+    }
+
+private:
+    std::vector<std::thread> workers;
+    std::deque<std::function<void(int)>> jobs;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable idle;
+    int busy;
+    bool stopping;
+
+    void Run(int index) {
+        for (;;) {
+            std::function<void(int)> job;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                wake.wait(lock, [this]() { return stopping || !jobs.empty(); });
+                if (jobs.empty()) return;
+                job = std::move(jobs.front());
+                jobs.pop_front();
+                busy++;
+            }
+            job(index);
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                busy--;
+                if (jobs.empty() && busy == 0) idle.notify_all();
+            }
+        }
+    }
+};
+
+#endif
@@ -0,0 +1,373 @@
+#ifndef TUNING_H
+#define TUNING_H
+
+#include <raylib.h>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+#include "fileutil.h"
+#include "spsc.h"
+
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+//#####################
+//Tuning
+//#####################
+// Gameplay numbers read from a text file of `key = value` lines and read
+// again whenever it changes. A watcher thread waits on inotify for the file's
+// directory (editors often replace a file rather than rewrite it). It parses
+// the text into a TuningParams and pushes a copy onto a ring. At the start of
+// a tick the frame thread copies the newest block off the ring into the
+// game's own, so it never locks or allocates and nothing stays shared. A file
+// with any error is rejected whole and the game keeps the block it has. Keys
+// the file leaves out keep their built-in values.
+
+static const int TUNING_KINDS = 5;
+static const char* const TUNING_KIND_NAMES[TUNING_KINDS] = {"star", "polri", "opm", "gibran", "ma"};
+static const int TUNING_ERRORS_SHOWN = 8;
+
+struct KindTuning {
+    float interval;          // s between timer spawns, also sets the kind's rate in the level
+    int points;              // for a kill; a miss costs as much
+    float weight;            // share of the level generator's spawns
+    int vxMin, vxMax;        // in units of 1 / vxDivisor px/s, negative is leftwards
+    float vxDivisor;
+    int scaleMin, scaleMax;  // in units of 1 / scaleDivisor
+    float scaleDivisor;
+};
+
+struct TuningParams {
+    float shipAcceleration = 1500.0f;  // px/s^2
+    float shipDeceleration = 1500.0f;
+    float bulletSpeed = 500.0f;  // px/s
+    int bossPartPoints = 1;
+    KindTuning kinds[TUNING_KINDS] = {
+        {1.0f, 1, 60.0f, -2000, -1000, 10.0f, 20, 50, 100.0f},
+        {2.0f, 2, 30.0f, -2000, -1000, 10.0f, 20, 50, 500.0f},
+        {3.0f, 3, 20.0f, -2000, -1000, 10.0f, 20, 50, 100.0f},
+        {4.0f, 4, 15.0f, -2000, -1000, 10.0f, 20, 30, 100.0f},
+        {5.0f, 5, 12.0f, -2000, -1000, 10.0f, 20, 50, 500.0f},
+    };
+    int64_t seenNs = 0;  // steady clock when the change was noticed, 0 for the built-in block
+};
+
+// Reads numbers off the rest of a line; false if there are not exactly n.
+inline bool TuningNumbers(const char* text, double* out, int n) {
+    for (int i = 0; i < n; i++) {
+        char* end;
+        out[i] = strtod(text, &end);
+        if (end == text || !std::isfinite(out[i])) return false;
+        text = end;
+    }
+    while (*text == ' ' || *text == '\t' || *text == '\r') text++;
+    return *text == '\0';
+}
+
+// Fills out from the built-in values and the file's text. Every problem goes
+// into errors as "name:line: what"; out is only usable if there are none.
+inline bool ParseTuning(const std::string& text, const std::string& name, TuningParams& out,
+                        std::vector<std::string>& errors) {
+    out = TuningParams();
+    float weights = 0.0f;
+    size_t at = 0;
+    for (int line = 1; at <= text.size(); line++) {
+        size_t end = text.find('\n', at);
+        if (end == std::string::npos) end = text.size();
+        std::string row = text.substr(at, end - at);
+        at = end + 1;
+        size_t hash = row.find('#');
+        if (hash != std::string::npos) row.resize(hash);
+        size_t first = row.find_first_not_of(" \t\r");
+        if (first == std::string::npos) continue;
+
+        auto fail = [&](const std::string& what) { errors.push_back(name + ":" + std::to_string(line) + ": " + what); };
+        size_t equals = row.find('=');
+        if (equals == std::string::npos) {
+            fail("expected key = value");
+            continue;
+        }
+        std::string key = row.substr(first, equals - first);
+        key.erase(key.find_last_not_of(" \t") + 1);
+        const char* value = row.c_str() + equals + 1;
+        double v[2];
+
+        if (key == "ship.acceleration" || key == "ship.deceleration" || key == "bullet.speed") {
+            if (!TuningNumbers(value, v, 1) || v[0] <= 0.0) {
+                fail(key + " needs a number above 0");
+                continue;
+            }
+            if (key == "ship.acceleration") out.shipAcceleration = (float)v[0];
+            if (key == "ship.deceleration") out.shipDeceleration = (float)v[0];
+            if (key == "bullet.speed") out.bulletSpeed = (float)v[0];
+            continue;
+        }
+        if (key == "boss.points") {
+            if (!TuningNumbers(value, v, 1) || v[0] < 0.0 || v[0] != std::floor(v[0]) || v[0] > 1000000.0) {
+                fail(key + " needs a whole number of 0 or more");
+                continue;
+            }
+            out.bossPartPoints = (int)v[0];
+            continue;
+        }
+
+        size_t dot = key.find('.');
+        int kind = -1;
+        for (int k = 0; k < TUNING_KINDS; k++) {
+            if (dot != std::string::npos && key.compare(0, dot, TUNING_KIND_NAMES[k]) == 0 &&
+                dot == strlen(TUNING_KIND_NAMES[k])) {
+                kind = k;
+            }
+        }
+        std::string field = dot == std::string::npos ? "" : key.substr(dot + 1);
+        if (kind < 0) {
+            fail("unknown key '" + key + "'");
+            continue;
+        }
+        KindTuning& t = out.kinds[kind];
+        if (field == "interval") {
+            if (!TuningNumbers(value, v, 1) || v[0] <= 0.0) {
+                fail(key + " needs seconds above 0");
+                continue;
+            }
+            t.interval = (float)v[0];
+        } else if (field == "points") {
+            if (!TuningNumbers(value, v, 1) || v[0] < 0.0 || v[0] != std::floor(v[0]) || v[0] > 1000000.0) {
+                fail(key + " needs a whole number of 0 or more");
+                continue;
+            }
+            t.points = (int)v[0];
+        } else if (field == "weight") {
+            if (!TuningNumbers(value, v, 1) || v[0] < 0.0) {
+                fail(key + " needs a number of 0 or more");
+                continue;
+            }
+            t.weight = (float)v[0];
+        } else if (field == "speed") {
+            // px/s, slowest first; kept in the kind's own steps like the spawn code draws them.
+            if (!TuningNumbers(value, v, 2) || v[0] < 0.1 || v[0] > v[1] || v[1] > 100000.0) {
+                fail(key + " needs two speeds in px/s, at least 0.1 and slowest first");
+                continue;
+            }
+            t.vxMin = -(int)std::lround(v[1] * t.vxDivisor);
+            t.vxMax = -(int)std::lround(v[0] * t.vxDivisor);
+        } else if (field == "scale") {
+            // Kept in the kind's own steps, so the built-in values draw the
+            // same random numbers as before.
+            long lo = TuningNumbers(value, v, 2) ? std::lround(v[0] * t.scaleDivisor) : 0;
+            long hi = lo > 0 ? std::lround(v[1] * t.scaleDivisor) : 0;
+            if (lo < 1 || hi < lo || hi > 1000000) {
+                char least[32];
+                snprintf(least, sizeof(least), "%g", 1.0 / t.scaleDivisor);
+                fail(key + " needs two scales, smallest first, each at least " + least);
+                continue;
+            }
+            t.scaleMin = (int)lo;
+            t.scaleMax = (int)hi;
+        } else {
+            fail("unknown key '" + key + "'");
+        }
+    }
+    for (const KindTuning& t : out.kinds) weights += t.weight;
+    if (weights <= 0.0f) errors.push_back(name + ": at least one weight must be above 0");
+    return errors.empty();
+}
+
+struct TuningMetrics {
+    long loads;       // files parsed and handed over
+    long rejected;    // files with errors
+    long adopted;     // blocks the game switched to
+    double parseMs;   // last load
+    double adoptMs;   // last change noticed to picked up at a tick
+    double adoptMaxMs;
+};
+
+class TuningWatcher {
+public:
+    bool log = true;  // loads and errors go to TraceLog
+
+    TuningWatcher() : loaded(4), waiting(false), running(false), inotifyFd(-1) {
+        wakePipe[0] = wakePipe[1] = -1;
+    }
+    ~TuningWatcher() { Stop(); }
+
+    TuningWatcher(const TuningWatcher&) = delete;
+    TuningWatcher& operator=(const TuningWatcher&) = delete;
+
+    // Loads the file if it is there and starts watching for changes to it.
+    bool Start(const std::string& filePath, std::string& error) {
+        Stop();
+#if defined(_WIN32)
+        (void)filePath;
+        error = "tuning reload is not supported on Windows";
+        return false;
+#else
+        path = filePath;
+        size_t slash = path.find_last_of('/');
+        std::string directory = slash == std::string::npos ? "." : (slash == 0 ? "/" : path.substr(0, slash));
+        fileName = slash == std::string::npos ? path : path.substr(slash + 1);
+        inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        if (inotifyFd < 0 || inotify_add_watch(inotifyFd, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) < 0 ||
+            pipe(wakePipe) < 0) {
+            error = "cannot watch " + directory;
+            CloseFds();
+            return false;
+        }
+        fcntl(wakePipe[0], F_SETFL, O_NONBLOCK);
+        fcntl(wakePipe[1], F_SETFL, O_NONBLOCK);
+        if (access(path.c_str(), F_OK) == 0) Load(Now());
+        running = true;
+        watcher = std::thread([this] { Watch(); });
+        return true;
+#endif
+    }
+
+    void Stop() {
+        if (running) {
+            running = false;
+            Wake();
+            watcher.join();
+        }
+        CloseFds();
+        TuningParams stale;
+        while (loaded.Pop(&stale, 1)) {
+        }
+        waiting = false;
+    }
+
+    // Frame thread, between ticks. Copies the newest loaded block into params;
+    // true when there was one.
+    bool Adopt(TuningParams& params) {
+        if (!loaded.Pop(&params, 1)) return false;
+        while (loaded.Pop(&params, 1)) {
+        }
+        double ms = (Now() - params.seenNs) / 1.0e6;
+        adoptMs.store(ms, std::memory_order_relaxed);
+        if (ms > adoptMaxMs.load(std::memory_order_relaxed)) adoptMaxMs.store(ms, std::memory_order_relaxed);
+        adopted.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
+
+    TuningMetrics Metrics() const {
+        return {loads.load(std::memory_order_relaxed), rejected.load(std::memory_order_relaxed),
+                adopted.load(std::memory_order_relaxed), parseMs.load(std::memory_order_relaxed),
+                adoptMs.load(std::memory_order_relaxed), adoptMaxMs.load(std::memory_order_relaxed)};
+    }
+
+    static int64_t Now() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch())
+            .count();
+    }
+
+private:
+    SpscRing<TuningParams> loaded;  // watcher to frame thread
+    TuningParams newest;            // watcher, parsed but not pushed yet
+    bool waiting;
+    std::atomic<bool> running;
+    std::thread watcher;
+    std::string path, fileName;
+    int inotifyFd;
+    int wakePipe[2];
+
+    std::atomic<long> loads{0}, rejected{0}, adopted{0};
+    std::atomic<double> parseMs{0.0}, adoptMs{0.0}, adoptMaxMs{0.0};
+
+    void Wake() {
+#if !defined(_WIN32)
+        char b = 1;
+        if (wakePipe[1] >= 0) {
+            ssize_t ignored = write(wakePipe[1], &b, 1);
+            (void)ignored;
+        }
+#endif
+    }
+
+    void CloseFds() {
+#if !defined(_WIN32)
+        if (inotifyFd >= 0) close(inotifyFd);
+        if (wakePipe[0] >= 0) close(wakePipe[0]);
+        if (wakePipe[1] >= 0) close(wakePipe[1]);
+#endif
+        inotifyFd = -1;
+        wakePipe[0] = wakePipe[1] = -1;
+    }
+
+    // Pushes the newest block once the ring has room. A full ring means the
+    // game is not ticking; older blocks in it lose to this one at Adopt.
+    void Flush() {
+        if (waiting && loaded.Push(&newest, 1) == 1) waiting = false;
+    }
+
+    // Watcher thread, and Start before the thread runs.
+    void Load(int64_t seenNs) {
+        auto start = std::chrono::steady_clock::now();
+        std::vector<unsigned char> bytes;
+        if (!ReadWholeFile(path.c_str(), bytes)) {
+            rejected.fetch_add(1, std::memory_order_relaxed);
+            if (log) TraceLog(LOG_WARNING, "TUNING: cannot read %s, keeping the current values", path.c_str());
+            return;
+        }
+        TuningParams block;
+        std::vector<std::string> errors;
+        if (!ParseTuning(std::string(bytes.begin(), bytes.end()), fileName, block, errors)) {
+            rejected.fetch_add(1, std::memory_order_relaxed);
+            if (log) {
+                TraceLog(LOG_WARNING, "TUNING: %s rejected, keeping the current values:", path.c_str());
+                for (size_t i = 0; i < errors.size() && i < (size_t)TUNING_ERRORS_SHOWN; i++) {
+                    TraceLog(LOG_WARNING, "TUNING:   %s", errors[i].c_str());
+                }
+                if (errors.size() > (size_t)TUNING_ERRORS_SHOWN) {
+                    TraceLog(LOG_WARNING, "TUNING:   and %d more", (int)errors.size() - TUNING_ERRORS_SHOWN);
+                }
+            }
+            return;
+        }
+        block.seenNs = seenNs;
+        newest = block;
+        waiting = true;
+        Flush();
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        parseMs.store(ms, std::memory_order_relaxed);
+        loads.fetch_add(1, std::memory_order_relaxed);
+        if (log) TraceLog(LOG_INFO, "TUNING: loaded %s in %.2f ms", path.c_str(), ms);
+    }
+
+    void Watch() {
+#if !defined(_WIN32)
+        alignas(inotify_event) char buffer[4096];
+        while (running) {
+            pollfd fds[2] = {{inotifyFd, POLLIN, 0}, {wakePipe[0], POLLIN, 0}};
+            int ready = poll(fds, 2, 250);
+            Flush();
+            if (!running || ready <= 0) continue;
+            char drain[16];
+            while (read(wakePipe[0], drain, sizeof(drain)) > 0) {
+            }
+            int64_t seen = Now();
+            bool changed = false;
+            ssize_t n;
+            while ((n = read(inotifyFd, buffer, sizeof(buffer))) > 0) {
+                for (char* p = buffer; p < buffer + n;) {
+                    const inotify_event* e = (const inotify_event*)p;
+                    if (e->len > 0 && fileName == e->name) changed = true;
+                    p += sizeof(inotify_event) + e->len;
+                }
+            }
+            if (changed) Load(seen);
+        }
+#endif
+    }
+};
+
+#endif
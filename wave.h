@@ -0,0 +1,227 @@
+#ifndef WAVE_H
+#define WAVE_H
+
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <new>
+#include <queue>
+#include <vector>
+
+//#####################
+//Wave scripts
+//#####################
+// A wave is a coroutine that spawns through the world and suspends on
+// `co_await waves.Delay(s)` or `co_await waves.Ticks(n)`. Suspended scripts sit
+// in two min-heaps (by wake time and by wake tick) and cost nothing per tick;
+// Advance pops everything that is due and resumes it as one batch, timed
+// sleepers first, each heap in wake order. Coroutine frames come from
+// size-class free lists, so starting and finishing scripts does not touch the
+// general heap once the pool is warm.
+
+// Free lists of frames in 64-byte classes. Larger frames use operator new.
+// One pool per thread: a scheduler and its scripts live on a single thread.
+class WaveFramePool {
+public:
+    static const size_t CLASS_BYTES = 64;
+    static const int CLASS_COUNT = 16;
+
+    struct Stats {
+        long allocations = 0;
+        long reused = 0;      // served from a free list
+        long oversized = 0;   // bigger than the largest class
+        long live = 0;
+        size_t liveBytes = 0;
+    };
+
+    static WaveFramePool& Local() {
+        thread_local WaveFramePool pool;
+        return pool;
+    }
+
+    void* Allocate(size_t size) {
+        stats.allocations++;
+        stats.live++;
+        int c = ClassOf(size);
+        stats.liveBytes += c >= CLASS_COUNT ? size : (c + 1) * CLASS_BYTES;
+        if (c >= CLASS_COUNT) {
+            stats.oversized++;
+            return ::operator new(size);
+        }
+        if (free[c]) {
+            stats.reused++;
+            FreeFrame* frame = free[c];
+            free[c] = frame->next;
+            return frame;
+        }
+        return ::operator new((c + 1) * CLASS_BYTES);
+    }
+
+    void Release(void* p, size_t size) {
+        stats.live--;
+        int c = ClassOf(size);
+        stats.liveBytes -= c >= CLASS_COUNT ? size : (c + 1) * CLASS_BYTES;
+        if (c >= CLASS_COUNT) {
+            ::operator delete(p);
+            return;
+        }
+        FreeFrame* frame = (FreeFrame*)p;
+        frame->next = free[c];
+        free[c] = frame;
+    }
+
+    const Stats& GetStats() const { return stats; }
+
+    ~WaveFramePool() {
+        for (FreeFrame*& head : free) {
+            while (head) {
+                FreeFrame* next = head->next;
+                ::operator delete(head);
+                head = next;
+            }
+        }
+    }
+
+private:
+    struct FreeFrame {
+        FreeFrame* next;
+    };
+
+    FreeFrame* free[CLASS_COUNT] = {};
+    Stats stats;
+
+    static int ClassOf(size_t size) {
+        return (int)((size + CLASS_BYTES - 1) / CLASS_BYTES) - 1;
+    }
+};
+
+class WaveTask {
+public:
+    struct promise_type {
+        WaveTask get_return_object() {
+            return WaveTask(std::coroutine_handle<promise_type>::from_promise(*this));
+        }
+        // Nothing runs until the scheduler starts it.
+        std::suspend_always initial_suspend() noexcept { return {}; }
+        // The scheduler destroys finished scripts right after resuming them.
+        std::suspend_always final_suspend() noexcept { return {}; }
+        void return_void() {}
+        void unhandled_exception() { std::terminate(); }
+
+        static void* operator new(size_t size) { return WaveFramePool::Local().Allocate(size); }
+        static void operator delete(void* p, size_t size) { WaveFramePool::Local().Release(p, size); }
+    };
+
+    WaveTask(WaveTask&& other) noexcept : handle(other.handle) { other.handle = nullptr; }
+    WaveTask(const WaveTask&) = delete;
+    WaveTask& operator=(const WaveTask&) = delete;
+    ~WaveTask() {
+        if (handle) handle.destroy();
+    }
+
+    // Hands the frame over; the caller becomes responsible for destroying it.
+    std::coroutine_handle<> Release() {
+        std::coroutine_handle<> h = handle;
+        handle = nullptr;
+        return h;
+    }
+
+private:
+    std::coroutine_handle<promise_type> handle;
+
+    explicit WaveTask(std::coroutine_handle<promise_type> h) : handle(h) {}
+};
+
+class WaveScheduler {
+public:
+    struct DelayAwaiter {
+        WaveScheduler* scheduler;
+        double wake;
+        bool await_ready() const noexcept { return wake <= scheduler->now; }
+        void await_suspend(std::coroutine_handle<> h) { scheduler->timeQueue.push({wake, scheduler->sequence++, h}); }
+        void await_resume() const noexcept {}
+    };
+
+    struct TickAwaiter {
+        WaveScheduler* scheduler;
+        uint64_t wake;
+        bool await_ready() const noexcept { return wake <= scheduler->tick; }
+        void await_suspend(std::coroutine_handle<> h) { scheduler->tickQueue.push({(double)wake, scheduler->sequence++, h}); }
+        void await_resume() const noexcept {}
+    };
+
+    WaveScheduler() : now(0.0), tick(0), sequence(0), resumedLastTick(0) {}
+    ~WaveScheduler() { Clear(); }
+
+    WaveScheduler(const WaveScheduler&) = delete;
+    WaveScheduler& operator=(const WaveScheduler&) = delete;
+
+    double Now() const { return now; }
+    uint64_t Tick() const { return tick; }
+    size_t Suspended() const { return timeQueue.size() + tickQueue.size(); }
+    size_t ResumedLastTick() const { return resumedLastTick; }
+
+    DelayAwaiter Delay(double seconds) { return {this, now + seconds}; }
+    TickAwaiter Ticks(uint64_t n) { return {this, tick + n}; }
+
+    // The script first runs on the next Advance.
+    void Start(WaveTask task) {
+        timeQueue.push({now, sequence++, task.Release()});
+    }
+
+    // Moves the clock and resumes every script that is due.
+    void Advance(double dt) {
+        now += dt;
+        tick++;
+        batch.clear();
+        Collect(timeQueue, now);
+        Collect(tickQueue, (double)tick);
+        resumedLastTick = batch.size();
+        for (std::coroutine_handle<> h : batch) {
+            h.resume();
+            if (h.done()) h.destroy();
+        }
+    }
+
+    void Clear() {
+        Drain(timeQueue);
+        Drain(tickQueue);
+        batch.clear();
+    }
+
+private:
+    struct Sleeper {
+        double wake;
+        uint64_t order;
+        std::coroutine_handle<> handle;
+        bool operator>(const Sleeper& other) const {
+            return wake > other.wake || (wake == other.wake && order > other.order);
+        }
+    };
+    typedef std::priority_queue<Sleeper, std::vector<Sleeper>, std::greater<Sleeper>> SleepQueue;
+
+    double now;
+    uint64_t tick;
+    uint64_t sequence;
+    size_t resumedLastTick;
+    SleepQueue timeQueue;
+    SleepQueue tickQueue;
+    std::vector<std::coroutine_handle<>> batch;
+
+    void Collect(SleepQueue& queue, double until) {
+        while (!queue.empty() && queue.top().wake <= until) {
+            batch.push_back(queue.top().handle);
+            queue.pop();
+        }
+    }
+
+    static void Drain(SleepQueue& queue) {
+        while (!queue.empty()) {
+            queue.top().handle.destroy();
+            queue.pop();
+        }
+    }
+};
+
+#endif